@@ -7,8 +7,16 @@ for /r src %%f in (*.cpp *.c) do (
     set "SRC_FILES=!SRC_FILES! %%f"
 )
 
+:: FreeType is optional, the SDF glyph atlas is compiled in exactly when its headers and library are both present
+set "EXTRA_LIBS="
+set "EXTRA_FLAGS="
+if exist lib\freetype.lib if exist include\freetype\freetype.h (
+    set "EXTRA_FLAGS=-DENGINE_FREETYPE"
+    set "EXTRA_LIBS=!EXTRA_LIBS! -lfreetype"
+)
+
 :: Compile the project treating all files as C++ (using -x c++)
-clang -x c++ -I include -I src %SRC_FILES%  -o output/Output.exe -std=c++17 -Wall -Wextra -L lib -lgdi32 -lglfw3dll -lassimp -Wl,/stack:8388608
+clang -x c++ -I include -I src !EXTRA_FLAGS! %SRC_FILES%  -o output/Output.exe -std=c++17 -Wall -Wextra -L lib -lgdi32 -lglfw3dll -lassimp !EXTRA_LIBS! -Wl,/stack:8388608
 
 if %ERRORLEVEL% neq 0 (
     echo Build failed.
@@ -0,0 +1,34 @@
+#!/bin/sh
+# Linux build, the counterpart of build.bat. Needs GLFW and assimp from the system packages.
+cd "$(dirname "$0")" || exit 1
+
+CXX="${CXX:-clang++}"
+
+# Collect all .cpp and .c files in src and its subdirectories
+SRC_FILES=$(find src -name '*.cpp' -o -name '*.c')
+
+# FreeType is optional, the SDF glyph atlas is compiled in exactly when FreeType is linked
+EXTRA_FLAGS=""
+EXTRA_LIBS=""
+if pkg-config --exists freetype2; then
+    EXTRA_FLAGS="$EXTRA_FLAGS -DENGINE_FREETYPE $(pkg-config --cflags freetype2)"
+    EXTRA_LIBS="$EXTRA_LIBS $(pkg-config --libs freetype2)"
+fi
+
+# Headless contexts (--benchmark --headless) use surfaceless EGL or OSMesa, whichever is installed
+if pkg-config --exists egl; then
+    EXTRA_LIBS="$EXTRA_LIBS $(pkg-config --libs egl)"
+fi
+if pkg-config --exists osmesa; then
+    EXTRA_FLAGS="$EXTRA_FLAGS $(pkg-config --cflags osmesa)"
+    EXTRA_LIBS="$EXTRA_LIBS $(pkg-config --libs osmesa)"
+fi
+
+# Compile the project treating all files as C++ (using -x c++)
+if ! $CXX -x c++ -I include -I src $EXTRA_FLAGS $SRC_FILES -o output/Output -std=c++17 -Wall -Wextra -O2 \
+    -lglfw -lassimp $EXTRA_LIBS -lpthread -ldl; then
+    echo "Build failed."
+    exit 1
+fi
+
+echo "Build successful."
@@ -0,0 +1,9 @@
+// Per-draw transforms, packed on the recording thread by CommandList::SetDrawParams
+layout(std140) uniform DrawParams
+{
+    mat4 Model;
+    mat4 ViewProjection;              // Jittered while temporal anti-aliasing is on
+    mat4 PreviousModelViewProjection; // Last frame's unjittered transform, for motion vectors
+    mat3 NormalMatrix;                // Inverse transpose of Model, computed on the CPU
+    vec4 Temporal;                    // xy: clip space jitter of ViewProjection, z: jitter phase in [0, 1)
+};
@@ -0,0 +1,5 @@
+// Per-material constants, packed by Material::SetUniform into a range of the shared uniform arena
+layout(std140) uniform MaterialParams
+{
+    vec4 Color;
+};
@@ -0,0 +1,26 @@
+// Catmull-Rom through the 4x4 texels around Position (in texels), folded into nine bilinear taps of which the
+// four corners carry too little weight to keep. Taps stay inside the lower left Size texels, Texel is one over
+// the texture size
+vec3 SampleCatmullRom(sampler2D Source, vec2 Position, vec2 Size, vec2 Texel) {
+    vec2 Center = floor(Position - 0.5) + 0.5;
+    vec2 F = Position - Center;
+
+    vec2 W0 = F * (-0.5 + F * (1.0 - 0.5 * F));
+    vec2 W1 = 1.0 + F * F * (-2.5 + 1.5 * F);
+    vec2 W2 = F * (0.5 + F * (2.0 - 1.5 * F));
+    vec2 W3 = F * F * (-0.5 + 0.5 * F);
+    vec2 W12 = W1 + W2;
+
+    vec2 Low = vec2(0.5), High = Size - 0.5;
+    vec2 P0 = clamp(Center - 1.0, Low, High) * Texel;
+    vec2 P12 = clamp(Center + W2 / W12, Low, High) * Texel;
+    vec2 P3 = clamp(Center + 2.0, Low, High) * Texel;
+
+    vec3 Color = texture(Source, vec2(P12.x, P0.y)).rgb * W12.x * W0.y;
+    Color += texture(Source, vec2(P0.x, P12.y)).rgb * W0.x * W12.y;
+    Color += texture(Source, vec2(P12.x, P12.y)).rgb * W12.x * W12.y;
+    Color += texture(Source, vec2(P3.x, P12.y)).rgb * W3.x * W12.y;
+    Color += texture(Source, vec2(P12.x, P3.y)).rgb * W12.x * W3.y;
+    float Weight = W12.x * W0.y + W0.x * W12.y + W12.x * W12.y + W3.x * W12.y + W12.x * W3.y;
+    return Color / Weight;
+}
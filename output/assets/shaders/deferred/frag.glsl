@@ -5,6 +5,7 @@ in vec3 VertexColor;
 in vec3 FragNormal;
 in vec3 FragPos;
 in vec4 FragPosClip;
+in vec4 PreviousPosClip;
 in vec3 Tangent;
 in vec3 Bitangent;
 
@@ -15,20 +16,29 @@ layout(location = 3) out float OutDepth;
 layout(location = 4) out float OutMetallic;
 layout(location = 5) out float OutRoughness;
 layout(location = 6) out vec3 OutEmission;
+layout(location = 7) out vec2 OutVelocity;
 
-// Uniforms
+// Uniforms, features are compiled in per material through keyword #defines
+#ifdef USE_TEXTURE
 uniform sampler2D Texture;
+#endif
+#ifdef USE_NORMAL
 uniform sampler2D NormalTexture;
+#endif
+#ifdef USE_METALLIC
 uniform sampler2D MetallicTexture;
+#endif
+#ifdef USE_ROUGHNESS
 uniform sampler2D RoughnessTexture;
+#endif
+#ifdef USE_EMISSION
 uniform sampler2D EmissionTexture;
-uniform bool UseVertexColor;
-uniform bool UseTexture;
-uniform bool UseEmission;
-uniform bool UseMetallic;
-uniform bool UseRoughness;
-uniform bool UseNormal;
-uniform vec4 Color;
+#endif
+#ifdef USE_OPACITY
+uniform sampler2D OpacityTexture;
+#endif
+#include "../Common/Material.glsl"
+#include "../Common/Draw.glsl"
 
 // Ordered Dither Matrix (4x4 Bayer matrix)
 const mat4 ditherMatrix = mat4(
@@ -41,62 +51,81 @@ const mat4 ditherMatrix = mat4(
 void main() {
     vec4 FinalColor = Color;
 
-    if (UseTexture) {
-        FinalColor *= texture(Texture, TexCoord);
-    }
+#ifdef USE_TEXTURE
+    FinalColor *= texture(Texture, TexCoord);
+#endif
 
-    if (UseVertexColor) {
-        FinalColor *= vec4(VertexColor, 1.0);
-    }
+#ifdef USE_VERTEX_COLOR
+    FinalColor *= vec4(VertexColor, 1.0);
+#endif
+
+#ifdef USE_OPACITY
+    FinalColor.a *= texture(OpacityTexture, TexCoord).r;
+#endif
 
     vec2 screenPos = FragPosClip.xy / FragPosClip.w;
+
+#ifdef USE_ALPHA_TEST
+#ifdef USE_ALPHA_CUTOFF
+    // Masked materials are either there or not, a fixed threshold keeps their edges still
+    if (FinalColor.a < 0.5) {
+        discard;
+    }
+#else
     ivec2 screenPixel = ivec2(gl_FragCoord.xy);
 
-    // Calculate dither value from the matrix
-    float ditherValue = ditherMatrix[screenPixel.x % 4][screenPixel.y % 4];
+    // Calculate dither value from the matrix, shifted every frame with the jitter so temporal
+    // anti-aliasing averages the pattern out
+    float ditherValue = fract(ditherMatrix[screenPixel.x % 4][screenPixel.y % 4] + Temporal.z);
 
     if (FinalColor.a < ditherValue) {
         discard;
     }
+#endif
+#endif
 
     OutColor = FinalColor;
 
     float metallic = 0.0;
     float roughness = 0.0;
 
-    if (UseMetallic) {
-        metallic = texture(MetallicTexture, TexCoord).r;
-    }
+#ifdef USE_METALLIC
+    metallic = texture(MetallicTexture, TexCoord).r;
+#endif
 
-    if (UseRoughness) {
-        roughness = texture(RoughnessTexture, TexCoord).r;
-    }
+#ifdef USE_ROUGHNESS
+    roughness = texture(RoughnessTexture, TexCoord).r;
+#endif
 
     OutMetallic = metallic;
     OutRoughness = roughness;
 
     // Normal Mapping
     vec3 normal = normalize(FragNormal);
-    if (UseNormal) {
-        vec3 tangentNormal = texture(NormalTexture, TexCoord).rgb * 2.0 - 1.0;
+#ifdef USE_NORMAL
+    vec3 tangentNormal = texture(NormalTexture, TexCoord).rgb * 2.0 - 1.0;
 
-        // Construct TBN matrix
-        vec3 T = normalize(Tangent);
-        vec3 B = normalize(Bitangent);
-        vec3 N = normalize(FragNormal);
-        mat3 TBN = mat3(T, B, N);
+    // Construct TBN matrix
+    vec3 T = normalize(Tangent);
+    vec3 B = normalize(Bitangent);
+    vec3 N = normalize(FragNormal);
+    mat3 TBN = mat3(T, B, N);
 
-        normal = normalize(TBN * tangentNormal);
-    }
+    normal = normalize(TBN * tangentNormal);
+#endif
 
     OutFragNormal = normal;
     OutFragPosition = FragPos;
 
-    if (UseEmission) {
-        OutEmission = texture(EmissionTexture, TexCoord).rgb;
-    } else {
-        OutEmission = vec3(0.0);
-    }
+#ifdef USE_EMISSION
+    OutEmission = texture(EmissionTexture, TexCoord).rgb;
+#else
+    OutEmission = vec3(0.0);
+#endif
 
     OutDepth = gl_FragCoord.z;
+
+    // Screen space motion since the last frame in texture coordinates, without this frame's jitter
+    vec2 PreviousScreenPos = PreviousPosClip.xy / PreviousPosClip.w;
+    OutVelocity = ((screenPos - Temporal.xy) - PreviousScreenPos) * 0.5;
 }
@@ -38,53 +38,98 @@ uniform DirectionalLight DirectionalLights[64];
 uniform int NumSpotLights;
 uniform SpotLight SpotLights[64];
 uniform vec3 ViewPosition;
-
-const float PI = 3.14159265359;
-
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
-}
-
-float DistributionGGX(vec3 N, vec3 H, float a) {
-    float a2 = a*a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH*NdotH;
-    float nom = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-    return nom / denom;
-}
-
-float GeometrySchlickGGX(float NdotV, float k) {
-    float nom = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-    return nom / denom;
+// Share of the G-buffer the scene was drawn into, its lower left corner
+uniform vec2 RenderScale;
+
+// Cascaded shadows of the first directional light, tiles of a 2x2 depth atlas
+uniform sampler2DShadow ShadowMap;
+uniform int NumShadowCascades;
+uniform mat4 ShadowMatrices[4];
+uniform vec4 ShadowTexelSizes;
+uniform float ShadowAtlasTexel;
+
+// Point and spot light shadows, tiles of one depth atlas. Shadowed lights are listed by ascending light index
+uniform sampler2DShadow LocalShadowMap;
+uniform float LocalShadowAtlasTexel;
+uniform int NumPointShadows;
+uniform int PointShadowLights[8];
+uniform vec4 PointShadowParams[8]; // Near, far, face scale, normal offset per unit of distance
+uniform vec4 PointShadowFaces[48]; // Offset and size of each face's tile
+uniform int NumSpotShadows;
+uniform int SpotShadowLights[8];
+uniform mat4 SpotShadowMatrices[8];
+uniform float SpotShadowOffsets[8];
+
+// Same face axes the atlas renders the cube faces with
+const vec3 CubeFaceForward[6] = vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1));
+const vec3 CubeFaceUp[6] = vec3[](vec3(0, -1, 0), vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, -1, 0), vec3(0, -1, 0));
+
+#include "../Common/BRDF.glsl"
+
+// Picks the first cascade that holds the point and filters 3x3 hardware compared taps around it
+float SunShadow(vec3 Position, vec3 Normal) {
+    for (int c = 0; c < min(NumShadowCascades, 4); c++) {
+        // Pushing the lookup out along the normal by a texel or two removes most self shadowing
+        vec4 Coord = ShadowMatrices[c] * vec4(Position + Normal * ShadowTexelSizes[c] * 1.5, 1.0);
+        if (any(lessThan(Coord.xy, vec2(0.02))) || any(greaterThan(Coord.xy, vec2(0.98))) || Coord.z > 1.0)
+            continue;
+
+        vec2 Tile = vec2(c % 2, c / 2);
+        float Lit = 0.0;
+        for (int x = -1; x <= 1; x++) {
+            for (int y = -1; y <= 1; y++)
+                Lit += texture(ShadowMap, vec3((Coord.xy + Tile) * 0.5 + vec2(x, y) * ShadowAtlasTexel, Coord.z));
+        }
+        return Lit / 9.0;
+    }
+    return 1.0;
 }
 
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float k) {
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx1 = GeometrySchlickGGX(NdotV, k);
-    float ggx2 = GeometrySchlickGGX(NdotL, k);
-    return ggx1 * ggx2;
+// 3x3 hardware compared taps around Coord, tiles keep a guard band so none reach a neighbouring tile
+float LocalShadowFilter(vec2 Coord, float Depth) {
+    float Lit = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++)
+            Lit += texture(LocalShadowMap, vec3(Coord + vec2(x, y) * LocalShadowAtlasTexel, Depth));
+    }
+    return Lit / 9.0;
 }
 
-vec3 ACESFittedTonemap(vec3 color) {
-    const float A = 2.51;
-    const float B = 0.03;
-    const float C = 2.43;
-    const float D = 0.59;
-    const float E = 0.14;
-    return (color * (A * color + B)) / (color * (C * color + D) + E);
+float PointShadow(int Slot, vec3 Position, vec3 Normal, vec3 LightPosition) {
+    vec4 Params = PointShadowParams[Slot];
+    vec3 D = Position - LightPosition;
+    D += Normal * length(D) * Params.w;
+
+    // The dominant axis picks the face, then the point is projected the way that face was rendered
+    vec3 A = abs(D);
+    int Face = (A.x >= A.y && A.x >= A.z) ? (D.x > 0.0 ? 0 : 1) : (A.y >= A.z ? (D.y > 0.0 ? 2 : 3) : (D.z > 0.0 ? 4 : 5));
+    vec3 Forward = CubeFaceForward[Face];
+    vec3 Up = CubeFaceUp[Face];
+    float Depth = dot(D, Forward);
+    if (Depth >= Params.y)
+        return 1.0;
+
+    vec2 Projected = vec2(dot(D, cross(Forward, Up)), dot(D, Up)) / Depth * Params.z;
+    float Z = ((Params.y + Params.x) - 2.0 * Params.y * Params.x / Depth) / (Params.y - Params.x) * 0.5 + 0.5;
+    vec4 Tile = PointShadowFaces[Slot * 6 + Face];
+    return LocalShadowFilter(Tile.xy + (Projected * 0.5 + 0.5) * Tile.zw, Z);
 }
 
-vec3 GammaCorrect(vec3 color, float gamma) {
-    return pow(color, vec3(1.0 / gamma));
+float SpotShadow(int Slot, vec3 Position, vec3 Normal, vec3 LightPosition) {
+    float Distance = length(Position - LightPosition);
+    vec4 Coord = SpotShadowMatrices[Slot] * vec4(Position + Normal * Distance * SpotShadowOffsets[Slot], 1.0);
+    if (Coord.w <= 0.0)
+        return 1.0;
+    Coord.xyz /= Coord.w;
+    if (Coord.z > 1.0)
+        return 1.0;
+    return LocalShadowFilter(Coord.xy, Coord.z);
 }
 
 void main() {
     // Sample textures
-    vec4 AlbedoSample = texture(AlbedoTexture, TexCoord);
+    vec2 UV = TexCoord * RenderScale;
+    vec4 AlbedoSample = texture(AlbedoTexture, UV);
     vec3 Albedo = AlbedoSample.rgb;
     float Alpha = AlbedoSample.a;
 
@@ -93,8 +138,8 @@ void main() {
     }
 
     // Attempt to fetch Normal and Position data
-    vec3 Normal = texture(NormalTexture, TexCoord).rgb;
-    vec3 Position = texture(PositionTexture, TexCoord).rgb;
+    vec3 Normal = texture(NormalTexture, UV).rgb;
+    vec3 Position = texture(PositionTexture, UV).rgb;
 
 
     bool hasNormal = length(Normal) > 0.0;
@@ -106,21 +151,24 @@ void main() {
     }
 
 
-    float Metallic = clamp(texture(MetallicTexture, TexCoord).r, 0.0, 1.0);
-    float Roughness = clamp(1.0 - texture(RoughnessTexture, TexCoord).r, 0.05, 1.0);
-    vec3 Emission = texture(EmissionTexture, TexCoord).rgb;
+    float Metallic = clamp(texture(MetallicTexture, UV).r, 0.0, 1.0);
+    float Roughness = clamp(1.0 - texture(RoughnessTexture, UV).r, 0.05, 1.0);
+    vec3 Emission = texture(EmissionTexture, UV).rgb;
 
     vec3 V = normalize(ViewPosition - Position);
     vec3 F0 = mix(vec3(0.04), Albedo, Metallic);
     vec3 Lo = vec3(0.0);
 
     // Point light loop
+    int PointShadowSlot = 0;
     for (int i = 0; i < min(NumPointLights, 64); i++) {
         vec3 L = normalize(PointLights[i].Position - Position);
         vec3 H = normalize(V + L);
         float distance = length(PointLights[i].Position - Position);
         float attenuation = 1.0 / (distance * distance);
         vec3 radiance = PointLights[i].Color * PointLights[i].Intensity * attenuation;
+        if (PointShadowSlot < min(NumPointShadows, 8) && PointShadowLights[PointShadowSlot] == i)
+            radiance *= PointShadow(PointShadowSlot++, Position, Normal, PointLights[i].Position);
 
         vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
         float NDF = DistributionGGX(Normal, H, Roughness);
@@ -143,6 +191,8 @@ void main() {
         vec3 L = normalize(-DirectionalLights[i].Direction);
         vec3 H = normalize(V + L);
         vec3 radiance = DirectionalLights[i].Color * DirectionalLights[i].Intensity;
+        if (i == 0)
+            radiance *= SunShadow(Position, Normal);
 
         vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
         float NDF = DistributionGGX(Normal, H, Roughness);
@@ -161,6 +211,7 @@ void main() {
     }
 
     // Spotlight loop
+    int SpotShadowSlot = 0;
     for (int i = 0; i < min(NumSpotLights, 64); i++) {
         vec3 L = normalize(SpotLights[i].Position - Position);
         vec3 H = normalize(V + L);
@@ -173,6 +224,8 @@ void main() {
         float intensity = clamp((theta - SpotLights[i].OuterCutoff) / epsilon, 0.0, 1.0);
 
         vec3 radiance = SpotLights[i].Color * SpotLights[i].Intensity * attenuation * intensity;
+        if (SpotShadowSlot < min(NumSpotShadows, 8) && SpotShadowLights[SpotShadowSlot] == i)
+            radiance *= SpotShadow(SpotShadowSlot++, Position, Normal, SpotLights[i].Position);
 
         vec3 F = fresnelSchlick(max(dot(H, V), 0.0), F0);
         float NDF = DistributionGGX(Normal, H, Roughness);
@@ -10,18 +10,21 @@ out vec3 VertexColor;
 out vec3 FragNormal;
 out vec3 FragPos;
 out vec4 FragPosClip;
+out vec4 PreviousPosClip;
 
 
-uniform mat4 Model;
-uniform mat4 View;
-uniform mat4 Projection;
+#include "../Common/Draw.glsl"
+
+// The depth pre-pass computes the same position, its depth has to match exactly for the equal test
+invariant gl_Position;
 
 void main() {
     TexCoord = ATexCoord;  
     VertexColor = AColor; 
-    FragNormal = mat3(transpose(inverse(Model))) * ANormal;
+    FragNormal = NormalMatrix * ANormal;
     FragPos = vec3(Model * vec4(APos, 1.0));
 
-    gl_Position = Projection * View * Model * vec4(APos, 1.0);
+    gl_Position = ViewProjection * Model * vec4(APos, 1.0);
     FragPosClip = gl_Position;
+    PreviousPosClip = PreviousModelViewProjection * vec4(APos, 1.0);
 }
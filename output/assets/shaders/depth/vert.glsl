@@ -0,0 +1,12 @@
+#version 410 core
+
+layout(location = 0) in vec3 APos;       // Position
+
+#include "../Common/Draw.glsl"
+
+// Has to match the depth of Deferred/Vert.glsl exactly, the G-buffer pass tests for equal depth
+invariant gl_Position;
+
+void main() {
+    gl_Position = ViewProjection * Model * vec4(APos, 1.0);
+}
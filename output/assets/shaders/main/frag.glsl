@@ -1,25 +1,25 @@
 #version 410 core
 
 in vec2 TexCoord;
-in vec3 VertexColor;
+in vec4 VertexColor;
 
 out vec4 OutColor;
 
+#ifdef USE_TEXTURE
 uniform sampler2D Texture;
-uniform bool UseTexture;
-uniform bool UseVertexColor;
-uniform vec4 Color;
+#endif
+#include "../Common/Material.glsl"
 
 void main() {
     vec4 FinalColor = Color;
 
-    if (UseTexture) {
-        FinalColor *= texture(Texture, TexCoord);
-    }
+#ifdef USE_TEXTURE
+    FinalColor *= texture(Texture, TexCoord);
+#endif
 
-    if (UseVertexColor) {
-        FinalColor *= vec4(VertexColor, 1.0);
-    }
+#ifdef USE_VERTEX_COLOR
+    FinalColor *= VertexColor;
+#endif
 
     OutColor = FinalColor;
     
@@ -3,10 +3,10 @@
 layout(location = 0) in vec3 APos;       // Position
 layout(location = 1) in vec2 ATexCoord;  // Texture Coordinates
 layout(location = 2) in vec3 ANormal;    // Normal
-layout(location = 3) in vec3 AColor;     // Vertex Color
+layout(location = 3) in vec4 AColor;     // Vertex Color, meshes with RGB colours read alpha as 1
 
 out vec2 TexCoord;
-out vec3 VertexColor;
+out vec4 VertexColor;
 out vec3 FragNormal;
 out vec3 FragPos;
 
@@ -17,7 +17,7 @@ uniform mat4 Projection;
 void main() {
     TexCoord = ATexCoord;  
     VertexColor = AColor; 
-    FragNormal = mat3(transpose(inverse(Model))) * ANormal;
+    FragNormal = mat3(Model) * ANormal; // Sprites and text are unlit, no fragment shader of theirs reads it
     FragPos = vec3(Model * vec4(APos, 1.0));
 
     gl_Position = Projection * View * Model * vec4(APos, 1.0);
@@ -0,0 +1,5 @@
+#version 410 core
+
+// Depth only, the shadow atlas has no color attachment
+void main() {
+}
@@ -0,0 +1,9 @@
+#version 410 core
+
+layout(location = 0) in vec3 APos;       // Position
+
+#include "../Common/Draw.glsl"
+
+void main() {
+    gl_Position = ViewProjection * Model * vec4(APos, 1.0);
+}
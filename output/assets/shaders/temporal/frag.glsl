@@ -0,0 +1,103 @@
+#version 410 core
+
+in vec2 TexCoord;
+out vec4 OutColor;
+
+// This frame's lit scene, motion vectors and depth, drawn jittered into the lower left InputSize texels
+uniform sampler2D InputTexture;
+uniform sampler2D VelocityTexture;
+uniform sampler2D DepthTexture;
+// Last frame's output, all OutputSize texels of it are valid
+uniform sampler2D HistoryTexture;
+
+uniform vec2 InputSize;
+uniform vec2 OutputSize;
+// How far the jitter moved the scene in the input, in input texels
+uniform vec2 Jitter;
+uniform float HistoryWeight;
+uniform float HistoryValid;
+
+#include "../Common/Sampling.glsl"
+
+vec3 ToYCoCg(vec3 Color) {
+    return vec3(dot(Color, vec3(0.25, 0.5, 0.25)), dot(Color, vec3(0.5, 0.0, -0.5)), dot(Color, vec3(-0.25, 0.5, -0.25)));
+}
+
+vec3 FromYCoCg(vec3 Color) {
+    return vec3(Color.x + Color.y - Color.z, Color.x + Color.z, Color.x - Color.y - Color.z);
+}
+
+// Moves History along the line towards the box center until it lies inside the box
+vec3 ClipToBox(vec3 History, vec3 BoxMin, vec3 BoxMax) {
+    vec3 Center = (BoxMin + BoxMax) * 0.5;
+    vec3 Extent = max((BoxMax - BoxMin) * 0.5, vec3(1e-4));
+    vec3 Offset = History - Center;
+    vec3 Units = abs(Offset / Extent);
+    float Largest = max(Units.x, max(Units.y, Units.z));
+    return Largest > 1.0 ? Center + Offset / Largest : History;
+}
+
+void main() {
+    // Where this output pixel's center landed in the jittered input, in input texels
+    vec2 Position = TexCoord * InputSize + Jitter;
+    ivec2 Base = ivec2(floor(Position));
+    ivec2 Last = ivec2(InputSize) - 1;
+    vec2 OutputPerInput = OutputSize / InputSize;
+
+    // Reconstruct the current color from the 3x3 input samples around it, weighted by their distance, and
+    // gather the neighborhood the history is clamped to
+    vec3 Current = vec3(0.0), Mean = vec3(0.0), Moment = vec3(0.0);
+    vec3 BoxMin = vec3(1e9), BoxMax = vec3(-1e9);
+    float WeightSum = 0.0, Confidence = 0.0;
+    float ClosestDepth = 2.0;
+    ivec2 ClosestTexel = clamp(Base, ivec2(0), Last);
+    for (int Y = -1; Y <= 1; ++Y) {
+        for (int X = -1; X <= 1; ++X) {
+            ivec2 Texel = clamp(Base + ivec2(X, Y), ivec2(0), Last);
+            vec3 Sample = ToYCoCg(texelFetch(InputTexture, Texel, 0).rgb);
+            vec2 Distance = vec2(Texel) + 0.5 - Position;
+
+            // Gaussian fit of Blackman-Harris over one input texel, confidence measures how close the
+            // nearest sample came to this output pixel
+            float Weight = exp(-2.29 * dot(Distance, Distance));
+            vec2 OutputDistance = Distance * OutputPerInput;
+            Confidence = max(Confidence, exp(-2.29 * dot(OutputDistance, OutputDistance)));
+            Current += Sample * Weight;
+            WeightSum += Weight;
+
+            Mean += Sample;
+            Moment += Sample * Sample;
+            BoxMin = min(BoxMin, Sample);
+            BoxMax = max(BoxMax, Sample);
+
+            // Edges move with the closest surface, empty texels keep a depth of 0
+            float Depth = texelFetch(DepthTexture, Texel, 0).r;
+            if (Depth > 0.0 && Depth < ClosestDepth) {
+                ClosestDepth = Depth;
+                ClosestTexel = Texel;
+            }
+        }
+    }
+    Current /= WeightSum;
+
+    // Variance clipping, tighter than the min/max box on its own
+    Mean /= 9.0;
+    vec3 Deviation = sqrt(max(Moment / 9.0 - Mean * Mean, vec3(0.0)));
+    BoxMin = max(BoxMin, Mean - Deviation * 1.25);
+    BoxMax = min(BoxMax, Mean + Deviation * 1.25);
+
+    vec2 Velocity = texelFetch(VelocityTexture, ClosestTexel, 0).rg;
+    vec2 PreviousUV = TexCoord - Velocity;
+    bool Offscreen = any(lessThan(PreviousUV, vec2(0.0))) || any(greaterThan(PreviousUV, vec2(1.0)));
+
+    vec3 History = SampleCatmullRom(HistoryTexture, PreviousUV * OutputSize, OutputSize, 1.0 / OutputSize);
+    History = ClipToBox(ToYCoCg(History), BoxMin, BoxMax);
+
+    // Output pixels far from every sample of this frame lean on the history, which gathers the samples of
+    // the whole jitter sequence when upsampling
+    float Blend = clamp((1.0 - HistoryWeight) * Confidence, 0.02, 1.0);
+    if (HistoryValid < 0.5 || Offscreen)
+        Blend = 1.0;
+
+    OutColor = vec4(max(FromYCoCg(mix(History, Current, Blend)), vec3(0.0)), 1.0);
+}
@@ -0,0 +1,23 @@
+#version 410 core
+
+in vec2 TexCoord;
+in vec4 VertexColor;
+
+out vec4 OutColor;
+
+uniform sampler2D Texture; // Signed distance field, 0.5 on the glyph edge
+#include "../Common/Material.glsl"
+
+void main() {
+    float Distance = texture(Texture, TexCoord).r;
+
+    // Anti-alias over one screen pixel regardless of how far the glyph is scaled
+    float Width = max(fwidth(Distance) * 0.5, 0.0001);
+    float Alpha = smoothstep(0.5 - Width, 0.5 + Width, Distance);
+
+    OutColor = vec4(Color.rgb, Color.a * Alpha);
+
+    if (OutColor.a < 0.01) {
+        discard;
+    }
+}
@@ -0,0 +1,27 @@
+#version 410 core
+
+in vec2 TexCoord;
+out vec4 OutColor;
+
+// Lit scene drawn into the lower left InputSize texels of the texture, the rest of it is stale
+uniform sampler2D InputTexture;
+uniform vec2 InputSize;
+uniform vec2 InputTexel;
+
+#include "../Common/Sampling.glsl"
+
+void main() {
+    vec2 Position = TexCoord * InputSize;
+    vec3 Color = SampleCatmullRom(InputTexture, Position, InputSize, InputTexel);
+
+    // The negative lobes ring around hard edges, keep the result within the four nearest texels
+    ivec2 Base = ivec2(floor(Position - 0.5));
+    ivec2 Last = ivec2(InputSize) - 1;
+    vec3 A = texelFetch(InputTexture, clamp(Base, ivec2(0), Last), 0).rgb;
+    vec3 B = texelFetch(InputTexture, clamp(Base + ivec2(1, 0), ivec2(0), Last), 0).rgb;
+    vec3 C = texelFetch(InputTexture, clamp(Base + ivec2(0, 1), ivec2(0), Last), 0).rgb;
+    vec3 D = texelFetch(InputTexture, clamp(Base + ivec2(1, 1), ivec2(0), Last), 0).rgb;
+    Color = clamp(Color, min(min(A, B), min(C, D)), max(max(A, B), max(C, D)));
+
+    OutColor = vec4(Color, 1.0);
+}
@@ -0,0 +1,332 @@
+#include "cpu_benchmark.h"
+
+namespace
+{
+    // Results are folded in here so the optimizer cannot drop the measured work
+    volatile size_t Sink = 0;
+}
+
+Engine::CpuBenchmark::Result Engine::CpuBenchmark::Measure(const std::string &Name, const std::function<void()> &Body)
+{
+    using Clock = std::chrono::steady_clock;
+    const int Samples = 15;
+    const double MinSampleMilliseconds = 5.0;
+
+    // Grow the batch until one sample is long enough for the clock resolution not to matter
+    size_t Iterations = 1;
+    for (;;)
+    {
+        Clock::time_point Start = Clock::now();
+        for (size_t i = 0; i < Iterations; ++i)
+            Body();
+        double Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        if (Milliseconds >= MinSampleMilliseconds || Iterations >= (size_t(1) << 30))
+            break;
+        Iterations *= 2;
+    }
+
+    std::vector<double> PerOp;
+    for (int Sample = 0; Sample < Samples; ++Sample)
+    {
+        Clock::time_point Start = Clock::now();
+        for (size_t i = 0; i < Iterations; ++i)
+            Body();
+        PerOp.push_back(std::chrono::duration<double, std::nano>(Clock::now() - Start).count() / Iterations);
+    }
+
+    std::sort(PerOp.begin(), PerOp.end());
+    return {Name, Iterations, PerOp[PerOp.size() / 2], PerOp.front()};
+}
+
+aiScene *Engine::CpuBenchmark::CreateGridScene(unsigned int MeshCount, unsigned int GridSize)
+{
+    aiScene *Scene = new aiScene();
+    Scene->mRootNode = new aiNode();
+    Scene->mNumMaterials = 1;
+    Scene->mMaterials = new aiMaterial *[1]{new aiMaterial()};
+    Scene->mNumMeshes = MeshCount;
+    Scene->mMeshes = new aiMesh *[MeshCount];
+
+    for (unsigned int MeshIndex = 0; MeshIndex < MeshCount; ++MeshIndex)
+    {
+        aiMesh *Grid = new aiMesh();
+        Grid->mNumVertices = GridSize * GridSize;
+        Grid->mVertices = new aiVector3D[Grid->mNumVertices];
+        Grid->mNormals = new aiVector3D[Grid->mNumVertices];
+        Grid->mTextureCoords[0] = new aiVector3D[Grid->mNumVertices];
+        Grid->mNumUVComponents[0] = 2;
+
+        for (unsigned int Y = 0; Y < GridSize; ++Y)
+        {
+            for (unsigned int X = 0; X < GridSize; ++X)
+            {
+                unsigned int Index = Y * GridSize + X;
+                Grid->mVertices[Index] = aiVector3D(static_cast<float>(X), static_cast<float>(MeshIndex), static_cast<float>(Y));
+                Grid->mNormals[Index] = aiVector3D(0.0f, 1.0f, 0.0f);
+                Grid->mTextureCoords[0][Index] = aiVector3D(X / float(GridSize), Y / float(GridSize), 0.0f);
+            }
+        }
+
+        Grid->mNumFaces = (GridSize - 1) * (GridSize - 1) * 2;
+        Grid->mFaces = new aiFace[Grid->mNumFaces];
+        unsigned int Face = 0;
+        for (unsigned int Y = 0; Y + 1 < GridSize; ++Y)
+        {
+            for (unsigned int X = 0; X + 1 < GridSize; ++X)
+            {
+                unsigned int Corner = Y * GridSize + X;
+                for (unsigned int Triangle = 0; Triangle < 2; ++Triangle, ++Face)
+                {
+                    Grid->mFaces[Face].mNumIndices = 3;
+                    Grid->mFaces[Face].mIndices = (Triangle == 0) ? new unsigned int[3]{Corner, Corner + GridSize, Corner + 1}
+                                                                   : new unsigned int[3]{Corner + 1, Corner + GridSize, Corner + GridSize + 1};
+                }
+            }
+        }
+        Scene->mMeshes[MeshIndex] = Grid;
+    }
+    return Scene;
+}
+
+void Engine::CpuBenchmark::WriteResults(std::ostream &Stream, const std::vector<Result> &Results)
+{
+    Stream << std::fixed << std::setprecision(2) << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < Results.size(); ++i)
+    {
+        Stream << "    {\"name\": \"" << Results[i].Name << "\", \"iterations\": " << Results[i].Iterations
+               << ", \"ns_per_op\": " << Results[i].NanosecondsPerOp << ", \"min_ns_per_op\": " << Results[i].MinNanosecondsPerOp
+               << "}" << (i + 1 < Results.size() ? "," : "") << "\n";
+    }
+    Stream << "  ]\n}\n";
+}
+
+std::unordered_map<std::string, double> Engine::CpuBenchmark::LoadBaseline(const std::string &Path)
+{
+    std::unordered_map<std::string, double> Baseline;
+    std::ifstream File(Path);
+    if (!File)
+    {
+        std::cerr << "CpuBenchmark: Could not open baseline " << Path << std::endl;
+        return Baseline;
+    }
+
+    // Reads back the format written by WriteResults, one benchmark object per line
+    std::string Line;
+    while (std::getline(File, Line))
+    {
+        size_t NameStart = Line.find("\"name\": \"");
+        size_t ValueStart = Line.find("\"ns_per_op\": ");
+        if (NameStart == std::string::npos || ValueStart == std::string::npos)
+            continue;
+
+        NameStart += 9;
+        std::string Name = Line.substr(NameStart, Line.find('"', NameStart) - NameStart);
+        Baseline[Name] = std::atof(Line.c_str() + ValueStart + 13);
+    }
+    return Baseline;
+}
+
+int Engine::CpuBenchmark::Run(int argc, char **argv)
+{
+    std::string OutputPath, BaselinePath, Filter;
+    double Threshold = 10.0;
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        std::string Argument = argv[i];
+        if (Argument == "--output")
+            OutputPath = argv[++i];
+        else if (Argument == "--baseline")
+            BaselinePath = argv[++i];
+        else if (Argument == "--threshold")
+            Threshold = std::atof(argv[++i]);
+        else if (Argument == "--filter")
+            Filter = argv[++i];
+    }
+
+    if (!MockGL::Install())
+    {
+        std::cerr << "CpuBenchmark: Failed to install the mocked GL entry points" << std::endl;
+        return 1;
+    }
+    JobSystem::Initialize();
+
+    unsigned int Width = 1920, Height = 1080;
+    std::vector<Result> Results;
+    auto Add = [&](const std::string &Name, const std::function<void()> &Body)
+    {
+        if (Filter.empty() || Name.find(Filter) != std::string::npos)
+            Results.push_back(Measure(Name, Body));
+    };
+
+    // LoadMesh vertex and index extraction, 16 meshes of 128x128 vertices, GL uploads are mocked
+    aiScene *GridScene = CreateGridScene(16, 128);
+    Add("LoadMesh/Extract16x16k", [&]()
+    {
+        Model::Mesh Loaded = Model::LoadMesh(GridScene);
+        Sink = Sink + Loaded.Meshes.size();
+    });
+    delete GridScene;
+
+    // Culling, sorting and recording of 100 instances with 100 meshes each across 16 materials
+    std::vector<Material *> Materials;
+    for (int i = 0; i < 16; ++i)
+    {
+        Materials.push_back(new Material("Assets/Shaders/Deferred/Vert.glsl", "Assets/Shaders/Deferred/Frag.glsl"));
+        Materials.back()->SetSortOrder(i % 3);
+        Materials.back()->IsReady();
+    }
+
+    Model::Mesh SharedMesh;
+    for (unsigned int i = 0; i < 100; ++i)
+    {
+        Model::MeshData Data = {i + 1, 0, 0, 3 * 1024, static_cast<int>(i % Materials.size())};
+        Data.BoundsMin = glm::vec3(-1.0f) + glm::vec3(i % 10, 0.0f, i / 10) * 2.0f;
+        Data.BoundsMax = Data.BoundsMin + glm::vec3(1.5f);
+        SharedMesh.Meshes.push_back(Data);
+    }
+
+    std::vector<Model::ModelInstance> Instances;
+    Instances.reserve(100);
+    for (int i = 0; i < 100; ++i)
+    {
+        std::vector<Material *> MeshMaterials;
+        for (const Model::MeshData &Data : SharedMesh.Meshes)
+            MeshMaterials.push_back(Materials[(Data.MaterialIndex + i) % Materials.size()]);
+        glm::mat4 Transform = glm::translate(glm::mat4(1.0f), glm::vec3((i % 10) * 25.0f - 125.0f, 0.0f, -(i / 10) * 25.0f - 5.0f));
+        Instances.emplace_back(SharedMesh, MeshMaterials, Transform);
+    }
+
+    std::vector<Model::InstanceRef> Refs;
+    for (const Model::ModelInstance &Instance : Instances)
+        Refs.push_back({&Instance, Instance.Transform});
+
+    Camera View(Camera::CameraMode::Perspective, &Width, &Height);
+    View.SetPosition(glm::vec3(0.0f, -5.0f, 0.0f));
+    std::vector<CommandList> Lists;
+    uint64_t Frame = 0;
+    Add("RecordModelInstances/10k", [&]()
+    {
+        FrameArena::BeginFrame(++Frame);
+        Model::RecordModelInstances(Refs, View, Lists);
+        Sink = Sink + Lists.size();
+    });
+
+    // World matrix propagation through a 4-ary tree of 10k nodes, moving the root touches every node and
+    // moving a leaf's parent only its own children
+    TransformHierarchy Hierarchy;
+    Hierarchy.Reserve(10000);
+    for (int i = 0; i < 10000; ++i)
+        Hierarchy.Add(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.0f)), i == 0 ? TransformHierarchy::None : (i - 1) / 4);
+    Hierarchy.Update();
+    float Offset = 0.0f;
+    Add("Transform/UpdateAll10k", [&]()
+    {
+        Offset += 0.001f;
+        Hierarchy.SetLocal(0, glm::translate(glm::mat4(1.0f), glm::vec3(Offset, 0.0f, 0.0f)));
+        Sink = Sink + Hierarchy.Update();
+    });
+    Add("Transform/UpdateSubtree10k", [&]()
+    {
+        Offset += 0.001f;
+        Hierarchy.SetLocal(2000, glm::translate(glm::mat4(1.0f), glm::vec3(Offset, 0.0f, 0.0f)));
+        Sink = Sink + Hierarchy.Update();
+    });
+
+    // Text layout of a 256 character HUD block with the grid font
+    Material *FontMaterial = new Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Main/Frag.glsl");
+    Text *Font = new Text(FontMaterial, glm::vec2(0.0f), 32.0f, &Width, &Height);
+    std::string HUD;
+    for (int i = 0; i < 8; ++i)
+        HUD += "FPS: 144  Draw calls: 1234  Triangles: 262144\n";
+    HUD.resize(256, '#');
+    Text::VertexBuffer Vertices;
+    Add("Text/BuildGeometry256", [&]()
+    {
+        Vertices.clear();
+        Sink = Sink + Font->BuildGeometry(HUD, Text::TextAlign::Left, glm::vec2(10.0f), 32.0f, Vertices);
+    });
+
+    // Cached uniform location lookups, 16 names per op
+    Shader *Program = new Shader("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Deferred/Lighting.glsl", {});
+    Program->IsReady();
+    std::vector<std::string> UniformNames = {"Model", "View", "Projection", "ViewPosition", "NormalTexture", "PositionTexture",
+                                             "MetallicTexture", "RoughnessTexture", "EmissionTexture", "NumPointLights",
+                                             "NumDirectionalLights", "NumSpotLights", "PointLights[0].Color",
+                                             "PointLights[0].Position", "SpotLights[0].Cutoff", "DirectionalLights[0].Direction"};
+    Add("Shader/GetUniformLocation16", [&]()
+    {
+        int Sum = 0;
+        for (const std::string &Name : UniformNames)
+            Sum += Program->GetUniformLocation(Name);
+        Sink = Sink + Sum;
+    });
+
+    // The per-frame light upload of the deferred lighting pass, 16 point, 1 directional and 4 spot lights
+    Material *LightingMaterial = new Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Deferred/Lighting.glsl");
+    std::vector<Light> PointLights(16, {glm::vec3(1.0f), glm::vec3(0.0f), glm::vec3(1.0f), 1.0f, 0.0f, 0.0f});
+    std::vector<Light> DirectionalLights(1, {glm::vec3(0.0f), glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(1.0f), 2.0f, 0.0f, 0.0f});
+    std::vector<Light> SpotLights(4, {glm::vec3(1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f), 1.0f, 0.9f, 0.8f});
+    Add("Light/SetUniforms21", [&]()
+    {
+        Light::SetUniforms(LightingMaterial, PointLights, "PointLights");
+        Light::SetUniforms(LightingMaterial, DirectionalLights, "DirectionalLights");
+        Light::SetUniforms(LightingMaterial, SpotLights, "SpotLights");
+    });
+
+    float Angle = 0.0f;
+    Add("Camera/ViewProjection", [&]()
+    {
+        Angle += 0.001f;
+        View.SetRotation(glm::angleAxis(Angle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::mat4 ViewProjection = View.GetProjectionMatrix() * View.GetViewMatrix();
+        Sink = Sink + static_cast<size_t>(ViewProjection[3][3] != 0.0f);
+    });
+
+    delete LightingMaterial;
+    delete Program;
+    delete Font;
+    delete FontMaterial;
+    Lists.clear();
+    Instances.clear();
+    for (Material *Item : Materials)
+        delete Item;
+    JobSystem::Shutdown();
+
+    std::ostringstream Json;
+    WriteResults(Json, Results);
+    if (!OutputPath.empty())
+    {
+        std::ofstream File(OutputPath);
+        File << Json.str();
+        if (!File)
+            std::cerr << "CpuBenchmark: Could not write " << OutputPath << std::endl;
+    }
+
+    if (BaselinePath.empty())
+    {
+        std::cout << Json.str();
+        return 0;
+    }
+
+    std::unordered_map<std::string, double> Baseline = LoadBaseline(BaselinePath);
+    int Regressions = 0;
+    std::printf("\n%-32s %14s %14s %9s\n", "Benchmark", "ns/op", "Baseline", "Change");
+    for (const Result &Item : Results)
+    {
+        auto It = Baseline.find(Item.Name);
+        if (It == Baseline.end() || It->second <= 0.0)
+        {
+            std::printf("%-32s %14.2f %14s %9s\n", Item.Name.c_str(), Item.NanosecondsPerOp, "-", "new");
+            continue;
+        }
+
+        double Change = (Item.NanosecondsPerOp - It->second) / It->second * 100.0;
+        bool Regressed = Change > Threshold;
+        Regressions += Regressed ? 1 : 0;
+        std::printf("%-32s %14.2f %14.2f %+8.1f%%%s\n", Item.Name.c_str(), Item.NanosecondsPerOp, It->second, Change,
+                    Regressed ? "  REGRESSION" : "");
+    }
+
+    std::printf("\n%d regression%s over %.1f%%\n", Regressions, Regressions == 1 ? "" : "s", Threshold);
+    return Regressions > 0 ? 1 : 0;
+}
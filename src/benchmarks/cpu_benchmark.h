@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef cpu_benchmark_h
+#define cpu_benchmark_h
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "mock_gl.h"
+#include "../core/jobs/job_system.h"
+#include "../rendering/model/model.h"
+#include "../rendering/text/text.h"
+#include "../rendering/lighting/light.h"
+#include "../rendering/shaders/shader.h"
+
+namespace Engine
+{
+    // Times the CPU side of the engine's per-frame and loading hot paths against mocked GL, so it runs
+    // without a context. Run with --bench-cpu [--output <json>] [--baseline <json>] [--threshold <percent>]
+    // [--filter <text>]. With a baseline every case slower by more than the threshold is reported as a
+    // regression and the exit code is 1.
+    class CpuBenchmark
+    {
+    public:
+        static int Run(int argc, char **argv);
+
+    private:
+        struct Result
+        {
+            std::string Name;
+            size_t Iterations;       // Per sample
+            double NanosecondsPerOp; // Median over the samples
+            double MinNanosecondsPerOp;
+        };
+
+        static Result Measure(const std::string &Name, const std::function<void()> &Body);
+        static aiScene *CreateGridScene(unsigned int MeshCount, unsigned int GridSize);
+        static void WriteResults(std::ostream &Stream, const std::vector<Result> &Results);
+        static std::unordered_map<std::string, double> LoadBaseline(const std::string &Path);
+    };
+};
+
+#endif
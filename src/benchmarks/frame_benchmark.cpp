@@ -0,0 +1,199 @@
+#include "frame_benchmark.h"
+
+bool Engine::FrameBenchmark::ParseArguments(int argc, char **argv, Settings &Options)
+{
+    bool Enabled = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string Argument = argv[i];
+        bool HasValue = i + 1 < argc;
+
+        if (Argument == "--benchmark")
+            Enabled = true;
+        else if (Argument == "--headless")
+            Options.Headless = true;
+        else if (Argument == "--scene" && HasValue)
+            Options.Scene = argv[++i];
+        else if (Argument == "--camera-path" && HasValue)
+            Options.CameraPath = argv[++i];
+        else if (Argument == "--output" && HasValue)
+            Options.Output = argv[++i];
+        else if (Argument == "--frames" && HasValue)
+            Options.Frames = std::max(1, std::atoi(argv[++i]));
+        else if (Argument == "--warmup" && HasValue)
+            Options.Warmup = std::max(0, std::atoi(argv[++i]));
+        else if (Argument == "--sprites" && HasValue)
+            Options.Sprites = std::max(1, std::atoi(argv[++i]));
+        else if (Argument == "--depth-prepass" && HasValue)
+            Options.DepthPrepass = std::string(argv[++i]) == "on";
+        else if (Argument == "--dynamic-resolution" && HasValue)
+            Options.TargetFrameMs = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+        else if (Argument == "--resolution" && HasValue)
+        {
+            unsigned int Width = 0, Height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &Width, &Height) == 2 && Width > 0 && Height > 0)
+            {
+                Options.Width = Width;
+                Options.Height = Height;
+            }
+            else
+                std::cerr << "FrameBenchmark: Expected --resolution <width>x<height>, got " << argv[i] << std::endl;
+        }
+    }
+    return Enabled;
+}
+
+std::vector<Engine::FrameBenchmark::CameraKey> Engine::FrameBenchmark::LoadCameraPath(const std::string &Path)
+{
+    std::vector<CameraKey> Keys;
+    if (!Path.empty())
+    {
+        std::ifstream File(Path);
+        if (!File)
+            std::cerr << "FrameBenchmark: Could not open camera path " << Path << ", using the default orbit" << std::endl;
+
+        std::string Line;
+        while (std::getline(File, Line))
+        {
+            std::istringstream Stream(Line);
+            CameraKey Key;
+            if (Line.empty() || Line[0] == '#')
+                continue;
+            if (Stream >> Key.Position.x >> Key.Position.y >> Key.Position.z >> Key.Yaw >> Key.Pitch)
+                Keys.push_back(Key);
+        }
+    }
+
+    // Same motion as the interactive scene, one full turn over the run
+    if (Keys.empty())
+    {
+        for (int i = 0; i <= 8; ++i)
+            Keys.push_back({glm::vec3(0.0f, 0.0f, 1.0f), i * 45.0f, 0.0f});
+    }
+    return Keys;
+}
+
+void Engine::FrameBenchmark::SampleCameraPath(const std::vector<CameraKey> &Path, float Progress, glm::vec3 &Position, glm::quat &Rotation)
+{
+    float Scaled = glm::clamp(Progress, 0.0f, 1.0f) * static_cast<float>(Path.size() - 1);
+    size_t Index = std::min(static_cast<size_t>(Scaled), Path.size() - 1);
+    size_t Next = std::min(Index + 1, Path.size() - 1);
+    float Blend = Scaled - static_cast<float>(Index);
+
+    const CameraKey &A = Path[Index], &B = Path[Next];
+    Position = glm::mix(A.Position, B.Position, Blend);
+    float Yaw = glm::mix(A.Yaw, B.Yaw, Blend);
+    float Pitch = glm::mix(A.Pitch, B.Pitch, Blend);
+    Rotation = glm::angleAxis(glm::radians(Pitch), glm::vec3(1.0f, 0.0f, 0.0f)) * glm::angleAxis(glm::radians(Yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+Engine::FrameBenchmark::Statistics Engine::FrameBenchmark::Summarize(std::vector<double> Samples)
+{
+    if (Samples.empty())
+        return {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+
+    std::sort(Samples.begin(), Samples.end());
+    double Sum = 0.0;
+    for (double Sample : Samples)
+        Sum += Sample;
+
+    // Nearest rank, so every percentile is a frame that actually happened
+    auto Percentile = [&Samples](double P)
+    {
+        size_t Rank = static_cast<size_t>(std::ceil(P / 100.0 * Samples.size()));
+        return Samples[std::clamp<size_t>(Rank, 1, Samples.size()) - 1];
+    };
+    return {Samples.front(), Sum / Samples.size(), Percentile(50.0), Percentile(95.0), Percentile(99.0), Samples.back()};
+}
+
+void Engine::FrameBenchmark::WriteStatistics(std::ostream &Stream, const char *Name, const Statistics &Stats)
+{
+    Stream << "  \"" << Name << "\": {\"min\": " << Stats.Min << ", \"mean\": " << Stats.Mean << ", \"p50\": " << Stats.P50
+           << ", \"p95\": " << Stats.P95 << ", \"p99\": " << Stats.P99 << ", \"max\": " << Stats.Max << "}";
+}
+
+int Engine::FrameBenchmark::Run(const Settings &Options, const std::function<void(int, double, float)> &RenderFrame, const std::vector<Counter> &Counters)
+{
+    using Clock = std::chrono::steady_clock;
+    int TotalFrames = Options.Warmup + Options.Frames;
+
+    // One elapsed query per frame, read back after the run so measuring never waits on the GPU
+    std::vector<GLuint> Queries(TotalFrames);
+    glGenQueries(TotalFrames, Queries.data());
+    std::vector<double> CpuTimes, GpuTimes, Allocations;
+    CpuTimes.reserve(Options.Frames);
+    Allocations.reserve(Options.Frames);
+    std::vector<std::vector<double>> CounterValues(Counters.size());
+    for (std::vector<double> &Values : CounterValues)
+        Values.reserve(Options.Frames);
+
+    for (int Frame = 0; Frame < TotalFrames; ++Frame)
+    {
+        int Measured = Frame - Options.Warmup;
+        float Progress = (Measured <= 0 || Options.Frames == 1) ? 0.0f : static_cast<float>(Measured) / (Options.Frames - 1);
+
+        uint64_t AllocationsBefore = MemoryTracker::GetAllocationCount();
+        Clock::time_point Start = Clock::now();
+        glBeginQuery(GL_TIME_ELAPSED, Queries[Frame]);
+        RenderFrame(Frame, std::max(Measured, 0) * Options.TimeStep, Progress);
+        glEndQuery(GL_TIME_ELAPSED);
+        glFlush();
+        double CpuMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        if (Measured >= 0)
+        {
+            CpuTimes.push_back(CpuMilliseconds);
+            Allocations.push_back(static_cast<double>(MemoryTracker::GetAllocationCount() - AllocationsBefore));
+            for (size_t i = 0; i < Counters.size(); ++i)
+                CounterValues[i].push_back(Counters[i].Read());
+        }
+    }
+    glFinish();
+
+    for (int Frame = Options.Warmup; Frame < TotalFrames; ++Frame)
+    {
+        GLuint64 Nanoseconds = 0;
+        glGetQueryObjectui64v(Queries[Frame], GL_QUERY_RESULT, &Nanoseconds);
+        GpuTimes.push_back(Nanoseconds / 1.0e6);
+    }
+    glDeleteQueries(TotalFrames, Queries.data());
+
+    std::ostringstream Report;
+    Report << std::fixed << std::setprecision(4) << "{\n"
+           << "  \"scene\": \"" << Options.Scene << "\",\n";
+    if (!Options.SceneParameters.empty())
+        Report << "  \"scene_parameters\": " << Options.SceneParameters << ",\n";
+    Report << "  \"width\": " << Options.Width << ",\n"
+           << "  \"height\": " << Options.Height << ",\n"
+           << "  \"frames\": " << Options.Frames << ",\n"
+           << "  \"warmup\": " << Options.Warmup << ",\n"
+           << "  \"renderer\": \"" << reinterpret_cast<const char *>(glGetString(GL_RENDERER)) << "\",\n";
+    WriteStatistics(Report, "cpu_ms", Summarize(CpuTimes));
+    Report << ",\n";
+    WriteStatistics(Report, "gpu_ms", Summarize(GpuTimes));
+    Report << ",\n";
+    for (size_t i = 0; i < Counters.size(); ++i)
+    {
+        WriteStatistics(Report, Counters[i].Name.c_str(), Summarize(CounterValues[i]));
+        Report << ",\n";
+    }
+#if ENGINE_TRACK_ALLOCATIONS
+    WriteStatistics(Report, "heap_allocations", Summarize(Allocations));
+    Report << ",\n";
+#endif
+    MemoryTracker::WriteJson(Report, "  ");
+    Report << "\n}\n";
+
+    std::cout << Report.str();
+    if (!Options.Output.empty())
+    {
+        std::ofstream File(Options.Output);
+        if (!File)
+        {
+            std::cerr << "FrameBenchmark: Could not write " << Options.Output << std::endl;
+            return 1;
+        }
+        File << Report.str();
+    }
+    return 0;
+}
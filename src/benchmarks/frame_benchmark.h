@@ -0,0 +1,84 @@
+#pragma once
+
+#ifndef frame_benchmark_h
+#define frame_benchmark_h
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../core/memory/memory_tracker.h"
+
+namespace Engine
+{
+    // Renders a fixed number of frames along a fixed camera path with a fixed time step and reports CPU and
+    // GPU frame time percentiles as JSON, run with --benchmark. The caller owns the context and the scene,
+    // the harness only drives frames and measures them.
+    class FrameBenchmark
+    {
+    public:
+        struct Settings
+        {
+            std::string Scene = "Assets/Models/Sponza.obj";
+            std::string CameraPath; // Empty for the default orbit
+            std::string Output;     // Empty to only print the report
+            std::string SceneParameters; // JSON object describing a generated scene, added to the report when set
+            unsigned int Width = 1920;
+            unsigned int Height = 1080;
+            int Frames = 600;
+            int Warmup = 60;
+            double TimeStep = 1.0 / 60.0;
+            bool Headless = false; // Surfaceless EGL/OSMesa instead of a hidden GLFW window
+            float TargetFrameMs = 0.0f; // GPU budget of the dynamic resolution governor, 0 renders at full resolution
+            bool DepthPrepass = false;
+            int Sprites = 100000; // Sprites drawn per frame by the "sprites" scene
+        };
+
+        // One line per key: X Y Z Yaw Pitch (degrees), keys are spread evenly over the measured frames
+        struct CameraKey
+        {
+            glm::vec3 Position;
+            float Yaw;
+            float Pitch;
+        };
+
+        struct Statistics
+        {
+            double Min, Mean, P50, P95, P99, Max;
+        };
+
+        // Read after every measured frame and reported like the frame times, e.g. a GPU sample count
+        struct Counter
+        {
+            std::string Name;
+            std::function<double()> Read;
+        };
+
+        // Returns false when --benchmark is not on the command line
+        static bool ParseArguments(int argc, char **argv, Settings &Options);
+        static std::vector<CameraKey> LoadCameraPath(const std::string &Path);
+        // Position and rotation at Progress (0 to 1) along the path, in the Camera::SetPosition/SetRotation convention
+        static void SampleCameraPath(const std::vector<CameraKey> &Path, float Progress, glm::vec3 &Position, glm::quat &Rotation);
+
+        // Calls RenderFrame(FrameIndex, Time, Progress) for the warmup and measured frames, returns the exit code
+        static int Run(const Settings &Options, const std::function<void(int, double, float)> &RenderFrame, const std::vector<Counter> &Counters = {});
+
+        static Statistics Summarize(std::vector<double> Samples);
+
+    private:
+        static void WriteStatistics(std::ostream &Stream, const char *Name, const Statistics &Stats);
+    };
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "job_benchmark.h"
+
+Engine::JobBenchmark::Result Engine::JobBenchmark::Measure(unsigned int Workers, std::vector<glm::vec4> &Positions, std::vector<glm::vec4> &Output)
+{
+    using Clock = std::chrono::steady_clock;
+    const int Repeats = 10;
+    const size_t FineJobs = 100000;
+
+    JobSystem::Initialize(Workers);
+    Result Measurement = {Workers, 0.0, 0.0, 0};
+
+    glm::mat4 Transform = glm::rotate(glm::scale(glm::mat4(1.0f), glm::vec3(0.25f)), 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    // One untimed pass so every worker thread is up and the buffers are paged in
+    JobSystem::ParallelFor(Positions.size(), 4096, [&](size_t Begin, size_t End)
+                           { for (size_t i = Begin; i < End; ++i) Output[i] = Transform * Positions[i]; });
+
+    Clock::time_point Start = Clock::now();
+    for (int Repeat = 0; Repeat < Repeats; ++Repeat)
+    {
+        JobSystem::ParallelFor(Positions.size(), 4096, [&](size_t Begin, size_t End)
+                               {
+                                   for (size_t i = Begin; i < End; ++i)
+                                   {
+                                       glm::vec4 P = Transform * Positions[i];
+                                       Output[i] = P / glm::max(glm::length(glm::vec3(P)), 0.0001f);
+                                   }
+                               });
+    }
+    Measurement.CoarseMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count() / Repeats;
+
+    std::vector<float> Sums(FineJobs);
+    Start = Clock::now();
+    JobCounter Counter;
+    for (size_t i = 0; i < FineJobs; ++i)
+    {
+        JobSystem::Run([&Sums, &Positions, i]()
+                       { Sums[i] = glm::dot(Positions[i % Positions.size()], Positions[(i * 7) % Positions.size()]); },
+                       &Counter);
+    }
+    JobSystem::Wait(Counter);
+    Measurement.FineMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    Measurement.Steals = JobSystem::GetStealCount();
+    JobSystem::Shutdown();
+    return Measurement;
+}
+
+int Engine::JobBenchmark::Run(unsigned int MaxWorkers)
+{
+    if (MaxWorkers == 0)
+        MaxWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    // 4M vertices, about the size of a large imported scene
+    std::vector<glm::vec4> Positions(1 << 22), Output(Positions.size());
+    for (size_t i = 0; i < Positions.size(); ++i)
+        Positions[i] = glm::vec4(static_cast<float>(i % 1024), static_cast<float>(i / 1024 % 1024), static_cast<float>(i % 7), 1.0f);
+
+    std::vector<Result> Results;
+    for (unsigned int Workers = 1; Workers <= MaxWorkers; Workers = (Workers < MaxWorkers && Workers * 2 > MaxWorkers) ? MaxWorkers : Workers * 2)
+    {
+        Results.push_back(Measure(Workers, Positions, Output));
+        if (Workers == MaxWorkers)
+            break;
+    }
+
+    std::printf("\n%8s %12s %9s %11s %14s %8s\n", "Workers", "Coarse ms", "Speedup", "Efficiency", "100k jobs ms", "Steals");
+    for (const Result &Measurement : Results)
+    {
+        double Speedup = Results[0].CoarseMilliseconds / Measurement.CoarseMilliseconds;
+        std::printf("%8u %12.2f %8.2fx %10.0f%% %14.2f %8zu\n", Measurement.Workers, Measurement.CoarseMilliseconds,
+                    Speedup, Speedup / Measurement.Workers * 100.0, Measurement.FineMilliseconds, Measurement.Steals);
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef job_benchmark_h
+#define job_benchmark_h
+
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../core/jobs/job_system.h"
+
+namespace Engine
+{
+    // Measures how the job system scales from one worker up to every hardware thread, run with --bench-jobs
+    class JobBenchmark
+    {
+    public:
+        static int Run(unsigned int MaxWorkers = 0);
+
+    private:
+        struct Result
+        {
+            unsigned int Workers;
+            double CoarseMilliseconds; // Vertex transform in 4096 vertex chunks
+            double FineMilliseconds;   // Many tiny jobs, dominated by scheduling overhead
+            size_t Steals;
+        };
+
+        static Result Measure(unsigned int Workers, std::vector<glm::vec4> &Positions, std::vector<glm::vec4> &Output);
+    };
+};
+
+#endif
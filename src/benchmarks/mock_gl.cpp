@@ -0,0 +1,136 @@
+#include "mock_gl.h"
+
+namespace
+{
+    GLuint NextName = 1;
+    std::vector<unsigned char> MappedScratch;
+
+    // Stands in for every entry point without a dedicated mock. Arguments are ignored and the zero return
+    // covers integer and pointer results, which is fine for the caller-cleans-up 64-bit calling conventions.
+    GLuint64 APIENTRY ReturnZero()
+    {
+        return 0;
+    }
+
+    const GLubyte *APIENTRY GetString(GLenum Name)
+    {
+        const char *Value = (Name == GL_VERSION) ? "4.6.0 Mock" : (Name == GL_SHADING_LANGUAGE_VERSION) ? "4.60 Mock" : "Mock";
+        return reinterpret_cast<const GLubyte *>(Value);
+    }
+
+    const GLubyte *APIENTRY GetStringi(GLenum, GLuint)
+    {
+        return reinterpret_cast<const GLubyte *>("GL_MOCK_extension");
+    }
+
+    // glad gives up on a context without extensions, so one placeholder is reported
+    void APIENTRY GetIntegerv(GLenum Name, GLint *Data)
+    {
+        *Data = (Name == GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT) ? 256 : (Name == GL_NUM_EXTENSIONS) ? 1 : 0;
+    }
+
+    void APIENTRY GetInteger64v(GLenum, GLint64 *Data)
+    {
+        *Data = 0;
+    }
+
+    GLuint APIENTRY CreateObject(GLenum)
+    {
+        return NextName++;
+    }
+
+    GLuint APIENTRY CreateProgram()
+    {
+        return NextName++;
+    }
+
+    void APIENTRY GenObjects(GLsizei Count, GLuint *Names)
+    {
+        for (GLsizei i = 0; i < Count; ++i)
+            Names[i] = NextName++;
+    }
+
+    void APIENTRY GetObjectiv(GLuint, GLenum Name, GLint *Value)
+    {
+        *Value = (Name == GL_COMPILE_STATUS || Name == GL_LINK_STATUS || Name == 0x91B1 /* GL_COMPLETION_STATUS_KHR */) ? 1 : 0;
+    }
+
+    void APIENTRY GetInfoLog(GLuint, GLsizei Size, GLsizei *Length, GLchar *Log)
+    {
+        if (Length)
+            *Length = 0;
+        if (Size > 0)
+            Log[0] = '\0';
+    }
+
+    // Stable per name so lookups behave like a real program, never -1 so nothing is reported missing
+    GLint APIENTRY GetUniformLocation(GLuint, const GLchar *Name)
+    {
+        GLuint Hash = 2166136261u;
+        for (const GLchar *C = Name; *C; ++C)
+            Hash = (Hash ^ static_cast<unsigned char>(*C)) * 16777619u;
+        return static_cast<GLint>(Hash % 1024);
+    }
+
+    GLuint APIENTRY GetUniformBlockIndex(GLuint, const GLchar *)
+    {
+        return GL_INVALID_INDEX;
+    }
+
+    void APIENTRY GetQueryObjectuiv(GLuint, GLenum, GLuint *Value)
+    {
+        *Value = 1;
+    }
+
+    void APIENTRY GetQueryObjectui64v(GLuint, GLenum, GLuint64 *Value)
+    {
+        *Value = 0;
+    }
+
+    void *APIENTRY MapBufferRange(GLenum, GLintptr, GLsizeiptr Length, GLbitfield)
+    {
+        if (MappedScratch.size() < static_cast<size_t>(Length))
+            MappedScratch.resize(Length);
+        return MappedScratch.data();
+    }
+
+    GLenum APIENTRY CheckFramebufferStatus(GLenum)
+    {
+        return GL_FRAMEBUFFER_COMPLETE;
+    }
+}
+
+void *Engine::MockGL::GetProcAddress(const char *Name)
+{
+    static const std::unordered_map<std::string, void *> Mocks = {
+        {"glGetString", reinterpret_cast<void *>(&GetString)},
+        {"glGetStringi", reinterpret_cast<void *>(&GetStringi)},
+        {"glGetIntegerv", reinterpret_cast<void *>(&GetIntegerv)},
+        {"glGetInteger64v", reinterpret_cast<void *>(&GetInteger64v)},
+        {"glCreateShader", reinterpret_cast<void *>(&CreateObject)},
+        {"glCreateProgram", reinterpret_cast<void *>(&CreateProgram)},
+        {"glGenBuffers", reinterpret_cast<void *>(&GenObjects)},
+        {"glGenVertexArrays", reinterpret_cast<void *>(&GenObjects)},
+        {"glGenTextures", reinterpret_cast<void *>(&GenObjects)},
+        {"glGenQueries", reinterpret_cast<void *>(&GenObjects)},
+        {"glGenFramebuffers", reinterpret_cast<void *>(&GenObjects)},
+        {"glGenRenderbuffers", reinterpret_cast<void *>(&GenObjects)},
+        {"glGetShaderiv", reinterpret_cast<void *>(&GetObjectiv)},
+        {"glGetProgramiv", reinterpret_cast<void *>(&GetObjectiv)},
+        {"glGetShaderInfoLog", reinterpret_cast<void *>(&GetInfoLog)},
+        {"glGetProgramInfoLog", reinterpret_cast<void *>(&GetInfoLog)},
+        {"glGetUniformLocation", reinterpret_cast<void *>(&GetUniformLocation)},
+        {"glGetUniformBlockIndex", reinterpret_cast<void *>(&GetUniformBlockIndex)},
+        {"glGetQueryObjectuiv", reinterpret_cast<void *>(&GetQueryObjectuiv)},
+        {"glGetQueryObjectui64v", reinterpret_cast<void *>(&GetQueryObjectui64v)},
+        {"glMapBufferRange", reinterpret_cast<void *>(&MapBufferRange)},
+        {"glCheckFramebufferStatus", reinterpret_cast<void *>(&CheckFramebufferStatus)}};
+
+    auto It = Mocks.find(Name);
+    return (It != Mocks.end()) ? It->second : reinterpret_cast<void *>(&ReturnZero);
+}
+
+bool Engine::MockGL::Install()
+{
+    return gladLoadGLLoader(&MockGL::GetProcAddress) != 0;
+}
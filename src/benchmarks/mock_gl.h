@@ -0,0 +1,27 @@
+#pragma once
+
+#ifndef mock_gl_h
+#define mock_gl_h
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+#include <glad/glad.h>
+
+namespace Engine
+{
+    // Loads glad with stand-in entry points so CPU-side engine code runs without a context. Object creation
+    // hands out increasing names, status queries report success and everything else does nothing and
+    // returns zero. Only for benchmarks, nothing is ever drawn.
+    class MockGL
+    {
+    public:
+        static bool Install();
+
+    private:
+        static void *GetProcAddress(const char *Name);
+    };
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "stress_scene.h"
+
+void Engine::StressScene::ParseArguments(int argc, char **argv, Settings &Options)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        std::string Argument = argv[i];
+        const char *Value = argv[i + 1];
+
+        if (Argument == "--stress-seed")
+            Options.Seed = static_cast<uint32_t>(std::strtoul(Value, nullptr, 10));
+        else if (Argument == "--stress-instances")
+            Options.Instances = std::clamp(std::atoi(Value), 1, 1000000);
+        else if (Argument == "--stress-meshes")
+            Options.UniqueMeshes = std::max(1, std::atoi(Value));
+        else if (Argument == "--stress-materials")
+            Options.Materials = std::max(1, std::atoi(Value));
+        else if (Argument == "--stress-textures")
+            Options.Textures = std::max(0, std::atoi(Value));
+        else if (Argument == "--stress-point-lights")
+            Options.PointLights = std::max(0, std::atoi(Value));
+        else if (Argument == "--stress-spot-lights")
+            Options.SpotLights = std::max(0, std::atoi(Value));
+        else if (Argument == "--stress-directional-lights")
+            Options.DirectionalLights = std::max(0, std::atoi(Value));
+        else if (Argument == "--stress-transparent")
+            Options.TransparentRatio = std::clamp(static_cast<float>(std::atof(Value)), 0.0f, 1.0f);
+        else
+            continue;
+        ++i;
+    }
+}
+
+Engine::StressScene::StressScene(const Settings &Options) : Options(Options), Generator(Options.Seed)
+{
+    // Each step draws from the generator in a fixed order, changing one only reshuffles the steps after it
+    CreateMeshes();
+    CreateTextures();
+    CreateMaterials();
+    CreateInstances();
+    CreateLights();
+
+    std::cout << "StressScene: " << Instances.size() << " instances of " << Meshes.Meshes.size() << " meshes, "
+              << OpaqueMaterials.size() << " opaque and " << TransparentMaterials.size() << " transparent materials, "
+              << Textures.size() << " textures, " << Prototypes.size() << " mesh/material pairs" << std::endl;
+}
+
+Engine::StressScene::~StressScene()
+{
+    // Materials unload the textures they hold, deleting a shared one again later is ignored by GL
+    for (Material *Mat : OpaqueMaterials)
+        delete Mat;
+    for (Material *Mat : TransparentMaterials)
+        delete Mat;
+    Model::UnloadMesh(Meshes);
+}
+
+float Engine::StressScene::Random(float Min, float Max)
+{
+    return Min + (Max - Min) * static_cast<float>(Generator() >> 8) * (1.0f / 16777216.0f);
+}
+
+int Engine::StressScene::RandomIndex(int Count)
+{
+    return static_cast<int>((static_cast<uint64_t>(Generator()) * static_cast<uint64_t>(Count)) >> 32);
+}
+
+glm::vec3 Engine::StressScene::RandomColor()
+{
+    float R = Random(0.2f, 1.0f);
+    float G = Random(0.2f, 1.0f);
+    float B = Random(0.2f, 1.0f);
+    return glm::vec3(R, G, B);
+}
+
+void Engine::StressScene::CreateMeshes()
+{
+    // Alternating spheres and boxes of growing tessellation, all fitting the unit cube
+    aiScene *Scene = new aiScene();
+    Scene->mRootNode = new aiNode();
+    Scene->mNumMaterials = 1;
+    Scene->mMaterials = new aiMaterial *[1]{new aiMaterial()};
+    Scene->mNumMeshes = Options.UniqueMeshes;
+    Scene->mMeshes = new aiMesh *[Options.UniqueMeshes];
+
+    for (int MeshIndex = 0; MeshIndex < Options.UniqueMeshes; ++MeshIndex)
+    {
+        aiMesh *Shape = new aiMesh();
+        std::vector<aiVector3D> Positions, Normals, UVs;
+        std::vector<unsigned int> Indices;
+
+        if (MeshIndex % 2 == 0)
+        {
+            unsigned int Rings = 4 + 2 * ((MeshIndex / 2) % 8);
+            unsigned int Segments = Rings * 2;
+            for (unsigned int Ring = 0; Ring <= Rings; ++Ring)
+            {
+                float Theta = glm::pi<float>() * Ring / Rings;
+                for (unsigned int Segment = 0; Segment <= Segments; ++Segment)
+                {
+                    float Phi = glm::two_pi<float>() * Segment / Segments;
+                    aiVector3D Normal(std::sin(Theta) * std::cos(Phi), std::cos(Theta), std::sin(Theta) * std::sin(Phi));
+                    Positions.push_back(Normal * 0.5f);
+                    Normals.push_back(Normal);
+                    UVs.push_back(aiVector3D(static_cast<float>(Segment) / Segments, 1.0f - static_cast<float>(Ring) / Rings, 0.0f));
+                }
+            }
+            for (unsigned int Ring = 0; Ring < Rings; ++Ring)
+            {
+                for (unsigned int Segment = 0; Segment < Segments; ++Segment)
+                {
+                    unsigned int Corner = Ring * (Segments + 1) + Segment;
+                    Indices.insert(Indices.end(), {Corner, Corner + 1, Corner + Segments + 1, Corner + 1, Corner + Segments + 2, Corner + Segments + 1});
+                }
+            }
+        }
+        else
+        {
+            // Each face is split into a grid so box meshes also vary in vertex count
+            unsigned int Cells = 1 + (MeshIndex / 2) % 8;
+            for (int Face = 0; Face < 6; ++Face)
+            {
+                glm::vec3 Normal(0.0f);
+                Normal[Face / 2] = (Face % 2 == 0) ? 1.0f : -1.0f;
+                glm::vec3 Tangent(0.0f), Bitangent;
+                Tangent[(Face / 2 + 1) % 3] = 1.0f;
+                Bitangent = glm::cross(Normal, Tangent);
+
+                unsigned int Base = static_cast<unsigned int>(Positions.size());
+                for (unsigned int Y = 0; Y <= Cells; ++Y)
+                {
+                    for (unsigned int X = 0; X <= Cells; ++X)
+                    {
+                        float U = static_cast<float>(X) / Cells, V = static_cast<float>(Y) / Cells;
+                        glm::vec3 Position = Normal * 0.5f + Tangent * (U - 0.5f) + Bitangent * (V - 0.5f);
+                        Positions.push_back(aiVector3D(Position.x, Position.y, Position.z));
+                        Normals.push_back(aiVector3D(Normal.x, Normal.y, Normal.z));
+                        UVs.push_back(aiVector3D(U, V, 0.0f));
+                    }
+                }
+                for (unsigned int Y = 0; Y < Cells; ++Y)
+                {
+                    for (unsigned int X = 0; X < Cells; ++X)
+                    {
+                        unsigned int Corner = Base + Y * (Cells + 1) + X;
+                        Indices.insert(Indices.end(), {Corner, Corner + 1, Corner + Cells + 2, Corner, Corner + Cells + 2, Corner + Cells + 1});
+                    }
+                }
+            }
+        }
+
+        Shape->mNumVertices = static_cast<unsigned int>(Positions.size());
+        Shape->mVertices = new aiVector3D[Shape->mNumVertices];
+        Shape->mNormals = new aiVector3D[Shape->mNumVertices];
+        Shape->mTextureCoords[0] = new aiVector3D[Shape->mNumVertices];
+        Shape->mNumUVComponents[0] = 2;
+        std::copy(Positions.begin(), Positions.end(), Shape->mVertices);
+        std::copy(Normals.begin(), Normals.end(), Shape->mNormals);
+        std::copy(UVs.begin(), UVs.end(), Shape->mTextureCoords[0]);
+
+        Shape->mNumFaces = static_cast<unsigned int>(Indices.size() / 3);
+        Shape->mFaces = new aiFace[Shape->mNumFaces];
+        for (unsigned int Face = 0; Face < Shape->mNumFaces; ++Face)
+        {
+            Shape->mFaces[Face].mNumIndices = 3;
+            Shape->mFaces[Face].mIndices = new unsigned int[3]{Indices[Face * 3], Indices[Face * 3 + 1], Indices[Face * 3 + 2]};
+        }
+        Scene->mMeshes[MeshIndex] = Shape;
+    }
+
+    Meshes = Model::LoadMesh(Scene);
+    delete Scene;
+}
+
+void Engine::StressScene::CreateTextures()
+{
+    const int Size = 64;
+    std::vector<unsigned char> Pixels(Size * Size * 4);
+    for (int TextureIndex = 0; TextureIndex < Options.Textures; ++TextureIndex)
+    {
+        // Two-colour checker with a random cell size
+        glm::vec3 A = RandomColor() * 255.0f, B = RandomColor() * 255.0f;
+        int Cell = 2 << RandomIndex(4);
+        for (int Y = 0; Y < Size; ++Y)
+        {
+            for (int X = 0; X < Size; ++X)
+            {
+                const glm::vec3 &Color = ((X / Cell + Y / Cell) % 2 == 0) ? A : B;
+                unsigned char *Pixel = &Pixels[(Y * Size + X) * 4];
+                Pixel[0] = static_cast<unsigned char>(Color.r);
+                Pixel[1] = static_cast<unsigned char>(Color.g);
+                Pixel[2] = static_cast<unsigned char>(Color.b);
+                Pixel[3] = 255;
+            }
+        }
+        Textures.push_back(Util::LoadTextureFromData(Pixels.data(), Size, Size, 4));
+    }
+}
+
+void Engine::StressScene::CreateMaterials()
+{
+    // Opaque and transparent instances draw from separate pools so the ratio never changes the material count,
+    // except that each pool in use gets at least one material
+    int TransparentCount = 0;
+    if (Options.TransparentRatio >= 1.0f)
+        TransparentCount = Options.Materials;
+    else if (Options.TransparentRatio > 0.0f)
+        TransparentCount = std::clamp(static_cast<int>(std::lround(Options.Materials * Options.TransparentRatio)), 1, std::max(1, Options.Materials - 1));
+    int OpaqueCount = std::max(Options.TransparentRatio < 1.0f ? 1 : 0, Options.Materials - TransparentCount);
+
+    for (int i = 0; i < OpaqueCount + TransparentCount; ++i)
+    {
+        bool Transparent = i >= OpaqueCount;
+        Material *NewMaterial = new Material("Assets/Shaders/Deferred/Vert.glsl", "Assets/Shaders/Deferred/Frag.glsl");
+        NewMaterial->SetUniform("Color", glm::vec4(RandomColor(), Transparent ? 0.5f : 1.0f));
+        if (!Textures.empty())
+        {
+            NewMaterial->SetTexture(0, Textures[i % Textures.size()]);
+            NewMaterial->EnableKeyword("USE_TEXTURE");
+        }
+        if (Transparent)
+        {
+            NewMaterial->SetSortOrder(1);
+            NewMaterial->SetBlendingMode(Material::BlendingMode::AlphaBlend);
+            NewMaterial->SetDepthSortingMode(Material::DepthSortingMode::Read);
+            NewMaterial->SetAlphaTest(true);
+        }
+        NewMaterial->Compile();
+        (Transparent ? TransparentMaterials : OpaqueMaterials).push_back(NewMaterial);
+    }
+}
+
+void Engine::StressScene::CreateInstances()
+{
+    // Scattered through a cube whose volume grows with the count, so density stays the same at every scale
+    float Extent = 3.0f * std::cbrt(static_cast<float>(Options.Instances)) * 0.5f;
+    std::unordered_map<uint64_t, const Model::ModelInstance *> PrototypeLookup;
+    Instances.reserve(Options.Instances);
+
+    for (int i = 0; i < Options.Instances; ++i)
+    {
+        bool Transparent = TransparentMaterials.size() > 0 && (OpaqueMaterials.empty() || Random(0.0f, 1.0f) < Options.TransparentRatio);
+        std::vector<Material *> &Pool = Transparent ? TransparentMaterials : OpaqueMaterials;
+        int MeshIndex = RandomIndex(static_cast<int>(Meshes.Meshes.size()));
+        int MaterialIndex = RandomIndex(static_cast<int>(Pool.size()));
+
+        uint64_t Key = (static_cast<uint64_t>(MeshIndex) << 32) | (static_cast<uint64_t>(Transparent) << 31) | static_cast<uint64_t>(MaterialIndex);
+        auto It = PrototypeLookup.find(Key);
+        if (It == PrototypeLookup.end())
+        {
+            // Prototypes share the uploaded buffers, only Meshes owns and unloads them
+            Model::Mesh Single;
+            Single.Meshes.push_back(Meshes.Meshes[MeshIndex]);
+            Prototypes.emplace_back(Single, std::vector<Material *>{Pool[MaterialIndex]});
+            It = PrototypeLookup.emplace(Key, &Prototypes.back()).first;
+        }
+
+        float X = Random(-Extent, Extent);
+        float Y = Random(-Extent, Extent);
+        float Z = Random(-Extent, Extent);
+        float Angle = Random(0.0f, glm::two_pi<float>());
+        float Scale = Random(0.5f, 1.5f);
+        float AxisX = Random(-1.0f, 1.0f);
+        float AxisY = Random(-1.0f, 1.0f);
+        float AxisZ = Random(-1.0f, 1.0f);
+        glm::vec3 Axis = glm::normalize(glm::vec3(AxisX, AxisY + 1e-3f, AxisZ));
+
+        glm::mat4 Transform = glm::translate(glm::mat4(1.0f), glm::vec3(X, Y, Z));
+        Transform = glm::rotate(Transform, Angle, Axis);
+        Transform = glm::scale(Transform, glm::vec3(Scale));
+        Instances.push_back({It->second, Transform});
+    }
+}
+
+void Engine::StressScene::CreateLights()
+{
+    float Extent = 3.0f * std::cbrt(static_cast<float>(Options.Instances)) * 0.5f;
+    auto RandomPosition = [&]()
+    {
+        float X = Random(-Extent, Extent);
+        float Y = Random(-Extent, Extent);
+        float Z = Random(-Extent, Extent);
+        return glm::vec3(X, Y, Z);
+    };
+    auto RandomDirection = [&]()
+    {
+        float X = Random(-1.0f, 1.0f);
+        float Y = Random(-1.0f, -0.2f);
+        float Z = Random(-1.0f, 1.0f);
+        return glm::normalize(glm::vec3(X, Y, Z));
+    };
+
+    for (int i = 0; i < Options.PointLights; ++i)
+    {
+        glm::vec3 Position = RandomPosition();
+        PointLights.push_back({Position, {}, RandomColor(), Random(1.0f, 5.0f), 0, 0});
+    }
+    for (int i = 0; i < Options.SpotLights; ++i)
+    {
+        glm::vec3 Position = RandomPosition();
+        glm::vec3 Direction = RandomDirection();
+        float Inner = Random(10.0f, 25.0f);
+        SpotLights.push_back({Position, Direction, RandomColor(), Random(2.0f, 8.0f), std::cos(glm::radians(Inner)), std::cos(glm::radians(Inner + 5.0f))});
+    }
+    for (int i = 0; i < Options.DirectionalLights; ++i)
+    {
+        glm::vec3 Direction = RandomDirection();
+        DirectionalLights.push_back({{}, Direction, RandomColor(), Random(0.5f, 2.0f), 0, 0});
+    }
+
+    for (const std::vector<Light> *Lights : {&PointLights, &SpotLights, &DirectionalLights})
+    {
+        if (Lights->size() > static_cast<size_t>(Light::MaxPerType))
+        {
+            std::cout << "StressScene: " << Lights->size() << " lights of one type requested, the lighting pass shades the first "
+                      << Light::MaxPerType << std::endl;
+            break;
+        }
+    }
+}
+
+const std::vector<Engine::Model::InstanceRef> &Engine::StressScene::GetInstances() const
+{
+    return Instances;
+}
+
+const std::vector<Engine::Light> &Engine::StressScene::GetPointLights() const
+{
+    return PointLights;
+}
+
+const std::vector<Engine::Light> &Engine::StressScene::GetSpotLights() const
+{
+    return SpotLights;
+}
+
+const std::vector<Engine::Light> &Engine::StressScene::GetDirectionalLights() const
+{
+    return DirectionalLights;
+}
+
+std::string Engine::StressScene::Describe() const
+{
+    std::ostringstream Stream;
+    Stream << "{\"seed\": " << Options.Seed << ", \"instances\": " << Options.Instances << ", \"meshes\": " << Options.UniqueMeshes
+           << ", \"materials\": " << OpaqueMaterials.size() + TransparentMaterials.size() << ", \"textures\": " << Options.Textures
+           << ", \"point_lights\": " << Options.PointLights << ", \"spot_lights\": " << Options.SpotLights
+           << ", \"directional_lights\": " << Options.DirectionalLights << ", \"transparent_ratio\": " << Options.TransparentRatio
+           << ", \"mesh_material_pairs\": " << Prototypes.size() << "}";
+    return Stream.str();
+}
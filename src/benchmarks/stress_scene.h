@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef stress_scene_h
+#define stress_scene_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "../rendering/model/model.h"
+#include "../rendering/lighting/light.h"
+#include "../rendering/materials/material.h"
+
+namespace Engine
+{
+    // Procedural scene for scaling tests, run with --benchmark --scene stress. Every dimension (instances,
+    // unique meshes, materials, textures, lights per type and the transparent share) is a parameter and the
+    // whole scene follows from the seed, so runs on different machines and builds draw the same thing.
+    // Needs a current GL context, meshes and textures are uploaded in the constructor.
+    class StressScene
+    {
+    public:
+        struct Settings
+        {
+            uint32_t Seed = 1234;
+            int Instances = 10000; // 1 to 1M
+            int UniqueMeshes = 16;
+            int Materials = 32;
+            int Textures = 8;
+            int PointLights = 16;
+            int SpotLights = 4;
+            int DirectionalLights = 1;
+            float TransparentRatio = 0.1f; // Share of instances drawn with a blended material
+        };
+
+        // Reads the --stress-* options, anything missing keeps its default
+        static void ParseArguments(int argc, char **argv, Settings &Options);
+
+        StressScene(const Settings &Options);
+        ~StressScene();
+
+        // Stable for the lifetime of the scene, so it can be recorded every frame without copying
+        const std::vector<Model::InstanceRef> &GetInstances() const;
+        const std::vector<Light> &GetPointLights() const;
+        const std::vector<Light> &GetSpotLights() const;
+        const std::vector<Light> &GetDirectionalLights() const;
+        // The parameters as a JSON object, for the benchmark report
+        std::string Describe() const;
+
+    private:
+        Settings Options;
+        std::mt19937 Generator;
+
+        Model::Mesh Meshes;
+        std::vector<unsigned int> Textures;
+        std::vector<Material *> OpaqueMaterials, TransparentMaterials;
+        // One prototype per mesh and material pair in use, a deque keeps the addresses the refs point at
+        std::deque<Model::ModelInstance> Prototypes;
+        std::vector<Model::InstanceRef> Instances;
+        std::vector<Light> PointLights, SpotLights, DirectionalLights;
+
+        // Built from the raw engine output, the standard distributions differ between standard libraries
+        float Random(float Min, float Max);
+        int RandomIndex(int Count);
+        glm::vec3 RandomColor();
+
+        void CreateMeshes();
+        void CreateTextures();
+        void CreateMaterials();
+        void CreateInstances();
+        void CreateLights();
+    };
+};
+
+#endif
@@ -0,0 +1,299 @@
+#include "job_system.h"
+
+namespace
+{
+    thread_local int CurrentWorker = -1;
+}
+
+std::vector<std::unique_ptr<Engine::JobSystem::Worker>> Engine::JobSystem::Workers;
+std::vector<std::thread> Engine::JobSystem::Threads;
+std::mutex Engine::JobSystem::MainMutex;
+std::vector<Engine::JobSystem::Job> Engine::JobSystem::MainJobs;
+std::mutex Engine::JobSystem::SleepMutex;
+std::condition_variable Engine::JobSystem::WakeUp;
+std::atomic<int> Engine::JobSystem::QueuedJobs{0};
+std::atomic<int> Engine::JobSystem::Sleepers{0};
+std::atomic<bool> Engine::JobSystem::Running{false};
+std::atomic<unsigned int> Engine::JobSystem::NextWorker{0};
+std::atomic<size_t> Engine::JobSystem::Steals{0};
+std::atomic<std::thread::id> Engine::JobSystem::MainThreadID{std::this_thread::get_id()};
+
+void Engine::JobSystem::Initialize(unsigned int WorkerCount)
+{
+    if (Running)
+        Shutdown();
+
+    if (WorkerCount == 0)
+        WorkerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    MainThreadID = std::this_thread::get_id();
+    CurrentWorker = 0;
+    Steals = 0;
+
+    Workers.clear();
+    for (unsigned int i = 0; i < WorkerCount; ++i)
+        Workers.push_back(std::make_unique<Worker>());
+
+    Running = true;
+    for (unsigned int i = 1; i < WorkerCount; ++i)
+        Threads.emplace_back(WorkerLoop, i);
+
+    std::cout << "JobSystem: Started " << WorkerCount << " workers (including the main thread)" << std::endl;
+}
+
+void Engine::JobSystem::Shutdown()
+{
+    if (!Running)
+        return;
+
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        Running = false;
+    }
+    WakeUp.notify_all();
+
+    for (std::thread &Thread : Threads)
+        Thread.join();
+    Threads.clear();
+
+    // Anything still queued was never waited on, run it inline rather than dropping side effects
+    std::vector<std::unique_ptr<Worker>> Remaining;
+    Remaining.swap(Workers);
+    QueuedJobs = 0;
+    for (std::unique_ptr<Worker> &Queue : Remaining)
+    {
+        for (Job &Function : Queue->Jobs)
+            Function();
+    }
+    PumpMainThread();
+}
+
+Engine::JobSystem::Job Engine::JobSystem::Wrap(Job Function, JobCounter *Signal)
+{
+    if (Signal)
+        Signal->Pending.fetch_add(1, std::memory_order_relaxed);
+
+    return [Function = std::move(Function), Signal]()
+    {
+        Function();
+        Finish(Signal);
+    };
+}
+
+void Engine::JobSystem::Finish(JobCounter *Signal)
+{
+    if (!Signal)
+        return;
+
+    // Decrement under the lock so a Run() holding back a continuation can not miss the counter reaching zero
+    std::vector<Job> Ready;
+    {
+        std::lock_guard<std::mutex> Lock(Signal->Mutex);
+        if (Signal->Pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            Ready.swap(Signal->Continuations);
+    }
+
+    for (Job &Continuation : Ready)
+        Push(std::move(Continuation));
+}
+
+void Engine::JobSystem::Push(Job Function)
+{
+    if (Workers.empty())
+    {
+        Function();
+        return;
+    }
+
+    unsigned int Index = (CurrentWorker >= 0) ? CurrentWorker : NextWorker.fetch_add(1, std::memory_order_relaxed) % Workers.size();
+    {
+        std::lock_guard<std::mutex> Lock(Workers[Index]->Mutex);
+        Workers[Index]->Jobs.push_back(std::move(Function));
+    }
+
+    // Both counters are sequentially consistent, either the pusher sees the sleeper or the sleeper sees the job
+    QueuedJobs.fetch_add(1);
+    if (Sleepers.load() > 0)
+    {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        WakeUp.notify_one();
+    }
+}
+
+bool Engine::JobSystem::TryRunOne(unsigned int Index)
+{
+    if (Workers.empty())
+        return false;
+
+    Job Function;
+    Index %= Workers.size();
+
+    // Newest job of our own deque first, it is the one most likely to still be in cache
+    {
+        Worker &Own = *Workers[Index];
+        std::lock_guard<std::mutex> Lock(Own.Mutex);
+        if (!Own.Jobs.empty())
+        {
+            Function = std::move(Own.Jobs.back());
+            Own.Jobs.pop_back();
+        }
+    }
+
+    // Otherwise steal the oldest job of another worker, it tends to be the largest remaining chunk
+    for (size_t Offset = 1; !Function && Offset < Workers.size(); ++Offset)
+    {
+        Worker &Victim = *Workers[(Index + Offset) % Workers.size()];
+        std::lock_guard<std::mutex> Lock(Victim.Mutex);
+        if (!Victim.Jobs.empty())
+        {
+            Function = std::move(Victim.Jobs.front());
+            Victim.Jobs.pop_front();
+            Steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (!Function)
+        return false;
+
+    QueuedJobs.fetch_sub(1);
+    Function();
+    return true;
+}
+
+void Engine::JobSystem::WorkerLoop(unsigned int Index)
+{
+    CurrentWorker = static_cast<int>(Index);
+
+    while (Running)
+    {
+        if (TryRunOne(Index))
+            continue;
+
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        Sleepers.fetch_add(1);
+        WakeUp.wait(Lock, []()
+                    { return QueuedJobs.load() > 0 || !Running; });
+        Sleepers.fetch_sub(1);
+    }
+}
+
+void Engine::JobSystem::Run(Job Function, JobCounter *Signal, JobCounter *After)
+{
+    Job Wrapped = Wrap(std::move(Function), Signal);
+
+    if (After)
+    {
+        std::lock_guard<std::mutex> Lock(After->Mutex);
+        if (After->Pending.load(std::memory_order_acquire) > 0)
+        {
+            After->Continuations.push_back(std::move(Wrapped));
+            return;
+        }
+    }
+
+    Push(std::move(Wrapped));
+}
+
+void Engine::JobSystem::RunOnMainThread(Job Function, JobCounter *Signal)
+{
+    Job Wrapped = Wrap(std::move(Function), Signal);
+    std::lock_guard<std::mutex> Lock(MainMutex);
+    MainJobs.push_back(std::move(Wrapped));
+}
+
+void Engine::JobSystem::PumpMainThread()
+{
+    if (!IsMainThread())
+        return;
+
+    std::vector<Job> Pending;
+    {
+        std::lock_guard<std::mutex> Lock(MainMutex);
+        Pending.swap(MainJobs);
+    }
+    for (Job &Function : Pending)
+        Function();
+}
+
+void Engine::JobSystem::ParallelFor(size_t Count, size_t GrainSize, void (*Invoke)(const void *Context, size_t Begin, size_t End), const void *Context)
+{
+    GrainSize = std::max<size_t>(GrainSize, 1);
+    if (Count <= GrainSize || Workers.size() <= 1)
+    {
+        if (Count > 0)
+            Invoke(Context, 0, Count);
+        return;
+    }
+
+    ParallelForState State;
+    State.Invoke = Invoke;
+    State.Context = Context;
+    State.Count = Count;
+    State.GrainSize = GrainSize;
+
+    // One helper per other worker claims chunks from a shared cursor, the job only captures a pointer so
+    // std::function stores it inline and neither Wrap() nor the chunk count cause an allocation
+    size_t Chunks = (Count + GrainSize - 1) / GrainSize;
+    size_t Helpers = std::min(Chunks, Workers.size()) - 1;
+    ParallelForState *Shared = &State;
+    for (size_t i = 0; i < Helpers; ++i)
+    {
+        State.Counter.Pending.fetch_add(1, std::memory_order_relaxed);
+        Push([Shared]()
+             {
+                 RunChunks(*Shared);
+                 Finish(&Shared->Counter);
+             });
+    }
+
+    RunChunks(State);
+    Wait(State.Counter);
+}
+
+void Engine::JobSystem::RunChunks(ParallelForState &State)
+{
+    while (true)
+    {
+        size_t Begin = State.Next.fetch_add(State.GrainSize, std::memory_order_relaxed);
+        if (Begin >= State.Count)
+            return;
+        State.Invoke(State.Context, Begin, std::min(Begin + State.GrainSize, State.Count));
+    }
+}
+
+void Engine::JobSystem::Wait(JobCounter &Counter)
+{
+    unsigned int Index = (CurrentWorker >= 0) ? CurrentWorker : 0;
+    bool Main = IsMainThread();
+
+    while (!Counter.IsDone())
+    {
+        if (Main)
+            PumpMainThread();
+        if (!TryRunOne(Index))
+            std::this_thread::yield();
+    }
+
+    // The last job may still be inside Finish(), wait for it to release the counter before it goes away
+    std::lock_guard<std::mutex> Lock(Counter.Mutex);
+}
+
+unsigned int Engine::JobSystem::GetWorkerCount()
+{
+    return static_cast<unsigned int>(std::max<size_t>(Workers.size(), 1));
+}
+
+void Engine::JobSystem::SetMainThread()
+{
+    MainThreadID = std::this_thread::get_id();
+}
+
+bool Engine::JobSystem::IsMainThread()
+{
+    return std::this_thread::get_id() == MainThreadID;
+}
+
+size_t Engine::JobSystem::GetStealCount()
+{
+    return Steals.load(std::memory_order_relaxed);
+}
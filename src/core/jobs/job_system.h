@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef job_system_h
+#define job_system_h
+
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+
+namespace Engine
+{
+    // Counts outstanding jobs. Every job submitted with a counter increments it and decrements it when it
+    // finishes, jobs submitted to run after a counter are held back until it reaches zero.
+    class JobCounter
+    {
+    public:
+        bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+        int GetPending() const { return Pending.load(std::memory_order_acquire); }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<int> Pending{0};
+        std::mutex Mutex;
+        std::vector<std::function<void()>> Continuations;
+    };
+
+    // Work-stealing scheduler. Each worker owns a deque, popping its own newest jobs and stealing the oldest
+    // jobs of others when it runs dry. The main thread counts as worker 0 and helps out while it waits, it
+    // also drains the main-thread queue used for anything that needs the GL context.
+    class JobSystem
+    {
+    public:
+        using Job = std::function<void()>;
+
+        // WorkerCount includes the main thread, 0 uses every hardware thread
+        static void Initialize(unsigned int WorkerCount = 0);
+        static void Shutdown();
+
+        static void Run(Job Function, JobCounter *Signal = nullptr, JobCounter *After = nullptr);
+        static void RunOnMainThread(Job Function, JobCounter *Signal = nullptr);
+        // Splits [0, Count) into chunks of GrainSize and blocks until every chunk has run. Body is called by
+        // reference through a plain function pointer, so no std::function is built and nothing is allocated
+        template <typename Function>
+        static void ParallelFor(size_t Count, size_t GrainSize, const Function &Body)
+        {
+            ParallelFor(Count, GrainSize, [](const void *Context, size_t Begin, size_t End)
+                        { (*static_cast<const Function *>(Context))(Begin, End); },
+                        &Body);
+        }
+        static void ParallelFor(size_t Count, size_t GrainSize, void (*Invoke)(const void *Context, size_t Begin, size_t End), const void *Context);
+
+        // Executes other jobs until the counter reaches zero instead of blocking the thread
+        static void Wait(JobCounter &Counter);
+        // Runs the queued main-thread jobs, call once per frame
+        static void PumpMainThread();
+
+        // Moves main-thread affinity to the calling thread, e.g. when the GL context moves to a render thread
+        static void SetMainThread();
+
+        static unsigned int GetWorkerCount();
+        static bool IsMainThread();
+        static size_t GetStealCount();
+
+    private:
+        struct Worker
+        {
+            std::mutex Mutex;
+            std::deque<Job> Jobs;
+        };
+
+        static std::vector<std::unique_ptr<Worker>> Workers;
+        static std::vector<std::thread> Threads;
+        static std::mutex MainMutex;
+        static std::vector<Job> MainJobs;
+
+        static std::mutex SleepMutex;
+        static std::condition_variable WakeUp;
+        static std::atomic<int> QueuedJobs;
+        static std::atomic<int> Sleepers;
+        static std::atomic<bool> Running;
+        static std::atomic<unsigned int> NextWorker;
+        static std::atomic<size_t> Steals;
+        static std::atomic<std::thread::id> MainThreadID;
+
+        static void Push(Job Function);
+        static bool TryRunOne(unsigned int Index);
+        static void WorkerLoop(unsigned int Index);
+        static void Finish(JobCounter *Signal);
+        static Job Wrap(Job Function, JobCounter *Signal);
+
+        struct ParallelForState
+        {
+            void (*Invoke)(const void *Context, size_t Begin, size_t End);
+            const void *Context;
+            size_t Count;
+            size_t GrainSize;
+            std::atomic<size_t> Next{0};
+            JobCounter Counter;
+        };
+
+        static void RunChunks(ParallelForState &State);
+    };
+};
+
+#endif
@@ -0,0 +1,93 @@
+#include "frame_arena.h"
+
+namespace
+{
+    thread_local int CurrentBuffer = 0;
+}
+
+Engine::FrameArena::Buffer Engine::FrameArena::Buffers[BufferCount];
+std::atomic<size_t> Engine::FrameArena::Overflows{0};
+
+void Engine::FrameArena::BeginFrame(uint64_t FrameIndex)
+{
+    SetThreadFrame(FrameIndex);
+    Buffer &Target = Buffers[CurrentBuffer];
+
+    for (const std::pair<void *, size_t> &Block : Target.Overflow)
+        MemoryTracker::Free(Block.first, Block.second, MemoryTracker::Tag::FrameTemporary);
+    Target.Overflow.clear();
+
+    // Top kept counting past the end when the frame spilled, so it is what the frame really needed
+    size_t Needed = Target.Top.load(std::memory_order_relaxed);
+    if (Target.Memory == nullptr || Needed > Target.Capacity)
+    {
+        size_t NewCapacity = std::max(Target.Capacity, InitialCapacity);
+        while (NewCapacity < Needed)
+            NewCapacity *= 2;
+
+        MemoryTracker::Free(Target.Memory, Target.Capacity, MemoryTracker::Tag::FrameTemporary);
+        Target.Memory = static_cast<unsigned char *>(MemoryTracker::Allocate(NewCapacity, MemoryTracker::Tag::FrameTemporary));
+        Target.Capacity = NewCapacity;
+    }
+    Target.Top.store(0, std::memory_order_relaxed);
+}
+
+void Engine::FrameArena::SetThreadFrame(uint64_t FrameIndex)
+{
+    CurrentBuffer = static_cast<int>(FrameIndex % BufferCount);
+}
+
+void *Engine::FrameArena::Allocate(size_t Size, size_t Alignment)
+{
+    Buffer &Target = Buffers[CurrentBuffer];
+    Alignment = std::max(Alignment, alignof(std::max_align_t));
+    size_t Reserved = (Size + Alignment - 1) / Alignment * Alignment;
+
+    // Offsets stay multiples of the default alignment, only larger alignments need padding
+    if (Alignment > alignof(std::max_align_t))
+        Reserved += Alignment;
+
+    size_t Offset = Target.Top.fetch_add(Reserved, std::memory_order_relaxed);
+    if (Target.Memory && Offset + Reserved <= Target.Capacity)
+    {
+        uintptr_t Address = reinterpret_cast<uintptr_t>(Target.Memory + Offset);
+        return reinterpret_cast<void *>((Address + Alignment - 1) / Alignment * Alignment);
+    }
+
+    std::lock_guard<std::mutex> Lock(Target.OverflowMutex);
+    if (Target.Overflow.empty())
+        Overflows.fetch_add(1, std::memory_order_relaxed);
+    void *Block = MemoryTracker::Allocate(Size + Alignment, MemoryTracker::Tag::FrameTemporary);
+    Target.Overflow.push_back({Block, Size + Alignment});
+    uintptr_t Address = reinterpret_cast<uintptr_t>(Block);
+    return reinterpret_cast<void *>((Address + Alignment - 1) / Alignment * Alignment);
+}
+
+void Engine::FrameArena::Release()
+{
+    for (Buffer &Target : Buffers)
+    {
+        for (const std::pair<void *, size_t> &Block : Target.Overflow)
+            MemoryTracker::Free(Block.first, Block.second, MemoryTracker::Tag::FrameTemporary);
+        Target.Overflow.clear();
+        MemoryTracker::Free(Target.Memory, Target.Capacity, MemoryTracker::Tag::FrameTemporary);
+        Target.Memory = nullptr;
+        Target.Capacity = 0;
+        Target.Top.store(0, std::memory_order_relaxed);
+    }
+}
+
+size_t Engine::FrameArena::GetUsedBytes()
+{
+    return Buffers[CurrentBuffer].Top.load(std::memory_order_relaxed);
+}
+
+size_t Engine::FrameArena::GetCapacity()
+{
+    return Buffers[CurrentBuffer].Capacity;
+}
+
+size_t Engine::FrameArena::GetOverflowCount()
+{
+    return Overflows.load(std::memory_order_relaxed);
+}
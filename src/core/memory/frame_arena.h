@@ -0,0 +1,94 @@
+#pragma once
+
+#ifndef frame_arena_h
+#define frame_arena_h
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "memory_tracker.h"
+
+namespace Engine
+{
+    // Bump allocator for data that lives at most one frame. There is one buffer per frame in flight, the
+    // simulation writes frame N + 1 while the renderer draws frame N, so the buffer being reset always
+    // belongs to a frame both threads are done with. Allocating is a single atomic add and safe from any
+    // thread, freeing does nothing. A frame that does not fit spills into the heap and the buffer grows to
+    // the size it needed the next time it is reset, so steady-state frames never touch the heap.
+    class FrameArena
+    {
+    public:
+        static constexpr int BufferCount = 3;
+        static constexpr size_t InitialCapacity = 256 * 1024;
+
+        // Resets the buffer of FrameIndex and makes it current on the calling thread, once per frame by
+        // whichever thread starts it, before anything allocates for that frame
+        static void BeginFrame(uint64_t FrameIndex);
+        // Makes the buffer of FrameIndex current on another thread working on the same frame
+        static void SetThreadFrame(uint64_t FrameIndex);
+        static void *Allocate(size_t Size, size_t Alignment = alignof(std::max_align_t));
+        static void Release();
+
+        // Bytes requested from the calling thread's current buffer this frame, and its capacity
+        static size_t GetUsedBytes();
+        static size_t GetCapacity();
+        // Frames that spilled into the heap since startup
+        static size_t GetOverflowCount();
+
+    private:
+        struct Buffer
+        {
+            unsigned char *Memory = nullptr;
+            size_t Capacity = 0;
+            std::atomic<size_t> Top{0};
+            std::mutex OverflowMutex;
+            std::vector<std::pair<void *, size_t>> Overflow;
+        };
+
+        static Buffer Buffers[BufferCount];
+        static std::atomic<size_t> Overflows;
+    };
+
+    // Standard allocator drawing from the calling thread's frame buffer, containers using it must not be
+    // kept past the frame they were filled in
+    template <typename T>
+    class FrameAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = FrameAllocator<U>;
+        };
+
+        FrameAllocator() = default;
+        template <typename U>
+        FrameAllocator(const FrameAllocator<U> &) {}
+
+        T *allocate(size_t Count)
+        {
+            return static_cast<T *>(FrameArena::Allocate(Count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T *, size_t) {}
+
+        template <typename U>
+        bool operator==(const FrameAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const FrameAllocator<U> &) const { return false; }
+    };
+
+    template <typename T>
+    using FrameVector = std::vector<T, FrameAllocator<T>>;
+    using FrameString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+    using FrameStringStream = std::basic_ostringstream<char, std::char_traits<char>, FrameAllocator<char>>;
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "memory_tracker.h"
+
+namespace
+{
+    std::atomic<uint64_t> AllocationCount{0};
+    thread_local uint64_t ThreadAllocationCount = 0;
+}
+
+#if ENGINE_TRACK_ALLOCATIONS
+namespace
+{
+    // Replaced operators only forward here. Kept out of line so the compiler never pairs the inlined
+    // malloc of one operator with the free of another and flags them as mismatched.
+    [[gnu::noinline]] void *CountedAllocate(std::size_t Size)
+    {
+        AllocationCount.fetch_add(1, std::memory_order_relaxed);
+        ++ThreadAllocationCount;
+        return std::malloc(Size ? Size : 1);
+    }
+
+    [[gnu::noinline]] void CountedFree(void *Pointer) noexcept
+    {
+        std::free(Pointer);
+    }
+}
+
+void *operator new(std::size_t Size)
+{
+    if (void *Pointer = CountedAllocate(Size))
+        return Pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *Pointer) noexcept
+{
+    CountedFree(Pointer);
+}
+
+void operator delete(void *Pointer, std::size_t) noexcept
+{
+    CountedFree(Pointer);
+}
+#endif
+
+Engine::MemoryTracker::AtomicCounter Engine::MemoryTracker::CpuCounters[static_cast<int>(Tag::Count)];
+Engine::MemoryTracker::Counter Engine::MemoryTracker::GpuCounters[static_cast<int>(GpuOwner::Count)] = {};
+std::unordered_map<uint64_t, Engine::MemoryTracker::GpuAllocation> Engine::MemoryTracker::GpuAllocations;
+std::mutex Engine::MemoryTracker::GpuMutex;
+
+void Engine::MemoryTracker::Add(AtomicCounter &Target, int64_t Size)
+{
+    int64_t Current = Target.Current.fetch_add(Size, std::memory_order_relaxed) + Size;
+    int64_t Peak = Target.Peak.load(std::memory_order_relaxed);
+    while (Current > Peak && !Target.Peak.compare_exchange_weak(Peak, Current, std::memory_order_relaxed))
+    {
+    }
+}
+
+void *Engine::MemoryTracker::Allocate(size_t Size, Tag MemoryTag)
+{
+    void *Pointer = ::operator new(Size);
+    Add(CpuCounters[static_cast<int>(MemoryTag)], static_cast<int64_t>(Size));
+    return Pointer;
+}
+
+void Engine::MemoryTracker::Free(void *Pointer, size_t Size, Tag MemoryTag)
+{
+    if (!Pointer)
+        return;
+    Add(CpuCounters[static_cast<int>(MemoryTag)], -static_cast<int64_t>(Size));
+    ::operator delete(Pointer);
+}
+
+void Engine::MemoryTracker::TrackAllocation(Tag MemoryTag, size_t Size)
+{
+    Add(CpuCounters[static_cast<int>(MemoryTag)], static_cast<int64_t>(Size));
+}
+
+void Engine::MemoryTracker::TrackFree(Tag MemoryTag, size_t Size)
+{
+    Add(CpuCounters[static_cast<int>(MemoryTag)], -static_cast<int64_t>(Size));
+}
+
+void Engine::MemoryTracker::TrackGpu(GpuObject Type, GLuint Name, GpuOwner Owner, size_t Size)
+{
+    if (Name == 0)
+        return;
+
+    std::lock_guard<std::mutex> Lock(GpuMutex);
+    uint64_t Key = (static_cast<uint64_t>(Type) << 32) | Name;
+    auto It = GpuAllocations.find(Key);
+    if (It != GpuAllocations.end())
+    {
+        GpuCounters[static_cast<int>(It->second.Owner)].Current -= It->second.Size;
+        It->second = {Owner, Size};
+    }
+    else
+        GpuAllocations.emplace(Key, GpuAllocation{Owner, Size});
+
+    Counter &Target = GpuCounters[static_cast<int>(Owner)];
+    Target.Current += Size;
+    Target.Peak = std::max(Target.Peak, Target.Current);
+}
+
+void Engine::MemoryTracker::UntrackGpu(GpuObject Type, GLuint Name)
+{
+    std::lock_guard<std::mutex> Lock(GpuMutex);
+    auto It = GpuAllocations.find((static_cast<uint64_t>(Type) << 32) | Name);
+    if (It == GpuAllocations.end())
+        return;
+
+    GpuCounters[static_cast<int>(It->second.Owner)].Current -= It->second.Size;
+    GpuAllocations.erase(It);
+}
+
+size_t Engine::MemoryTracker::GetTextureSize(GLenum InternalFormat, int Width, int Height, bool Mipmapped)
+{
+    size_t TexelSize;
+    switch (InternalFormat)
+    {
+    case GL_R8:
+    case GL_RED:
+        TexelSize = 1;
+        break;
+    case GL_R16F:
+    case GL_RG8:
+        TexelSize = 2;
+        break;
+    case GL_RGB:
+    case GL_RGB8:
+        TexelSize = 3;
+        break;
+    case GL_RGB16F:
+        TexelSize = 6;
+        break;
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_RGBA:
+    case GL_RGBA8:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT24:
+    case GL_DEPTH_COMPONENT32F:
+        TexelSize = 4;
+        break;
+    case GL_RGBA16F:
+        TexelSize = 8;
+        break;
+    case GL_RGBA32F:
+        TexelSize = 16;
+        break;
+    default:
+        TexelSize = 4;
+        break;
+    }
+
+    size_t Size = static_cast<size_t>(Width) * Height * TexelSize;
+    return Mipmapped ? Size + Size / 3 : Size;
+}
+
+uint64_t Engine::MemoryTracker::GetAllocationCount()
+{
+    return AllocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Engine::MemoryTracker::GetThreadAllocationCount()
+{
+    return ThreadAllocationCount;
+}
+
+Engine::MemoryTracker::Counter Engine::MemoryTracker::GetCpu(Tag MemoryTag)
+{
+    const AtomicCounter &Source = CpuCounters[static_cast<int>(MemoryTag)];
+    return {Source.Current.load(std::memory_order_relaxed), Source.Peak.load(std::memory_order_relaxed)};
+}
+
+Engine::MemoryTracker::Counter Engine::MemoryTracker::GetGpu(GpuOwner Owner)
+{
+    std::lock_guard<std::mutex> Lock(GpuMutex);
+    return GpuCounters[static_cast<int>(Owner)];
+}
+
+const char *Engine::MemoryTracker::GetName(Tag MemoryTag)
+{
+    static const char *Names[] = {"General", "MeshImport", "Textures", "Text", "FrameTemporary"};
+    return Names[static_cast<int>(MemoryTag)];
+}
+
+const char *Engine::MemoryTracker::GetName(GpuOwner Owner)
+{
+    static const char *Names[] = {"Meshes", "Textures", "RenderTargets", "Text", "Sprites", "Uniforms", "Shadows"};
+    return Names[static_cast<int>(Owner)];
+}
+
+std::string Engine::MemoryTracker::GetOverlayText()
+{
+    auto Megabytes = [](int64_t Bytes) { return Bytes / (1024.0 * 1024.0); };
+
+    std::ostringstream Stream;
+    Stream << std::fixed << std::setprecision(2) << "Memory (MB, live / peak)";
+    Counter CpuTotal = {0, 0}, GpuTotal = {0, 0};
+    for (int i = 0; i < static_cast<int>(Tag::Count); ++i)
+    {
+        Counter Value = GetCpu(static_cast<Tag>(i));
+        Stream << "\nCPU " << GetName(static_cast<Tag>(i)) << ": " << Megabytes(Value.Current) << " / " << Megabytes(Value.Peak);
+        CpuTotal.Current += Value.Current;
+    }
+    for (int i = 0; i < static_cast<int>(GpuOwner::Count); ++i)
+    {
+        Counter Value = GetGpu(static_cast<GpuOwner>(i));
+        Stream << "\nGPU " << GetName(static_cast<GpuOwner>(i)) << ": " << Megabytes(Value.Current) << " / " << Megabytes(Value.Peak);
+        GpuTotal.Current += Value.Current;
+    }
+    Stream << "\nTotal: CPU " << Megabytes(CpuTotal.Current) << ", GPU " << Megabytes(GpuTotal.Current);
+    return Stream.str();
+}
+
+void Engine::MemoryTracker::WriteJson(std::ostream &Stream, const std::string &Indent)
+{
+    Stream << Indent << "\"memory\": {\n" << Indent << "  \"cpu\": {";
+    for (int i = 0; i < static_cast<int>(Tag::Count); ++i)
+    {
+        Counter Value = GetCpu(static_cast<Tag>(i));
+        Stream << (i ? ", " : "") << "\"" << GetName(static_cast<Tag>(i)) << "\": {\"bytes\": " << Value.Current << ", \"peak\": " << Value.Peak << "}";
+    }
+    Stream << "},\n" << Indent << "  \"gpu\": {";
+    for (int i = 0; i < static_cast<int>(GpuOwner::Count); ++i)
+    {
+        Counter Value = GetGpu(static_cast<GpuOwner>(i));
+        Stream << (i ? ", " : "") << "\"" << GetName(static_cast<GpuOwner>(i)) << "\": {\"bytes\": " << Value.Current << ", \"peak\": " << Value.Peak << "}";
+    }
+    Stream << "}\n" << Indent << "}";
+}
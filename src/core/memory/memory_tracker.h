@@ -0,0 +1,158 @@
+#pragma once
+
+#ifndef memory_tracker_h
+#define memory_tracker_h
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <cstdlib>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <unordered_map>
+#include <glad/glad.h>
+
+// Counting every heap allocation replaces the global operator new, debug builds only unless
+// ENGINE_TRACK_ALLOCATIONS=1 is defined explicitly
+#ifndef ENGINE_TRACK_ALLOCATIONS
+#ifdef NDEBUG
+#define ENGINE_TRACK_ALLOCATIONS 0
+#else
+#define ENGINE_TRACK_ALLOCATIONS 1
+#endif
+#endif
+
+namespace Engine
+{
+    // CPU memory is counted per tag, either through TaggedAllocator/Allocate or by reporting memory a library
+    // allocated with TrackAllocation. GPU storage is counted per owner and keyed by the GL object name, so
+    // respecifying an object replaces its size and deleting it releases it. Both keep live totals and
+    // high-water marks.
+    class MemoryTracker
+    {
+    public:
+        enum class Tag
+        {
+            General,
+            MeshImport,
+            Textures,
+            Text,
+            FrameTemporary,
+            Count
+        };
+
+        enum class GpuOwner
+        {
+            Meshes,
+            Textures,
+            RenderTargets,
+            Text,
+            Sprites,
+            Uniforms,
+            Shadows,
+            Count
+        };
+
+        enum class GpuObject
+        {
+            Buffer,
+            Texture,
+            Renderbuffer
+        };
+
+        struct Counter
+        {
+            int64_t Current;
+            int64_t Peak;
+        };
+
+        static void *Allocate(size_t Size, Tag MemoryTag);
+        static void Free(void *Pointer, size_t Size, Tag MemoryTag);
+        // For memory allocated elsewhere (stb_image, FreeType) that the tag should still account for
+        static void TrackAllocation(Tag MemoryTag, size_t Size);
+        static void TrackFree(Tag MemoryTag, size_t Size);
+
+        // Call after every glBufferData/glBufferStorage, glTexImage2D and glRenderbufferStorage with the
+        // object that is bound, and before deleting it. Untracking an unknown name does nothing.
+        static void TrackGpu(GpuObject Type, GLuint Name, GpuOwner Owner, size_t Size);
+        static void UntrackGpu(GpuObject Type, GLuint Name);
+        // Nominal storage of a 2D texture in the given internal format, a third more with a full mip chain
+        static size_t GetTextureSize(GLenum InternalFormat, int Width, int Height, bool Mipmapped = false);
+
+        // Number of operator new calls, in total and on the calling thread, always 0 without ENGINE_TRACK_ALLOCATIONS
+        static uint64_t GetAllocationCount();
+        static uint64_t GetThreadAllocationCount();
+
+        static Counter GetCpu(Tag MemoryTag);
+        static Counter GetGpu(GpuOwner Owner);
+        static const char *GetName(Tag MemoryTag);
+        static const char *GetName(GpuOwner Owner);
+
+        static std::string GetOverlayText();
+        // Writes "memory": {"cpu": {...}, "gpu": {...}} as a member of an enclosing JSON object
+        static void WriteJson(std::ostream &Stream, const std::string &Indent);
+
+    private:
+        struct AtomicCounter
+        {
+            std::atomic<int64_t> Current{0};
+            std::atomic<int64_t> Peak{0};
+        };
+
+        struct GpuAllocation
+        {
+            GpuOwner Owner;
+            size_t Size;
+        };
+
+        static AtomicCounter CpuCounters[static_cast<int>(Tag::Count)];
+        static Counter GpuCounters[static_cast<int>(GpuOwner::Count)];
+        static std::unordered_map<uint64_t, GpuAllocation> GpuAllocations;
+        static std::mutex GpuMutex;
+
+        static void Add(AtomicCounter &Target, int64_t Size);
+    };
+
+    // Standard allocator that counts what a container holds under a tag
+    template <typename T, MemoryTracker::Tag MemoryTag>
+    class TaggedAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = TaggedAllocator<U, MemoryTag>;
+        };
+
+        TaggedAllocator() = default;
+        template <typename U>
+        TaggedAllocator(const TaggedAllocator<U, MemoryTag> &) {}
+
+        T *allocate(size_t Count)
+        {
+            return static_cast<T *>(MemoryTracker::Allocate(Count * sizeof(T), MemoryTag));
+        }
+
+        void deallocate(T *Pointer, size_t Count)
+        {
+            MemoryTracker::Free(Pointer, Count * sizeof(T), MemoryTag);
+        }
+
+        template <typename U>
+        bool operator==(const TaggedAllocator<U, MemoryTag> &) const { return true; }
+        template <typename U>
+        bool operator!=(const TaggedAllocator<U, MemoryTag> &) const { return false; }
+    };
+
+    template <typename T, MemoryTracker::Tag MemoryTag>
+    using TaggedVector = std::vector<T, TaggedAllocator<T, MemoryTag>>;
+};
+
+#endif
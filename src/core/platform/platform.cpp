@@ -0,0 +1,267 @@
+// windows.h goes before glad so APIENTRY is defined once, osmesa.h after glad so it does not pull in GL/gl.h
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "platform.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <climits>
+
+#if __has_include(<EGL/egl.h>)
+#define ENGINE_EGL 1
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#if __has_include(<GL/osmesa.h>)
+#define ENGINE_OSMESA 1
+#include <GL/osmesa.h>
+#endif
+#endif
+
+namespace
+{
+#ifdef ENGINE_EGL
+    EGLDisplay Display = EGL_NO_DISPLAY;
+    EGLContext Context = EGL_NO_CONTEXT;
+#endif
+#ifdef ENGINE_OSMESA
+    OSMesaContext MesaContext = nullptr;
+    std::vector<unsigned char> MesaBuffer;
+#endif
+
+    const std::chrono::steady_clock::time_point StartTime = std::chrono::steady_clock::now();
+
+    bool EqualsIgnoreCase(const std::string &A, const std::string &B)
+    {
+        if (A.size() != B.size())
+            return false;
+        for (size_t i = 0; i < A.size(); ++i)
+        {
+            if (std::tolower(static_cast<unsigned char>(A[i])) != std::tolower(static_cast<unsigned char>(B[i])))
+                return false;
+        }
+        return true;
+    }
+}
+
+Engine::Platform::HeadlessBackend Engine::Platform::Backend = Engine::Platform::HeadlessBackend::None;
+std::mutex Engine::Platform::PathMutex;
+std::unordered_map<std::string, std::string> Engine::Platform::ResolvedPaths;
+
+std::string Engine::Platform::GetExecutablePath()
+{
+#ifdef _WIN32
+    char Path[MAX_PATH];
+    GetModuleFileNameA(nullptr, Path, MAX_PATH);
+    return std::filesystem::path(Path).parent_path().string();
+#else
+    char Path[PATH_MAX];
+    ssize_t Length = readlink("/proc/self/exe", Path, sizeof(Path) - 1);
+    if (Length <= 0)
+        return std::filesystem::current_path().string();
+    Path[Length] = '\0';
+    return std::filesystem::path(Path).parent_path().string();
+#endif
+}
+
+std::string Engine::Platform::ResolvePath(const std::filesystem::path &Path)
+{
+#ifdef _WIN32
+    return Path.string();
+#else
+    std::error_code Error;
+    if (std::filesystem::exists(Path, Error))
+        return Path.string();
+
+    std::string Key = Path.string();
+    {
+        std::lock_guard<std::mutex> Lock(PathMutex);
+        auto It = ResolvedPaths.find(Key);
+        if (It != ResolvedPaths.end())
+            return It->second;
+    }
+
+    std::filesystem::path Resolved = Path.root_path();
+    for (const std::filesystem::path &Component : Path.relative_path())
+    {
+        std::filesystem::path Candidate = Resolved / Component;
+        if (Component == "." || Component == ".." || std::filesystem::exists(Candidate, Error))
+        {
+            Resolved = Candidate;
+            continue;
+        }
+
+        bool Found = false;
+        std::string Name = Component.string();
+        for (const std::filesystem::directory_entry &Entry : std::filesystem::directory_iterator(Resolved.empty() ? "." : Resolved, Error))
+        {
+            if (EqualsIgnoreCase(Entry.path().filename().string(), Name))
+            {
+                Resolved /= Entry.path().filename();
+                Found = true;
+                break;
+            }
+        }
+        if (!Found)
+            return Key;
+    }
+
+    std::lock_guard<std::mutex> Lock(PathMutex);
+    ResolvedPaths[Key] = Resolved.string();
+    return Resolved.string();
+#endif
+}
+
+double Engine::Platform::GetTime()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+}
+
+bool Engine::Platform::CreateHeadlessContext(unsigned int Width, unsigned int Height)
+{
+    if (Backend != HeadlessBackend::None)
+        return true;
+
+    if (CreateEGLContext())
+        Backend = HeadlessBackend::EGL;
+    else if (CreateOSMesaContext(Width, Height))
+        Backend = HeadlessBackend::OSMesa;
+    else
+    {
+        std::cerr << "Platform: No headless context available, build with EGL or OSMesa headers present" << std::endl;
+        return false;
+    }
+
+    std::cout << "Platform: Created headless " << (Backend == HeadlessBackend::EGL ? "EGL" : "OSMesa") << " context" << std::endl;
+    return true;
+}
+
+bool Engine::Platform::CreateEGLContext()
+{
+#ifdef ENGINE_EGL
+    // Mesa's surfaceless platform needs no display server, the default display is the fallback for other drivers
+    auto GetPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    Display = GetPlatformDisplay ? GetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+    if (Display == EGL_NO_DISPLAY)
+        Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint Major = 0, Minor = 0;
+    if (Display == EGL_NO_DISPLAY || !eglInitialize(Display, &Major, &Minor))
+    {
+        std::cerr << "Platform: Could not initialize an EGL display" << std::endl;
+        return false;
+    }
+
+    const char *Extensions = eglQueryString(Display, EGL_EXTENSIONS);
+    if (!Extensions || !std::strstr(Extensions, "EGL_KHR_surfaceless_context") || !eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cerr << "Platform: EGL " << Major << "." << Minor << " has no surfaceless desktop GL support" << std::endl;
+        eglTerminate(Display);
+        Display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    const EGLint ConfigAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE, 0, EGL_NONE};
+    EGLConfig Config = nullptr;
+    EGLint ConfigCount = 0;
+    eglChooseConfig(Display, ConfigAttributes, &Config, 1, &ConfigCount);
+
+    // Same 4.1 baseline as the shaders, compatibility first to match what GLFW hands out on Windows
+    for (EGLint Profile : {EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT})
+    {
+        const EGLint ContextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 1,
+                                            EGL_CONTEXT_OPENGL_PROFILE_MASK, Profile, EGL_NONE};
+        Context = eglCreateContext(Display, ConfigCount > 0 ? Config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, ContextAttributes);
+        if (Context != EGL_NO_CONTEXT)
+            break;
+    }
+
+    if (Context == EGL_NO_CONTEXT || !eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, Context))
+    {
+        std::cerr << "Platform: Could not create a GL 4.1 EGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        if (Context != EGL_NO_CONTEXT)
+            eglDestroyContext(Display, Context);
+        eglTerminate(Display);
+        Context = EGL_NO_CONTEXT;
+        Display = EGL_NO_DISPLAY;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool Engine::Platform::CreateOSMesaContext(unsigned int Width, unsigned int Height)
+{
+#ifdef ENGINE_OSMESA
+    const int Attributes[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_STENCIL_BITS, 8,
+                              OSMESA_PROFILE, OSMESA_COMPAT_PROFILE, OSMESA_CONTEXT_MAJOR_VERSION, 4,
+                              OSMESA_CONTEXT_MINOR_VERSION, 1, 0};
+    MesaContext = OSMesaCreateContextAttribs(Attributes, nullptr);
+    if (!MesaContext)
+        return false;
+
+    // The engine renders into its own framebuffers, the OSMesa buffer only has to exist
+    MesaBuffer.resize(static_cast<size_t>(Width) * Height * 4);
+    if (!OSMesaMakeCurrent(MesaContext, MesaBuffer.data(), GL_UNSIGNED_BYTE, Width, Height))
+    {
+        OSMesaDestroyContext(MesaContext);
+        MesaContext = nullptr;
+        return false;
+    }
+    return true;
+#else
+    (void)Width;
+    (void)Height;
+    return false;
+#endif
+}
+
+void Engine::Platform::DestroyHeadlessContext()
+{
+#ifdef ENGINE_EGL
+    if (Backend == HeadlessBackend::EGL)
+    {
+        eglMakeCurrent(Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(Display, Context);
+        eglTerminate(Display);
+        Context = EGL_NO_CONTEXT;
+        Display = EGL_NO_DISPLAY;
+    }
+#endif
+#ifdef ENGINE_OSMESA
+    if (Backend == HeadlessBackend::OSMesa)
+    {
+        OSMesaDestroyContext(MesaContext);
+        MesaContext = nullptr;
+        MesaBuffer.clear();
+    }
+#endif
+    Backend = HeadlessBackend::None;
+}
+
+GLADloadproc Engine::Platform::GetHeadlessProcAddress()
+{
+#ifdef ENGINE_EGL
+    if (Backend == HeadlessBackend::EGL)
+        return reinterpret_cast<GLADloadproc>(eglGetProcAddress);
+#endif
+#ifdef ENGINE_OSMESA
+    if (Backend == HeadlessBackend::OSMesa)
+        return reinterpret_cast<GLADloadproc>(OSMesaGetProcAddress);
+#endif
+    return nullptr;
+}
+
+Engine::Platform::HeadlessBackend Engine::Platform::GetHeadlessBackend()
+{
+    return Backend;
+}
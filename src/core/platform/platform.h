@@ -0,0 +1,56 @@
+#pragma once
+
+#ifndef platform_h
+#define platform_h
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <filesystem>
+#include <unordered_map>
+#include <glad/glad.h>
+
+namespace Engine
+{
+    // Operating system and context creation services that differ between Windows and Linux. Windowed
+    // contexts stay with GLFW, headless contexts come from surfaceless EGL or OSMesa when the headers are
+    // available at build time, so the renderer can run offscreen on machines without a display.
+    class Platform
+    {
+    public:
+        enum class HeadlessBackend
+        {
+            None,
+            EGL,
+            OSMesa
+        };
+
+        static std::string GetExecutablePath();
+        // Asset paths are written with Windows casing, on case sensitive file systems each component is
+        // matched ignoring case. Paths that do not exist are returned unchanged so callers report them.
+        static std::string ResolvePath(const std::filesystem::path &Path);
+        // Seconds since the first call, usable before and without GLFW
+        static double GetTime();
+
+        // Creates a context without any window and makes it current on the calling thread, trying
+        // surfaceless EGL first and OSMesa second. Width and Height only size the OSMesa backbuffer.
+        static bool CreateHeadlessContext(unsigned int Width, unsigned int Height);
+        static void DestroyHeadlessContext();
+        static GLADloadproc GetHeadlessProcAddress();
+        static HeadlessBackend GetHeadlessBackend();
+
+    private:
+        static HeadlessBackend Backend;
+        static std::mutex PathMutex;
+        static std::unordered_map<std::string, std::string> ResolvedPaths;
+
+        static bool CreateEGLContext();
+        static bool CreateOSMesaContext(unsigned int Width, unsigned int Height);
+    };
+};
+
+#endif
@@ -0,0 +1,316 @@
+#include "profiler.h"
+
+namespace
+{
+    constexpr uint32_t GpuTrack = 0xFFFFFFFFu;
+
+    thread_local std::vector<std::pair<const char *, uint64_t>> CpuStack;
+    thread_local void *CurrentThreadBuffer = nullptr;
+    const std::chrono::steady_clock::time_point Epoch = std::chrono::steady_clock::now();
+}
+
+std::atomic<bool> Engine::Profiler::Enabled{true};
+std::atomic<int> Engine::Profiler::CaptureRequest{0};
+std::mutex Engine::Profiler::RegistryMutex;
+std::vector<std::unique_ptr<Engine::Profiler::ThreadBuffer>> Engine::Profiler::Threads;
+
+Engine::Profiler::GpuFrame Engine::Profiler::GpuFrames[Engine::Profiler::FrameLatency];
+int Engine::Profiler::GpuFrameIndex = 0;
+std::vector<size_t> Engine::Profiler::GpuStack;
+int64_t Engine::Profiler::GpuClockOffset = 0;
+bool Engine::Profiler::GpuClockSynced = false;
+size_t Engine::Profiler::DroppedGpuFrames = 0;
+
+std::mutex Engine::Profiler::OverlayMutex;
+std::string Engine::Profiler::OverlayText;
+std::vector<Engine::Profiler::CpuEvent> Engine::Profiler::FrameEvents;
+std::vector<Engine::Profiler::CpuEvent> Engine::Profiler::GpuEvents;
+
+int Engine::Profiler::CaptureFramesLeft = 0;
+std::vector<Engine::Profiler::CpuEvent> Engine::Profiler::CaptureEvents;
+
+uint64_t Engine::Profiler::Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch).count();
+}
+
+void Engine::Profiler::SetEnabled(bool Enable)
+{
+    Enabled = Enable;
+}
+
+bool Engine::Profiler::IsEnabled()
+{
+    return Enabled;
+}
+
+Engine::Profiler::ThreadBuffer &Engine::Profiler::GetThreadBuffer()
+{
+    if (!CurrentThreadBuffer)
+    {
+        std::lock_guard<std::mutex> Lock(RegistryMutex);
+        Threads.push_back(std::make_unique<ThreadBuffer>());
+        Threads.back()->Index = static_cast<uint32_t>(Threads.size() - 1);
+        Threads.back()->Name = "Thread " + std::to_string(Threads.size() - 1);
+        CurrentThreadBuffer = Threads.back().get();
+    }
+    return *static_cast<ThreadBuffer *>(CurrentThreadBuffer);
+}
+
+void Engine::Profiler::SetThreadName(const std::string &Name)
+{
+    ThreadBuffer &Buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> Lock(Buffer.Mutex);
+    Buffer.Name = Name;
+}
+
+void Engine::Profiler::BeginCpu(const char *Name)
+{
+    CpuStack.emplace_back(Name, Now());
+}
+
+void Engine::Profiler::EndCpu()
+{
+    if (CpuStack.empty())
+        return;
+
+    auto [Name, Start] = CpuStack.back();
+    CpuStack.pop_back();
+    if (!Enabled)
+        return;
+
+    ThreadBuffer &Buffer = GetThreadBuffer();
+    CpuEvent Event = {Name, Start, Now(), Buffer.Index, static_cast<uint16_t>(CpuStack.size())};
+    std::lock_guard<std::mutex> Lock(Buffer.Mutex);
+    Buffer.Events.push_back(Event);
+}
+
+void Engine::Profiler::BeginGpu(const char *Name)
+{
+    if (!Enabled)
+    {
+        GpuStack.push_back(SIZE_MAX);
+        return;
+    }
+
+    GpuFrame &Frame = GpuFrames[GpuFrameIndex];
+    if (Frame.Used == Frame.Queries.size())
+    {
+        GpuQuery Query = {};
+        glGenQueries(1, &Query.Start);
+        glGenQueries(1, &Query.End);
+        Frame.Queries.push_back(Query);
+    }
+
+    // Timestamps rather than GL_TIME_ELAPSED, elapsed queries can not be nested
+    GpuQuery &Query = Frame.Queries[Frame.Used];
+    Query.Name = Name;
+    Query.Depth = static_cast<uint16_t>(GpuStack.size());
+    glQueryCounter(Query.Start, GL_TIMESTAMP);
+    GpuStack.push_back(Frame.Used++);
+}
+
+void Engine::Profiler::EndGpu()
+{
+    if (GpuStack.empty())
+        return;
+
+    size_t Index = GpuStack.back();
+    GpuStack.pop_back();
+    if (Index != SIZE_MAX)
+        glQueryCounter(GpuFrames[GpuFrameIndex].Queries[Index].End, GL_TIMESTAMP);
+}
+
+void Engine::Profiler::ReadGpuFrame(GpuFrame &Frame)
+{
+    // Only read a frame whose every timestamp has landed, otherwise drop it instead of waiting
+    for (size_t i = 0; i < Frame.Used; ++i)
+    {
+        GLuint Available = 0;
+        glGetQueryObjectuiv(Frame.Queries[i].End, GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (!Available)
+        {
+            ++DroppedGpuFrames;
+            return;
+        }
+    }
+
+    GpuEvents.clear();
+    for (size_t i = 0; i < Frame.Used; ++i)
+    {
+        GLuint64 Start = 0, End = 0;
+        glGetQueryObjectui64v(Frame.Queries[i].Start, GL_QUERY_RESULT, &Start);
+        glGetQueryObjectui64v(Frame.Queries[i].End, GL_QUERY_RESULT, &End);
+        GpuEvents.push_back({Frame.Queries[i].Name, static_cast<uint64_t>(Start + GpuClockOffset),
+                             static_cast<uint64_t>(End + GpuClockOffset), GpuTrack, Frame.Queries[i].Depth});
+    }
+}
+
+void Engine::Profiler::EndFrame()
+{
+    if (!GpuClockSynced)
+    {
+        // Maps GPU timestamps onto the CPU clock so both tracks line up in captures
+        GLint64 GpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &GpuNow);
+        GpuClockOffset = static_cast<int64_t>(Now()) - GpuNow;
+        GpuClockSynced = true;
+    }
+
+    if (!GpuStack.empty())
+    {
+        std::cerr << "Profiler: " << GpuStack.size() << " GPU scopes still open at the end of the frame" << std::endl;
+        GpuStack.clear();
+    }
+
+    // The slot we move to was written FrameLatency - 1 frames ago, read it back before reusing it
+    GpuFrames[GpuFrameIndex].Pending = GpuFrames[GpuFrameIndex].Used > 0;
+    GpuFrameIndex = (GpuFrameIndex + 1) % FrameLatency;
+    GpuFrame &Oldest = GpuFrames[GpuFrameIndex];
+    bool NewGpuEvents = false;
+    if (Oldest.Pending)
+    {
+        size_t Dropped = DroppedGpuFrames;
+        ReadGpuFrame(Oldest);
+        NewGpuEvents = Dropped == DroppedGpuFrames;
+    }
+    Oldest.Used = 0;
+    Oldest.Pending = false;
+
+    FrameEvents.clear();
+    {
+        std::lock_guard<std::mutex> Lock(RegistryMutex);
+        for (std::unique_ptr<ThreadBuffer> &Buffer : Threads)
+        {
+            std::lock_guard<std::mutex> BufferLock(Buffer->Mutex);
+            FrameEvents.insert(FrameEvents.end(), Buffer->Events.begin(), Buffer->Events.end());
+            Buffer->Events.clear();
+        }
+    }
+
+    int Requested = CaptureRequest.exchange(0);
+    if (Requested > 0 && CaptureFramesLeft == 0)
+    {
+        CaptureFramesLeft = Requested;
+        CaptureEvents.clear();
+    }
+    if (CaptureFramesLeft > 0)
+    {
+        CaptureEvents.insert(CaptureEvents.end(), FrameEvents.begin(), FrameEvents.end());
+        if (NewGpuEvents)
+            CaptureEvents.insert(CaptureEvents.end(), GpuEvents.begin(), GpuEvents.end());
+        if (--CaptureFramesLeft == 0)
+            WriteCapture();
+    }
+
+    BuildOverlay();
+}
+
+void Engine::Profiler::BuildOverlay()
+{
+    struct Entry
+    {
+        uint32_t Thread;
+        uint16_t Depth;
+        const char *Name;
+        uint64_t Total;
+        uint64_t FirstStart;
+    };
+    std::vector<Entry> Entries;
+
+    auto Accumulate = [&Entries](const std::vector<CpuEvent> &Events)
+    {
+        for (const CpuEvent &Event : Events)
+        {
+            auto It = std::find_if(Entries.begin(), Entries.end(), [&Event](const Entry &E)
+                                   { return E.Thread == Event.Thread && E.Depth == Event.Depth && std::strcmp(E.Name, Event.Name) == 0; });
+            if (It == Entries.end())
+                Entries.push_back({Event.Thread, Event.Depth, Event.Name, Event.End - Event.Start, Event.Start});
+            else
+            {
+                It->Total += Event.End - Event.Start;
+                It->FirstStart = std::min(It->FirstStart, Event.Start);
+            }
+        }
+    };
+    Accumulate(FrameEvents);
+    Accumulate(GpuEvents);
+
+    std::stable_sort(Entries.begin(), Entries.end(), [](const Entry &A, const Entry &B)
+                     { return A.Thread != B.Thread ? A.Thread < B.Thread : A.FirstStart < B.FirstStart; });
+
+    std::ostringstream Text;
+    Text << std::fixed << std::setprecision(2);
+    uint32_t CurrentThread = GpuTrack - 1;
+    for (const Entry &Item : Entries)
+    {
+        if (Item.Thread != CurrentThread)
+        {
+            CurrentThread = Item.Thread;
+            if (Item.Thread == GpuTrack)
+                Text << "GPU (" << FrameLatency << " frames behind)\n";
+            else
+            {
+                std::lock_guard<std::mutex> Lock(RegistryMutex);
+                std::lock_guard<std::mutex> BufferLock(Threads[Item.Thread]->Mutex);
+                Text << Threads[Item.Thread]->Name << "\n";
+            }
+        }
+        Text << std::string((Item.Depth + 1) * 2, ' ') << Item.Name << " " << Item.Total / 1.0e6 << " ms\n";
+    }
+
+    std::lock_guard<std::mutex> Lock(OverlayMutex);
+    OverlayText = Text.str();
+}
+
+std::string Engine::Profiler::GetOverlayText()
+{
+    std::lock_guard<std::mutex> Lock(OverlayMutex);
+    return OverlayText;
+}
+
+void Engine::Profiler::RequestCapture(int FrameCount)
+{
+    CaptureRequest = std::max(FrameCount, 1);
+}
+
+void Engine::Profiler::WriteCapture()
+{
+    std::filesystem::path Directory = std::filesystem::path(Util::GetExecutablePath()) / "Profiles";
+    std::error_code Error;
+    std::filesystem::create_directories(Directory, Error);
+    std::filesystem::path FilePath = Directory / ("trace_" + std::to_string(std::time(nullptr)) + ".json");
+
+    std::ofstream File(FilePath);
+    if (!File)
+    {
+        std::cerr << "Profiler: Could not write " << FilePath.string() << std::endl;
+        return;
+    }
+
+    // Chrome trace event format, complete ("X") events in microseconds
+    File << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool First = true;
+    for (const CpuEvent &Event : CaptureEvents)
+    {
+        File << (First ? "" : ",\n") << "{\"name\":\"" << Event.Name << "\",\"cat\":\"" << (Event.Thread == GpuTrack ? "gpu" : "cpu")
+             << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (Event.Thread == GpuTrack ? 1000u : Event.Thread)
+             << ",\"ts\":" << Event.Start / 1000.0 << ",\"dur\":" << (Event.End - Event.Start) / 1000.0 << "}";
+        First = false;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(RegistryMutex);
+        for (const std::unique_ptr<ThreadBuffer> &Buffer : Threads)
+        {
+            std::lock_guard<std::mutex> BufferLock(Buffer->Mutex);
+            File << (First ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << Buffer->Index
+                 << ",\"args\":{\"name\":\"" << Buffer->Name << "\"}}";
+            First = false;
+        }
+    }
+    File << (First ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1000,\"args\":{\"name\":\"GPU\"}}\n]}\n";
+
+    std::cout << "Profiler: Wrote " << CaptureEvents.size() << " events to " << FilePath.string() << std::endl;
+    CaptureEvents.clear();
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#ifndef profiler_h
+#define profiler_h
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <glad/glad.h>
+#include "../../util/util.h"
+
+// Profiling markers are compiled in for debug builds, or when ENGINE_PROFILE=1 is defined explicitly
+#ifndef ENGINE_PROFILE
+#ifdef NDEBUG
+#define ENGINE_PROFILE 0
+#else
+#define ENGINE_PROFILE 1
+#endif
+#endif
+
+namespace Engine
+{
+    // Collects nested CPU scopes from every thread and GPU timestamp scopes from the GL thread. GPU results
+    // are read back FrameLatency frames later and only if they are already available, so the profiler never
+    // stalls the pipeline. Produces a per-frame text breakdown and Chrome trace (chrome://tracing, Perfetto)
+    // captures on request.
+    class Profiler
+    {
+    public:
+        static constexpr int FrameLatency = 4;
+
+        static void SetEnabled(bool Enabled);
+        static bool IsEnabled();
+        static void SetThreadName(const std::string &Name);
+
+        static void BeginCpu(const char *Name);
+        static void EndCpu();
+        // GL thread only
+        static void BeginGpu(const char *Name);
+        static void EndGpu();
+
+        // Called by the GL thread once per frame after the last GPU scope
+        static void EndFrame();
+
+        // Breakdown of the last frame, safe to call from any thread
+        static std::string GetOverlayText();
+        // Writes the next FrameCount frames to Profiles/trace_<n>.json next to the executable
+        static void RequestCapture(int FrameCount);
+
+        static uint64_t Now();
+
+    private:
+        struct CpuEvent
+        {
+            const char *Name;
+            uint64_t Start, End;
+            uint32_t Thread;
+            uint16_t Depth;
+        };
+
+        struct ThreadBuffer
+        {
+            std::mutex Mutex;
+            std::string Name;
+            uint32_t Index;
+            std::vector<CpuEvent> Events;
+        };
+
+        struct GpuQuery
+        {
+            const char *Name;
+            GLuint Start, End;
+            uint16_t Depth;
+        };
+
+        struct GpuFrame
+        {
+            std::vector<GpuQuery> Queries;
+            size_t Used = 0;
+            bool Pending = false;
+        };
+
+        static std::atomic<bool> Enabled;
+        static std::atomic<int> CaptureRequest;
+        static std::mutex RegistryMutex;
+        static std::vector<std::unique_ptr<ThreadBuffer>> Threads;
+
+        static GpuFrame GpuFrames[FrameLatency];
+        static int GpuFrameIndex;
+        static std::vector<size_t> GpuStack;
+        static int64_t GpuClockOffset;
+        static bool GpuClockSynced;
+        static size_t DroppedGpuFrames;
+
+        static std::mutex OverlayMutex;
+        static std::string OverlayText;
+        static std::vector<CpuEvent> FrameEvents;
+        static std::vector<CpuEvent> GpuEvents;
+
+        static int CaptureFramesLeft;
+        static std::vector<CpuEvent> CaptureEvents;
+
+        static ThreadBuffer &GetThreadBuffer();
+        static void ReadGpuFrame(GpuFrame &Frame);
+        static void BuildOverlay();
+        static void WriteCapture();
+    };
+
+    class ProfileScope
+    {
+    public:
+        explicit ProfileScope(const char *Name) { Profiler::BeginCpu(Name); }
+        ~ProfileScope() { Profiler::EndCpu(); }
+    };
+
+    class GpuProfileScope
+    {
+    public:
+        explicit GpuProfileScope(const char *Name) { Profiler::BeginGpu(Name); }
+        ~GpuProfileScope() { Profiler::EndGpu(); }
+    };
+};
+
+#define ENGINE_PROFILE_CONCAT_INNER(A, B) A##B
+#define ENGINE_PROFILE_CONCAT(A, B) ENGINE_PROFILE_CONCAT_INNER(A, B)
+
+#if ENGINE_PROFILE
+#define ENGINE_PROFILE_SCOPE(Name) Engine::ProfileScope ENGINE_PROFILE_CONCAT(ProfileScope, __LINE__)(Name)
+#define ENGINE_PROFILE_FUNCTION() ENGINE_PROFILE_SCOPE(__func__)
+#define ENGINE_PROFILE_GPU_SCOPE(Name)                                                      \
+    Engine::ProfileScope ENGINE_PROFILE_CONCAT(ProfileScope, __LINE__)(Name);             \
+    Engine::GpuProfileScope ENGINE_PROFILE_CONCAT(GpuProfileScope, __LINE__)(Name)
+#define ENGINE_PROFILE_THREAD(Name) Engine::Profiler::SetThreadName(Name)
+#define ENGINE_PROFILE_END_FRAME() Engine::Profiler::EndFrame()
+#else
+#define ENGINE_PROFILE_SCOPE(Name) ((void)0)
+#define ENGINE_PROFILE_FUNCTION() ((void)0)
+#define ENGINE_PROFILE_GPU_SCOPE(Name) ((void)0)
+#define ENGINE_PROFILE_THREAD(Name) ((void)0)
+#define ENGINE_PROFILE_END_FRAME() ((void)0)
+#endif
+
+#endif
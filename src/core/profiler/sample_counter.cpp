@@ -0,0 +1,47 @@
+#include "sample_counter.h"
+
+Engine::SampleCounter::SampleCounter()
+{
+    glGenQueries(Latency, Queries);
+}
+
+Engine::SampleCounter::~SampleCounter()
+{
+    glDeleteQueries(Latency, Queries);
+}
+
+void Engine::SampleCounter::Begin()
+{
+    // The query about to be reused was issued Latency frames ago, a result still not available is dropped
+    if (Pending[Index])
+    {
+        GLint Available = 0;
+        glGetQueryObjectiv(Queries[Index], GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (Available)
+        {
+            GLuint64 Samples = 0;
+            glGetQueryObjectui64v(Queries[Index], GL_QUERY_RESULT, &Samples);
+            Last = Samples;
+        }
+        Pending[Index] = false;
+    }
+
+    glBeginQuery(GL_SAMPLES_PASSED, Queries[Index]);
+    Counting = true;
+}
+
+void Engine::SampleCounter::End()
+{
+    if (!Counting)
+        return;
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    Pending[Index] = true;
+    Index = (Index + 1) % Latency;
+    Counting = false;
+}
+
+uint64_t Engine::SampleCounter::GetLast() const
+{
+    return Last;
+}
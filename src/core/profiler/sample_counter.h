@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef sample_counter_h
+#define sample_counter_h
+
+#include <atomic>
+#include <cstdint>
+#include <glad/glad.h>
+
+namespace Engine
+{
+    // Counts the samples that pass the depth test between Begin and End, e.g. how many G-buffer fragments
+    // get shaded. Results are read back Latency frames later and only once available, like the profiler's
+    // GPU scopes, so counting never stalls. Begin and End are GL thread only, the last result can be read
+    // from any thread and is always compiled in, unlike the profiler.
+    class SampleCounter
+    {
+    public:
+        static constexpr int Latency = 4;
+
+        SampleCounter();
+        ~SampleCounter();
+
+        void Begin();
+        void End();
+
+        // Samples counted in the most recent frame whose result came back, 0 before the first one
+        uint64_t GetLast() const;
+
+    private:
+        GLuint Queries[Latency] = {};
+        bool Pending[Latency] = {};
+        int Index = 0;
+        bool Counting = false;
+        std::atomic<uint64_t> Last{0};
+    };
+};
+
+#endif
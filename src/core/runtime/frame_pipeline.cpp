@@ -0,0 +1,72 @@
+#include "frame_pipeline.h"
+
+Engine::FrameSnapshot *Engine::FramePipeline::BeginSimulation()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+
+    // A slot is free when it is neither being drawn nor holding a frame the renderer has not picked up yet
+    auto FreeSlot = [this]()
+    {
+        for (int i = 0; i < 2; ++i)
+        {
+            if (i != Reading && i != Published)
+                return i;
+        }
+        return -1;
+    };
+    Changed.wait(Lock, [&]()
+                 { return Stopped || FreeSlot() >= 0; });
+    if (Stopped)
+        return nullptr;
+
+    Writing = FreeSlot();
+    Snapshots[Writing].FrameIndex = FrameCounter++;
+    return &Snapshots[Writing];
+}
+
+void Engine::FramePipeline::EndSimulation()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Published = Writing;
+        Writing = -1;
+    }
+    Changed.notify_all();
+}
+
+const Engine::FrameSnapshot *Engine::FramePipeline::BeginRender()
+{
+    std::unique_lock<std::mutex> Lock(Mutex);
+    Changed.wait(Lock, [this]()
+                 { return Stopped || Published >= 0; });
+    if (Stopped)
+        return nullptr;
+
+    Reading = Published;
+    Published = -1;
+    return &Snapshots[Reading];
+}
+
+void Engine::FramePipeline::EndRender()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Reading = -1;
+    }
+    Changed.notify_all();
+}
+
+void Engine::FramePipeline::Stop()
+{
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Stopped = true;
+    }
+    Changed.notify_all();
+}
+
+bool Engine::FramePipeline::IsStopped() const
+{
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Stopped;
+}
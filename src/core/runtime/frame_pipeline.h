@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef frame_pipeline_h
+#define frame_pipeline_h
+
+#include <mutex>
+#include <condition_variable>
+#include "frame_snapshot.h"
+
+namespace Engine
+{
+    // Double-buffered handoff between the simulation and render threads. The simulation writes one snapshot
+    // while the renderer draws the previous one, so a frame costs max(sim, render) instead of their sum and
+    // the simulation never runs more than one frame ahead.
+    class FramePipeline
+    {
+    public:
+        // Blocks until a snapshot is free to write, returns nullptr once the pipeline is stopped
+        FrameSnapshot *BeginSimulation();
+        void EndSimulation();
+
+        // Blocks until a new snapshot is published, returns nullptr once the pipeline is stopped
+        const FrameSnapshot *BeginRender();
+        void EndRender();
+
+        // Wakes both threads and makes every further Begin call return nullptr
+        void Stop();
+        bool IsStopped() const;
+
+    private:
+        FrameSnapshot Snapshots[2];
+        int Writing = -1;
+        int Reading = -1;
+        int Published = -1;
+        uint64_t FrameCounter = 0;
+        bool Stopped = false;
+
+        mutable std::mutex Mutex;
+        std::condition_variable Changed;
+    };
+};
+
+#endif
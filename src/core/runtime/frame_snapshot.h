@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef frame_snapshot_h
+#define frame_snapshot_h
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "../../rendering/camera/camera.h"
+#include "../../rendering/model/model.h"
+#include "../../rendering/lighting/light.h"
+#include "../../rendering/shadows/cascaded_shadows.h"
+#include "../../rendering/shadows/local_shadow_atlas.h"
+#include "../../rendering/antialiasing/temporal_aa.h"
+
+namespace Engine
+{
+    // Everything the renderer needs to draw one frame. The simulation thread fills a snapshot, after it is
+    // published the render thread only reads it, so neither thread touches the other's state mid-frame.
+    struct FrameSnapshot
+    {
+        using Instance = Model::InstanceRef;
+
+        uint64_t FrameIndex = 0;
+        double Time = 0.0;
+        float DeltaTime = 0.0f;
+        unsigned int Width = 0, Height = 0;
+        // Size the scene is drawn at inside the Width x Height targets, smaller under dynamic resolution
+        glm::uvec2 RenderSize = glm::uvec2(0);
+
+        // Projection uses Width and Height of this snapshot
+        Camera View = Camera(Camera::CameraMode::Perspective, nullptr, nullptr);
+        std::vector<Instance> Instances;
+        // Scene draws culled, sorted and recorded by the simulation thread, replayed as is by the renderer
+        std::vector<CommandList> SceneCommands;
+        // Depth only draws of the opaque scene, empty when the pre-pass is off
+        std::vector<CommandList> PrepassCommands;
+        std::vector<Light> PointLights, DirectionalLights, SpotLights;
+        // Sun shadow cascades and the caster draws they need this frame
+        CascadedShadows::Frame Shadows;
+        // Point and spot light shadow tiles to redraw and the lights that have one
+        LocalShadowAtlas::Frame LocalShadows;
+        // Camera jitter of the frame, resolved against the history when enabled
+        TemporalAA::Frame Temporal;
+        std::vector<std::string> UIText;
+    };
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "transform_hierarchy.h"
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRANSFORM_HIERARCHY_SSE 1
+#else
+#define TRANSFORM_HIERARCHY_SSE 0
+#endif
+
+int Engine::TransformHierarchy::Add(const glm::mat4 &Local, int Parent)
+{
+    int Node = static_cast<int>(Parents.size());
+    Parents.push_back((Parent >= 0 && Parent < Node) ? Parent : None);
+    Locals.push_back(Local);
+    Worlds.push_back(Local);
+    Dirty.push_back(1);
+    FirstDirty = std::min(FirstDirty, static_cast<size_t>(Node));
+    return Node;
+}
+
+void Engine::TransformHierarchy::SetLocal(int Node, const glm::mat4 &Local)
+{
+    Locals[Node] = Local;
+    Dirty[Node] = 1;
+    FirstDirty = std::min(FirstDirty, static_cast<size_t>(Node));
+}
+
+void Engine::TransformHierarchy::Reserve(size_t Count)
+{
+    Parents.reserve(Count);
+    Locals.reserve(Count);
+    Worlds.reserve(Count);
+    Dirty.reserve(Count);
+}
+
+void Engine::TransformHierarchy::Clear()
+{
+    Parents.clear();
+    Locals.clear();
+    Worlds.clear();
+    Dirty.clear();
+    FirstDirty = 0;
+}
+
+size_t Engine::TransformHierarchy::Update()
+{
+    size_t Count = Parents.size();
+    size_t Updated = 0;
+
+    // Parents come first, so a dirty flag reaches the whole subtree within the same pass
+    for (size_t Node = FirstDirty; Node < Count; ++Node)
+    {
+        int Parent = Parents[Node];
+        if (Parent != None && Dirty[Parent])
+            Dirty[Node] = 1;
+        if (!Dirty[Node])
+            continue;
+
+        if (Parent == None)
+            Worlds[Node] = Locals[Node];
+        else
+            Multiply(Worlds[Parent], Locals[Node], Worlds[Node]);
+        ++Updated;
+    }
+
+    if (FirstDirty < Count)
+        std::fill(Dirty.begin() + FirstDirty, Dirty.end(), 0);
+    FirstDirty = Count;
+    return Updated;
+}
+
+void Engine::TransformHierarchy::Multiply(const glm::mat4 &A, const glm::mat4 &B, glm::mat4 &Out)
+{
+#if TRANSFORM_HIERARCHY_SSE
+    // Column major, every result column is the columns of A weighted by one column of B
+    __m128 A0 = _mm_loadu_ps(&A[0][0]);
+    __m128 A1 = _mm_loadu_ps(&A[1][0]);
+    __m128 A2 = _mm_loadu_ps(&A[2][0]);
+    __m128 A3 = _mm_loadu_ps(&A[3][0]);
+
+    __m128 Columns[4];
+    for (int Column = 0; Column < 4; ++Column)
+    {
+        __m128 Result = _mm_mul_ps(A0, _mm_set1_ps(B[Column][0]));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A1, _mm_set1_ps(B[Column][1])));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A2, _mm_set1_ps(B[Column][2])));
+        Result = _mm_add_ps(Result, _mm_mul_ps(A3, _mm_set1_ps(B[Column][3])));
+        Columns[Column] = Result;
+    }
+
+    // Stored only once every column is computed, Out may be A or B
+    for (int Column = 0; Column < 4; ++Column)
+        _mm_storeu_ps(&Out[Column][0], Columns[Column]);
+#else
+    Out = A * B;
+#endif
+}
+
+glm::mat3 Engine::TransformHierarchy::GetNormalMatrix(const glm::mat4 &Model)
+{
+    // Columns of the inverse transpose are the cofactor columns over the determinant, cheaper than a
+    // general inverse and a transpose
+    glm::vec3 X(Model[0]), Y(Model[1]), Z(Model[2]);
+    glm::mat3 Cofactors(glm::cross(Y, Z), glm::cross(Z, X), glm::cross(X, Y));
+    float Determinant = glm::dot(X, Cofactors[0]);
+    return (Determinant != 0.0f) ? Cofactors * (1.0f / Determinant) : Cofactors;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef transform_hierarchy_h
+#define transform_hierarchy_h
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace Engine
+{
+    // Node transforms stored as parallel arrays, a node is always added after its parent so one forward
+    // pass sees every parent before its children. Changing a local transform only flags the node, Update
+    // then recomputes the world matrix of flagged nodes and everything below them and leaves the rest.
+    class TransformHierarchy
+    {
+    public:
+        static constexpr int None = -1;
+
+        // Returns the index of the new node, Parent has to be an existing node or None
+        int Add(const glm::mat4 &Local, int Parent = None);
+        void SetLocal(int Node, const glm::mat4 &Local);
+        void Reserve(size_t Count);
+        void Clear();
+
+        // Propagates dirty nodes down to their subtrees, returns how many world matrices were recomputed
+        size_t Update();
+
+        size_t GetCount() const { return Parents.size(); }
+        int GetParent(int Node) const { return Parents[Node]; }
+        const glm::mat4 &GetLocal(int Node) const { return Locals[Node]; }
+        // Valid after Update
+        const glm::mat4 &GetWorld(int Node) const { return Worlds[Node]; }
+
+        // Out = A * B with SSE where available, Out may alias either input
+        static void Multiply(const glm::mat4 &A, const glm::mat4 &B, glm::mat4 &Out);
+        // Inverse transpose of the upper 3x3, transforms normals correctly under non-uniform scale
+        static glm::mat3 GetNormalMatrix(const glm::mat4 &Model);
+
+    private:
+        std::vector<int> Parents;
+        std::vector<glm::mat4> Locals;
+        std::vector<glm::mat4> Worlds;
+        std::vector<uint8_t> Dirty;
+        // Nodes before this one are all clean, the forward pass starts here
+        size_t FirstDirty = 0;
+    };
+};
+
+#endif
@@ -1,6 +1,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #define NOMINMAX
 #include <thread>
+#include <atomic>
 #include <iostream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,76 +9,154 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <sstream>
 #include <algorithm>
+#include <filesystem>
 
 #include "rendering/render_target/render_target.h"
 #include "rendering/camera/camera.h"
 #include "rendering/sprites/sprite.h"
+#include "rendering/sprites/sprite_batch.h"
+#include "rendering/sprites/texture_atlas.h"
 #include "rendering/materials/material.h"
 #include "rendering/model/model.h"
 #include "rendering/text/text.h"
-
-unsigned int WindowWidth = 800, WindowHeight = 600;
-
-struct Light
-{
-    glm::vec3 Position, Direction, Color;
-    float Intensity, CutOff, OuterCutOff;
-};
+#include "rendering/shadows/cascaded_shadows.h"
+#include "rendering/shadows/local_shadow_atlas.h"
+#include "rendering/resolution/dynamic_resolution.h"
+#include "rendering/antialiasing/temporal_aa.h"
+#include "core/jobs/job_system.h"
+#include "core/runtime/frame_pipeline.h"
+#include "core/profiler/profiler.h"
+#include "core/profiler/sample_counter.h"
+#include "core/platform/platform.h"
+#include "core/memory/frame_arena.h"
+#include "benchmarks/job_benchmark.h"
+#include "benchmarks/frame_benchmark.h"
+#include "benchmarks/cpu_benchmark.h"
+#include "benchmarks/stress_scene.h"
+
+// Window size as reported on the main thread, the render thread draws at the size of its current snapshot
+std::atomic<unsigned int> WindowWidth{800}, WindowHeight{600};
+unsigned int RenderWidth = 800, RenderHeight = 600;
+
+using Engine::Light;
 std::vector<Light> PointLights, DirectionalLights, Spotlights;
 
-Engine::Camera MainCamera(Engine::Camera::CameraMode::Perspective, &WindowWidth, &WindowHeight);
+Engine::FramePipeline Pipeline;
+Engine::Camera MainCamera(Engine::Camera::CameraMode::Perspective, &RenderWidth, &RenderHeight);
 Engine::RenderTarget *SceneRenderTarget;
+// Final image target for headless runs, nullptr draws to the window
+Engine::RenderTarget *OutputRenderTarget = nullptr;
+// Lit scene at the internal resolution, only drawn through while the render scale is below 1
+Engine::RenderTarget *LightingRenderTarget = nullptr;
+Engine::Material *UpscaleMaterial = nullptr;
+Engine::Sprite *UpscaleSprite = nullptr;
+Engine::DynamicResolution::Settings ResolutionSettings;
+Engine::DynamicResolution *Resolution = nullptr;
+std::atomic<bool> UseDynamicResolution{true};
+Engine::TemporalAA *Temporal = nullptr;
+std::atomic<bool> UseTemporalAA{true};
+Engine::Material *PrepassMaterial = nullptr;
+// Off by default, it only pays off once overdraw outweighs the extra geometry pass (F8 or --depth-prepass on)
+std::atomic<bool> UseDepthPrepass{false};
+Engine::SampleCounter *GBufferSamples = nullptr;
 Engine::Sprite *RenderTargetSprite;
 Engine::Material *RenderTargetMaterial, *SpriteMaterial, *FontMaterial;
 Engine::Sprite *TestSprite;
-Engine::Model::ModelInstance *Model;
+Engine::Model::ModelInstance *Model = nullptr;
+// Generated scene for --scene stress, drawn instead of the model when set
+Engine::StressScene *Stress = nullptr;
+Engine::CascadedShadows *SunShadows = nullptr;
+Engine::LocalShadowAtlas *LocalShadows = nullptr;
+Engine::GlyphAtlas *FontAtlas;
 Engine::Text *UIText;
+Engine::TextBlock *HUDText;
+std::string DeviceInfo;
+std::atomic<bool> ShowProfiler{false};
+std::atomic<bool> ShowMemory{false};
+// Heap allocations made by the last simulated and rendered frame, see ENGINE_TRACK_ALLOCATIONS
+std::atomic<uint64_t> SimulationAllocations{0}, RenderAllocations{0};
 
 float LastTime = 0.0f, DeltaTime = 0.0f, FPS = 0.0f;
+double ShaderSubmitTime = 0.0;
+bool ShadersReady = false;
 
 void InitRenderTarget()
 {
-    SceneRenderTarget = new Engine::RenderTarget(glm::vec2(WindowWidth, WindowHeight), {{GL_RGBA16F, GL_RGBA, GL_UNSIGNED_BYTE}, {GL_RGB16F, GL_RGB, GL_FLOAT}, {GL_RGB16F, GL_RGB, GL_FLOAT}, {GL_R32F, GL_RED, GL_FLOAT}, {GL_R16F, GL_RED, GL_FLOAT}, {GL_R16F, GL_RED, GL_FLOAT}, {GL_RGB16F, GL_RGB, GL_FLOAT}});
-    RenderTargetMaterial = new Engine::Material("Assets/Shaders/Deferred/Vert.glsl", "Assets/Shaders/Deferred/Lighting.glsl", {});
-    RenderTargetSprite = new Engine::Sprite(RenderTargetMaterial, glm::vec2(0, 0), glm::vec2(0, 0), &WindowWidth, &WindowHeight);
+    SceneRenderTarget = new Engine::RenderTarget(glm::vec2(RenderWidth, RenderHeight), {{GL_RGBA16F, GL_RGBA, GL_UNSIGNED_BYTE}, {GL_RGB16F, GL_RGB, GL_FLOAT}, {GL_RGB16F, GL_RGB, GL_FLOAT}, {GL_R32F, GL_RED, GL_FLOAT}, {GL_R16F, GL_RED, GL_FLOAT}, {GL_R16F, GL_RED, GL_FLOAT}, {GL_RGB16F, GL_RGB, GL_FLOAT}, {GL_RG16F, GL_RG, GL_FLOAT}});
+    RenderTargetMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Deferred/Lighting.glsl", {});
+    RenderTargetSprite = new Engine::Sprite(RenderTargetMaterial, glm::vec2(0, 0), glm::vec2(0, 0), &RenderWidth, &RenderHeight);
+    // Full screen passes must not be depth tested against whatever the target holds
+    RenderTargetMaterial->SetDepthSortingMode(Engine::Material::DepthSortingMode::None);
+    RenderTargetMaterial->Compile();
+    SunShadows = new Engine::CascadedShadows(Engine::CascadedShadows::Settings());
+    LocalShadows = new Engine::LocalShadowAtlas(Engine::LocalShadowAtlas::Settings());
+
+    LightingRenderTarget = new Engine::RenderTarget(glm::vec2(RenderWidth, RenderHeight), {{GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}});
+    UpscaleMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Upscale/Frag.glsl", {});
+    UpscaleSprite = new Engine::Sprite(UpscaleMaterial, glm::vec2(0, 0), glm::vec2(0, 0), &RenderWidth, &RenderHeight);
+    UpscaleMaterial->SetDepthSortingMode(Engine::Material::DepthSortingMode::None);
+    UpscaleMaterial->Compile();
+    Resolution = new Engine::DynamicResolution(ResolutionSettings);
+    Temporal = new Engine::TemporalAA(Engine::TemporalAA::Settings());
+
+    PrepassMaterial = new Engine::Material("Assets/Shaders/Depth/Vert.glsl", "Assets/Shaders/Depth/Frag.glsl", {});
+    PrepassMaterial->Compile();
+    GBufferSamples = new Engine::SampleCounter();
 }
 
 void InitText()
 {
-    FontMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Main/Frag.glsl", {"Assets/Textures/Font/Arial.png"});
+    // Prefer the SDF glyph atlas, fall back to the fixed bitmap grid font when the engine was built without FreeType
+    FontAtlas = new Engine::GlyphAtlas("Assets/Fonts/Lato-Regular.ttf");
+    if (FontAtlas->IsLoaded())
+    {
+        FontMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Text/Frag.glsl");
+        UIText = new Engine::Text(FontMaterial, FontAtlas, glm::vec2(0, 0), 32.0f, &RenderWidth, &RenderHeight);
+    }
+    else
+    {
+        delete FontAtlas;
+        FontAtlas = nullptr;
+        FontMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Main/Frag.glsl", {"Assets/Textures/Font/Arial.png"});
+        UIText = new Engine::Text(FontMaterial, glm::vec2(0, 0), 32.0f, &RenderWidth, &RenderHeight);
+        UIText->SetSpacing(0.6f);
+    }
+
     FontMaterial->SetUniform("Color", glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));
     FontMaterial->SetDepthSortingMode(Engine::Material::DepthSortingMode::None);
     FontMaterial->SetBlendingMode(Engine::Material::BlendingMode::AlphaBlend);
-    UIText = new Engine::Text(FontMaterial, glm::vec2(0, 0), 32.0f, &WindowWidth, &WindowHeight);
-    UIText->SetSpacing(0.6f);
-}
-
-void RenderText(const std::string &Text)
-{
-    float ScaleFactor = std::min(WindowWidth, WindowHeight) / 10.0f;
-    UIText->SetPosition(glm::vec2(ScaleFactor/2, ScaleFactor / 2));
-    UIText->SetScale(ScaleFactor / 3);
+    FontMaterial->Compile();
+    HUDText = new Engine::TextBlock(UIText);
 
     std::string GpuVendor = reinterpret_cast<const char*>(glGetString(GL_VENDOR));
     std::string GpuRenderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
     std::string OpenGLVersion = reinterpret_cast<const char*>(glGetString(GL_VERSION));
     std::string GlslVersion = reinterpret_cast<const char*>(glGetString(GL_SHADING_LANGUAGE_VERSION));
 
-    std::string DisplayText = Text + "\n" +
-                              "Sponza Scene" + "\n" +
-                              "GPU: " + GpuVendor + " - " + GpuRenderer + "\n" +
-                              "OpenGL: " + OpenGLVersion + "\n" +
-                              "GLSL: " + GlslVersion;
+    DeviceInfo = std::string("Sponza Scene") + "\n" +
+                 "GPU: " + GpuVendor + " - " + GpuRenderer + "\n" +
+                 "OpenGL: " + OpenGLVersion + "\n" +
+                 "GLSL: " + GlslVersion;
+}
 
-    UIText->Render(DisplayText, Engine::Text::TextAlign::Left);
+void RenderText(const std::string &Text)
+{
+    float ScaleFactor = std::min(RenderWidth, RenderHeight) / 10.0f;
+    HUDText->SetPosition(glm::vec2(ScaleFactor/2, ScaleFactor / 2));
+    HUDText->SetScale(ScaleFactor / 3);
+    Engine::FrameString Combined(Text.data(), Text.size());
+    Combined.append("\n").append(DeviceInfo.data(), DeviceInfo.size());
+    HUDText->SetText(Combined);
+    HUDText->Render();
 }
 
 
-void InitModel()
+void InitModel(const std::string &ScenePath = "Assets/Models/Sponza.obj")
 {
     DirectionalLights.push_back({{}, glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), 2, 0, 0});
 
-    Engine::Model::Mesh Mesh = Engine::Model::LoadMesh("Assets/Models/Sponza.obj");
+    Engine::Model::Mesh Mesh = Engine::Model::LoadMesh(ScenePath);
+    std::string TextureDirectory = std::filesystem::path(ScenePath).parent_path().generic_string() + "/";
     std::vector<Engine::Material *> AssignedMaterials(Mesh.MaterialData.size(), nullptr);
 
     for (const auto &Light : Mesh.Lights)
@@ -90,6 +169,16 @@ void InitModel()
             Spotlights.push_back({Light.Position, Light.Direction, Light.Color, Light.Intensity, Light.InnerCone, Light.OuterCone});
     }
 
+    // Textures are decoded on the job system and uploaded back on the main thread while it waits
+    struct TextureLoad
+    {
+        Engine::Material *Target;
+        int Unit;
+        std::string Path;
+    };
+    std::vector<TextureLoad> TextureLoads;
+    constexpr int OpacityUnit = 5;
+
     for (size_t i = 0; i < Mesh.MaterialData.size(); ++i)
     {
         Engine::Model::MaterialData &Data = Mesh.MaterialData[i];
@@ -97,24 +186,71 @@ void InitModel()
         NewMaterial->SetUniform("Color", Data.DiffuseColor);
         if (!Data.DiffuseTextures.empty())
         {
-            NewMaterial->LoadTexture(0, "Assets/Models/" + Data.DiffuseTextures[0]);
-            NewMaterial->SetUniform("UseTexture", true);
+            TextureLoads.push_back({NewMaterial, 0, TextureDirectory + Data.DiffuseTextures[0]});
+            NewMaterial->EnableKeyword("USE_TEXTURE");
         }
         if (!Data.NormalTextures.empty())
         {
-            NewMaterial->LoadTexture(1, "Assets/Models/" + Data.NormalTextures[0]);
-            NewMaterial->SetUniform("UseNormal", true);
+            TextureLoads.push_back({NewMaterial, 1, TextureDirectory + Data.NormalTextures[0]});
+            NewMaterial->EnableKeyword("USE_NORMAL");
         }
         if (!Data.SpecularTextures.empty())
         {
-            NewMaterial->LoadTexture(2, "Assets/Models/" + Data.SpecularTextures[0]);
-            NewMaterial->LoadTexture(3, "Assets/Models/" + Data.SpecularTextures[0]);
-            NewMaterial->SetUniform("UseMetallic", true);
-            NewMaterial->SetUniform("UseRoughness", true);
+            TextureLoads.push_back({NewMaterial, 2, TextureDirectory + Data.SpecularTextures[0]});
+            TextureLoads.push_back({NewMaterial, 3, TextureDirectory + Data.SpecularTextures[0]});
+            NewMaterial->EnableKeyword("USE_METALLIC");
+            NewMaterial->EnableKeyword("USE_ROUGHNESS");
+        }
+        // Opaque materials keep early depth testing and the depth pre-pass. Masked ones cut out at a fixed
+        // threshold after them, translucent ones dither and draw after everything else
+        if (Data.Alpha != Engine::Model::MaterialData::AlphaMode::Opaque)
+        {
+            NewMaterial->SetAlphaTest(true);
+            if (!Data.OpacityTextures.empty())
+            {
+                TextureLoads.push_back({NewMaterial, OpacityUnit, TextureDirectory + Data.OpacityTextures[0]});
+                NewMaterial->SetUniform("OpacityTexture", OpacityUnit);
+                NewMaterial->EnableKeyword("USE_OPACITY");
+            }
         }
+        if (Data.Alpha == Engine::Model::MaterialData::AlphaMode::Masked)
+            NewMaterial->EnableKeyword("USE_ALPHA_CUTOFF");
+        else if (Data.Alpha == Engine::Model::MaterialData::AlphaMode::Translucent)
+            NewMaterial->SetSortOrder(1);
+        NewMaterial->Compile();
         AssignedMaterials[i] = NewMaterial;
     }
 
+    Engine::JobCounter TexturesLoaded;
+    for (const TextureLoad &Load : TextureLoads)
+    {
+        Engine::JobSystem::Run([Load, &TexturesLoaded]()
+        {
+            Engine::Util::TextureData Image = Engine::Util::DecodeTexture(Load.Path);
+            Engine::JobSystem::RunOnMainThread([Load, Image]() mutable
+            {
+                if (!Image.Pixels)
+                {
+                    std::cout << "Failed to load texture: " << Load.Path << std::endl;
+                    return;
+                }
+                unsigned int TextureID = Engine::Util::LoadTextureFromData(Image.Pixels, Image.Width, Image.Height, Image.NumChannels);
+                Engine::Util::FreeTextureData(Image);
+                if (TextureID)
+                    Load.Target->SetTexture(Load.Unit, TextureID);
+                else
+                {
+                    // An unbound mask samples as 0 and would cut the whole surface away, fall back to the base alpha
+                    std::cout << "Failed to upload texture: " << Load.Path << std::endl;
+                    if (Load.Unit == OpacityUnit)
+                        Load.Target->DisableKeyword("USE_OPACITY");
+                }
+            }, &TexturesLoaded);
+        }, &TexturesLoaded);
+    }
+    Engine::JobSystem::Wait(TexturesLoaded);
+    std::cout << "Loaded " << TextureLoads.size() << " textures on " << Engine::JobSystem::GetWorkerCount() << " workers" << std::endl;
+
     std::vector<Engine::Material *> MeshMaterials;
     for (const auto &MeshInstance : Mesh.Meshes)
         MeshMaterials.push_back(AssignedMaterials[MeshInstance.MaterialIndex]);
@@ -122,13 +258,9 @@ void InitModel()
     Model = new Engine::Model::ModelInstance(Mesh, MeshMaterials, glm::mat4(1.0f));
 }
 
-void RenderModel()
+void RenderModel(const Engine::FrameSnapshot &Snapshot)
 {
-    glm::mat4 ModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -50.0f, 0.0f));
-    ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.25f));
-    Model->Transform = ModelMatrix;
-
-    Engine::Model::DrawModelInstances({*Model}, &MainCamera);
+    Engine::CommandList::Execute(Snapshot.SceneCommands);
 }
 
 void CalculateFPS()
@@ -138,53 +270,140 @@ void CalculateFPS()
     FPS = (DeltaTime > 0) ? 1.0f / DeltaTime : FPS;
 }
 
-void SetLights(const std::vector<Light>& Lights, const std::string& Prefix)
+void PollShaders()
 {
-    RenderTargetSprite->GetMaterial()->SetUniform("Num" + Prefix, (int)Lights.size());
+    // Meshes whose program is still compiling are skipped until it is ready
+    if (ShadersReady || Engine::ShaderLibrary::PollPending() > 0)
+        return;
 
-    for (unsigned int i = 0; i < Lights.size(); i++)
+    ShadersReady = true;
+    std::cout << "All shader programs ready in " << (Engine::Platform::GetTime() - ShaderSubmitTime) * 1000.0 << " ms" << std::endl;
+    Engine::ShaderCache::LogStatistics();
+}
+
+// Runs on the simulation thread, reads and advances scene state and writes the next snapshot
+void SimulateFrame(Engine::FrameSnapshot &Snapshot, double Time, float FrameDeltaTime)
+{
+    ENGINE_PROFILE_FUNCTION();
+    Engine::FrameArena::BeginFrame(Snapshot.FrameIndex);
+    glm::mat4 ModelMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -50.0f, 0.0f));
+    ModelMatrix = glm::scale(ModelMatrix, glm::vec3(0.25f));
+
+    Snapshot.Time = Time;
+    Snapshot.DeltaTime = FrameDeltaTime;
+    Snapshot.Width = WindowWidth;
+    Snapshot.Height = WindowHeight;
+    Snapshot.View = MainCamera;
+    Snapshot.View.SetWindowSize(&Snapshot.Width, &Snapshot.Height);
+    Snapshot.RenderSize = Resolution->GetRenderSize(glm::uvec2(Snapshot.Width, Snapshot.Height));
+    Temporal->SetEnabled(UseTemporalAA);
+    Temporal->Prepare(Snapshot.View, Snapshot.RenderSize, Snapshot.Temporal);
+
+    Snapshot.Instances.clear();
+    ENGINE_PROFILE_SCOPE("RecordScene");
+    const Engine::Material *Prepass = UseDepthPrepass ? PrepassMaterial : nullptr;
+    if (Stress)
+        Engine::Model::RecordModelInstances(Stress->GetInstances(), Snapshot.View, Snapshot.SceneCommands, Prepass, Snapshot.PrepassCommands);
+    else
     {
-        std::string Index = std::to_string(i);
-        RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].Color").c_str(), Lights[i].Color);
-        RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].Intensity").c_str(), Lights[i].Intensity);
+        Snapshot.Instances.push_back({Model, ModelMatrix});
+        Engine::Model::RecordModelInstances(Snapshot.Instances, Snapshot.View, Snapshot.SceneCommands, Prepass, Snapshot.PrepassCommands);
+    }
 
-        if (Prefix == "SpotLights")
-        {
-            RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].Cutoff").c_str(), Lights[i].CutOff);
-            RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].OuterCutoff").c_str(), Lights[i].OuterCutOff);
-        }
+    Snapshot.PointLights = PointLights;
+    Snapshot.DirectionalLights = DirectionalLights;
+    Snapshot.SpotLights = Spotlights;
 
-        if (Prefix == "SpotLights" || Prefix == "PointLights")
-        {
-            RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].Position").c_str(), Lights[i].Position);
-        }
+    // The first directional light is the sun and the only directional one casting shadows
+    glm::vec3 SunDirection = DirectionalLights.empty() ? glm::vec3(0.0f) : DirectionalLights[0].Direction;
+    const std::vector<Engine::Model::InstanceRef> &Casters = Stress ? Stress->GetInstances() : Snapshot.Instances;
+    SunShadows->Prepare(Snapshot.View, SunDirection, Casters, Snapshot.Shadows);
+    LocalShadows->Prepare(Snapshot.View, Snapshot.PointLights, Snapshot.SpotLights, Casters, Snapshot.LocalShadows);
 
-        if (Prefix == "DirectionalLights")
-        {
-            RenderTargetSprite->GetMaterial()->SetUniform((Prefix + "[" + Index + "].Direction").c_str(), Lights[i].Direction);
-        }
-    }
+    Engine::FrameStringStream SS;
+    SS << "FPS: " << static_cast<int>(FPS);
+    if (ShowProfiler)
+        SS << "\n" << Engine::Profiler::GetOverlayText() << "\nShadow tiles redrawn: " << SunShadows->GetStaticRefreshCount()
+           << "\nShadow atlas: " << static_cast<int>(LocalShadows->GetOccupancy() * 100.0f + 0.5f) << "% used, "
+           << LocalShadows->GetTilesUpdated() << " tiles updated\n" << Resolution->GetOverlayText()
+           << "\nG-buffer fragments: " << GBufferSamples->GetLast() << (UseDepthPrepass ? " (depth pre-pass)" : "");
+    if (ShowMemory)
+        SS << "\n" << Engine::MemoryTracker::GetOverlayText() << "\nHeap allocations per frame: " << SimulationAllocations
+           << " simulation, " << RenderAllocations << " render";
+    Engine::FrameString Text = SS.str();
+    Snapshot.UIText.resize(1);
+    Snapshot.UIText[0].assign(Text.data(), Text.size());
 }
 
-
-void Render(GLFWwindow *Window)
+// Runs on the render thread, which owns the GL context and only reads the snapshot
+void RenderFrame(const Engine::FrameSnapshot &Snapshot)
 {
-    MainCamera.SetRotation(glm::rotate(glm::mat4(1.0f), (glm::float32)glm::radians(glfwGetTime() * 10.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
-    glfwPollEvents();
+    ENGINE_PROFILE_FUNCTION();
+    Engine::FrameArena::SetThreadFrame(Snapshot.FrameIndex);
+    Engine::JobSystem::PumpMainThread();
+    PollShaders();
+
+    if (Snapshot.Width != RenderWidth || Snapshot.Height != RenderHeight)
+    {
+        RenderWidth = Snapshot.Width;
+        RenderHeight = Snapshot.Height;
+        glViewport(0, 0, RenderWidth, RenderHeight);
+    }
+
+    glm::uvec2 OutputSize(RenderWidth, RenderHeight);
+    glm::uvec2 InternalSize = glm::clamp(Snapshot.RenderSize, glm::uvec2(1), glm::max(OutputSize, glm::uvec2(1)));
+    bool Upscale = InternalSize != OutputSize;
+    // Temporal anti-aliasing resolves into its own history, which is copied to the output instead of upscaling
+    bool Resolve = Snapshot.Temporal.Enabled;
+    Resolution->SetEnabled(UseDynamicResolution);
+    Resolution->BeginFrame(static_cast<float>(InternalSize.x) / std::max(OutputSize.x, 1u));
+
+    SunShadows->Render(Snapshot.Shadows);
+    LocalShadows->Render(Snapshot.LocalShadows);
 
-    SceneRenderTarget->Resize(glm::vec2(WindowWidth, WindowHeight));
+    // Targets keep the output size, a lower render scale only shrinks the viewport inside them
+    SceneRenderTarget->Resize(glm::vec2(OutputSize));
     SceneRenderTarget->Bind();
+    glViewport(0, 0, InternalSize.x, InternalSize.y);
 
+    // The last material may have left depth writes off, which would mask the clear as well
+    glDepthMask(GL_TRUE);
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    RenderModel();
+    if (!Snapshot.PrepassCommands.empty())
+    {
+        ENGINE_PROFILE_GPU_SCOPE("DepthPrepass");
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        Engine::CommandList::Execute(Snapshot.PrepassCommands);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    {
+        ENGINE_PROFILE_GPU_SCOPE("GBuffer");
+        GBufferSamples->Begin();
+        RenderModel(Snapshot);
+        GBufferSamples->End();
+    }
     SceneRenderTarget->Unbind();
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // Set the textures to the material for rendering the final image
+    if (OutputRenderTarget)
+    {
+        OutputRenderTarget->Resize(glm::vec2(RenderWidth, RenderHeight));
+        OutputRenderTarget->Bind();
+    }
+    if (Upscale || Resolve)
+    {
+        LightingRenderTarget->Resize(glm::vec2(OutputSize));
+        LightingRenderTarget->Bind();
+        glViewport(0, 0, InternalSize.x, InternalSize.y);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
     RenderTargetSprite->GetMaterial()->SetTexture(0, SceneRenderTarget->Textures[0]);
     RenderTargetSprite->GetMaterial()->SetTexture(1, SceneRenderTarget->Textures[1]);
     RenderTargetSprite->GetMaterial()->SetTexture(2, SceneRenderTarget->Textures[2]);
@@ -192,40 +411,178 @@ void Render(GLFWwindow *Window)
     RenderTargetSprite->GetMaterial()->SetTexture(4, SceneRenderTarget->Textures[5]);
     RenderTargetSprite->GetMaterial()->SetTexture(5, SceneRenderTarget->Textures[6]);
 
-    // Pass texture uniforms to the shader
-    RenderTargetSprite->GetMaterial()->SetUniform("NormalTexture", 1);
-    RenderTargetSprite->GetMaterial()->SetUniform("PositionTexture", 2);
-    RenderTargetSprite->GetMaterial()->SetUniform("MetallicTexture", 3);
-    RenderTargetSprite->GetMaterial()->SetUniform("RoughnessTexture", 4);
-    RenderTargetSprite->GetMaterial()->SetUniform("EmissionTexture", 5);
-    RenderTargetSprite->GetMaterial()->SetUniform("ViewPosition", MainCamera.GetPosition());
-
-    // Call SetLights for each light type
-    SetLights(PointLights, "PointLights");
-    SetLights(DirectionalLights, "DirectionalLights");
-    SetLights(Spotlights, "SpotLights");
+    // Pass texture uniforms to the shader, names are kept alive so long ones are not rebuilt on the heap every frame
+    static const std::string TextureUniforms[] = {"NormalTexture", "PositionTexture", "MetallicTexture", "RoughnessTexture", "EmissionTexture"};
+    static const std::string ViewPositionUniform = "ViewPosition";
+    static const std::string RenderScaleUniform = "RenderScale";
+    static const std::string LightPrefixes[] = {"PointLights", "DirectionalLights", "SpotLights"};
+    for (int i = 0; i < 5; ++i)
+        RenderTargetSprite->GetMaterial()->SetUniform(TextureUniforms[i], i + 1);
+    RenderTargetSprite->GetMaterial()->SetUniform(ViewPositionUniform, Snapshot.View.GetPosition());
+    RenderTargetSprite->GetMaterial()->SetUniform(RenderScaleUniform, glm::vec2(InternalSize) / glm::vec2(OutputSize));
+
+    // Upload each light type to the lighting material
+    Engine::Light::SetUniforms(RenderTargetSprite->GetMaterial(), Snapshot.PointLights, LightPrefixes[0]);
+    Engine::Light::SetUniforms(RenderTargetSprite->GetMaterial(), Snapshot.DirectionalLights, LightPrefixes[1]);
+    Engine::Light::SetUniforms(RenderTargetSprite->GetMaterial(), Snapshot.SpotLights, LightPrefixes[2]);
+    SunShadows->Apply(RenderTargetSprite->GetMaterial(), 6, Snapshot.Shadows);
+    LocalShadows->Apply(RenderTargetSprite->GetMaterial(), 7, Snapshot.LocalShadows);
 
     // Render the sprite with the updated material (which has all the light uniforms)
-    RenderTargetSprite->SetSize(glm::vec2(WindowWidth, WindowHeight));
-    RenderTargetSprite->Render();
+    {
+        ENGINE_PROFILE_GPU_SCOPE("Lighting");
+        RenderTargetSprite->SetSize(glm::vec2(RenderWidth, RenderHeight));
+        RenderTargetSprite->Render();
+    }
 
-    // FPS Calculation and Display
-    CalculateFPS();
-    std::stringstream SS;
-    SS << "FPS: " << static_cast<int>(FPS);
-    RenderText(SS.str());
+    if (Resolve)
+    {
+        Temporal->Resolve(LightingRenderTarget->Textures[0], SceneRenderTarget->Textures[7], SceneRenderTarget->Textures[3],
+                          InternalSize, OutputSize, Snapshot.Temporal);
+        Temporal->Present(OutputRenderTarget ? OutputRenderTarget->FBO : 0);
+    }
+    else
+        Temporal->InvalidateHistory();
+
+    if (Upscale && !Resolve)
+    {
+        ENGINE_PROFILE_GPU_SCOPE("Upscale");
+        static const std::string InputSizeUniform = "InputSize";
+        static const std::string InputTexelUniform = "InputTexel";
+        if (OutputRenderTarget)
+            OutputRenderTarget->Bind();
+        else
+        {
+            LightingRenderTarget->Unbind();
+            glViewport(0, 0, RenderWidth, RenderHeight);
+        }
+        UpscaleMaterial->SetTexture(0, LightingRenderTarget->Textures[0]);
+        UpscaleMaterial->SetUniform(InputSizeUniform, glm::vec2(InternalSize));
+        UpscaleMaterial->SetUniform(InputTexelUniform, 1.0f / glm::vec2(OutputSize));
+        UpscaleSprite->SetSize(glm::vec2(RenderWidth, RenderHeight));
+        UpscaleSprite->Render();
+    }
 
-    glfwSwapBuffers(Window);
+    if (!Snapshot.UIText.empty())
+    {
+        ENGINE_PROFILE_GPU_SCOPE("Text");
+        RenderText(Snapshot.UIText[0]);
+    }
+
+    if (OutputRenderTarget)
+        OutputRenderTarget->Unbind();
+    Resolution->EndFrame();
 }
 
+void SimulationThread()
+{
+    ENGINE_PROFILE_THREAD("Simulation");
+    while (Engine::FrameSnapshot *Snapshot = Pipeline.BeginSimulation())
+    {
+        uint64_t Allocations = Engine::MemoryTracker::GetThreadAllocationCount();
+        CalculateFPS();
+        MainCamera.SetRotation(glm::rotate(glm::mat4(1.0f), (glm::float32)glm::radians(glfwGetTime() * 10.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        SimulateFrame(*Snapshot, glfwGetTime(), DeltaTime);
+        SimulationAllocations = Engine::MemoryTracker::GetThreadAllocationCount() - Allocations;
+        Pipeline.EndSimulation();
+    }
+}
 
-void FramebufferSizeCallback(GLFWwindow *Window, int Width, int Height)
+void RenderThread(GLFWwindow *Window)
+{
+    // The GL context and every main-thread job follow the renderer onto this thread
+    glfwMakeContextCurrent(Window);
+    Engine::JobSystem::SetMainThread();
+    ENGINE_PROFILE_THREAD("Render");
+
+    while (const Engine::FrameSnapshot *Snapshot = Pipeline.BeginRender())
+    {
+        uint64_t Allocations = Engine::MemoryTracker::GetThreadAllocationCount();
+        RenderFrame(*Snapshot);
+        RenderAllocations = Engine::MemoryTracker::GetThreadAllocationCount() - Allocations;
+        Pipeline.EndRender();
+        {
+            ENGINE_PROFILE_SCOPE("SwapBuffers");
+            glfwSwapBuffers(Window);
+        }
+        ENGINE_PROFILE_END_FRAME();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
+
+
+void FramebufferSizeCallback(GLFWwindow *, int Width, int Height)
 {
     if (Height == 0)
         return;
     WindowWidth = Width;
     WindowHeight = Height;
-    glViewport(0, 0, WindowWidth, WindowHeight);
+}
+
+void KeyCallback(GLFWwindow *, int Key, int, int Action, int)
+{
+    if (Action != GLFW_PRESS)
+        return;
+
+    // F3 toggles the profiler breakdown on the HUD, F4 captures the next 120 frames as a Chrome trace,
+    // F5 toggles the memory totals, F6 toggles dynamic resolution, F7 toggles temporal anti-aliasing,
+    // F8 toggles the depth pre-pass
+    if (Key == GLFW_KEY_F3)
+        ShowProfiler = !ShowProfiler;
+    else if (Key == GLFW_KEY_F4)
+        Engine::Profiler::RequestCapture(120);
+    else if (Key == GLFW_KEY_F5)
+        ShowMemory = !ShowMemory;
+    else if (Key == GLFW_KEY_F6)
+        UseDynamicResolution = !UseDynamicResolution;
+    else if (Key == GLFW_KEY_F7)
+        UseTemporalAA = !UseTemporalAA;
+    else if (Key == GLFW_KEY_F8)
+        UseDepthPrepass = !UseDepthPrepass;
+}
+
+void ReleaseScene()
+{
+    if (Model)
+    {
+        for (auto& mat : Model->Materials)
+            delete mat;
+        Engine::Model::UnloadModelInstance(*Model);
+        Model = nullptr;
+    }
+    delete Stress;
+    Stress = nullptr;
+
+    delete FontMaterial;
+    delete RenderTargetMaterial;
+    delete HUDText;
+    delete UIText;
+    delete FontAtlas;
+    delete RenderTargetSprite;
+    delete SceneRenderTarget;
+    delete SunShadows;
+    SunShadows = nullptr;
+    delete LocalShadows;
+    LocalShadows = nullptr;
+    delete LightingRenderTarget;
+    LightingRenderTarget = nullptr;
+    delete UpscaleSprite;
+    UpscaleSprite = nullptr;
+    delete UpscaleMaterial;
+    UpscaleMaterial = nullptr;
+    delete Resolution;
+    Resolution = nullptr;
+    delete Temporal;
+    Temporal = nullptr;
+    delete PrepassMaterial;
+    PrepassMaterial = nullptr;
+    delete GBufferSamples;
+    GBufferSamples = nullptr;
+    Engine::ShaderLibrary::Release();
+    Engine::UniformArena::Release();
+    Engine::CommandList::Release();
+    Engine::FrameArena::Release();
 }
 
 void RunEngine()
@@ -246,6 +603,7 @@ void RunEngine()
 
     glfwMakeContextCurrent(Window);
     glfwSetFramebufferSizeCallback(Window, FramebufferSizeCallback);
+    glfwSetKeyCallback(Window, KeyCallback);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
@@ -255,31 +613,237 @@ void RunEngine()
         return;
     }
 
+    Engine::Shader::EnableParallelCompile((GLADloadproc)glfwGetProcAddress);
+    ShaderSubmitTime = Engine::Platform::GetTime();
+
     InitRenderTarget();
     InitText();
     InitModel();
+    std::cout << "Shader variants in use: " << Engine::ShaderLibrary::GetVariantCount() << std::endl;
     MainCamera.SetPosition(glm::vec3(0, 0, 1));
 
+    // Main thread keeps the window and input, simulation and rendering run pipelined on their own threads
+    glfwMakeContextCurrent(nullptr);
+    std::thread Simulation(SimulationThread);
+    std::thread Renderer(RenderThread, Window);
+
     while (!glfwWindowShouldClose(Window))
-        Render(Window);
+        glfwWaitEventsTimeout(0.01);
 
-    for (auto& mat : Model->Materials)
-        delete mat;
-    Engine::Model::UnloadModelInstance(*Model);
+    Pipeline.Stop();
+    Simulation.join();
+    Renderer.join();
 
-    delete FontMaterial;
-    delete RenderTargetMaterial;
-    delete UIText;
-    delete RenderTargetSprite;
-    delete SceneRenderTarget;
+    glfwMakeContextCurrent(Window);
+    Engine::JobSystem::SetMainThread();
 
+    ReleaseScene();
     glfwDestroyWindow(Window);
     glfwTerminate();
 }
 
-int main()
+// Context for benchmark runs, a surfaceless one when asked for or when there is no display to open a window on
+GLADloadproc CreateBenchmarkContext(bool Headless, GLFWwindow *&Window)
+{
+    Window = nullptr;
+    if (!Headless && glfwInit())
+    {
+        // The hidden window only provides the context, every frame is drawn into an offscreen target and never presented
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        Window = glfwCreateWindow(64, 64, "Benchmark", nullptr, nullptr);
+        if (Window)
+        {
+            glfwMakeContextCurrent(Window);
+            glfwSwapInterval(0);
+            return (GLADloadproc)glfwGetProcAddress;
+        }
+        glfwTerminate();
+        std::cerr << "Failed to create GLFW window, trying a headless context" << std::endl;
+    }
+
+    if (!Engine::Platform::CreateHeadlessContext(64, 64))
+        return nullptr;
+    return Engine::Platform::GetHeadlessProcAddress();
+}
+
+void DestroyBenchmarkContext(GLFWwindow *Window)
+{
+    if (Window)
+    {
+        glfwDestroyWindow(Window);
+        glfwTerminate();
+    }
+    else
+        Engine::Platform::DestroyHeadlessContext();
+}
+
+// Benchmark scene of the sprite batcher, Count rotating, partly translucent sprites drift over the screen. Most of them draw an
+// entry of the atlas, which keeps them in a single run, every eighth one keeps the material's own texture
+void RenderSprites(Engine::SpriteBatch &Batch, Engine::Material *SpriteMaterial, Engine::TextureAtlas &Atlas,
+                   const std::vector<Engine::TextureAtlas::Handle> &Entries, int Count, double Time)
 {
-    std::thread EngineThread(RunEngine);
-    EngineThread.join();
-    return 0;
+    Atlas.Update();
+
+    OutputRenderTarget->Bind();
+    glDepthMask(GL_TRUE);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::vec2 Screen(RenderWidth, RenderHeight);
+    float Seconds = static_cast<float>(Time);
+    Batch.Begin();
+    for (int i = 0; i < Count; ++i)
+    {
+        float Seed = glm::fract(i * 0.618034f);
+        glm::vec2 Position = glm::fract(glm::vec2(Seed, glm::fract(i * 0.754878f)) + glm::vec2(0.05f, 0.03f) * Seconds) * Screen;
+        glm::vec4 Color(Seed, glm::fract(Seed * 3.0f), glm::fract(Seed * 7.0f), glm::mix(0.35f, 1.0f, glm::fract(Seed * 13.0f)));
+        Engine::TextureAtlas::Handle Entry = Entries[i % Entries.size()];
+        bool OwnTexture = i % 8 == 7;
+        Batch.Draw(SpriteMaterial, OwnTexture ? 0 : Atlas.GetTexture(Entry), Position, glm::vec2(16.0f), Seconds + Seed * 6.283f,
+                   OwnTexture ? glm::vec4(0.0f, 1.0f, 1.0f, 0.0f) : Atlas.GetUV(Entry), Color, glm::vec2(8.0f));
+    }
+    Batch.End();
+    OutputRenderTarget->Unbind();
+}
+
+int RunBenchmark(Engine::FrameBenchmark::Settings Options, const Engine::StressScene::Settings &StressOptions)
+{
+    GLFWwindow *Window = nullptr;
+    GLADloadproc LoadProc = CreateBenchmarkContext(Options.Headless, Window);
+    if (!LoadProc)
+    {
+        std::cerr << "Failed to create an OpenGL context!" << std::endl;
+        return 1;
+    }
+
+    if (!gladLoadGLLoader(LoadProc))
+    {
+        std::cerr << "Failed to initialize GLAD!" << std::endl;
+        DestroyBenchmarkContext(Window);
+        return 1;
+    }
+
+    WindowWidth = RenderWidth = Options.Width;
+    WindowHeight = RenderHeight = Options.Height;
+    Engine::Profiler::SetEnabled(false);
+    Engine::Shader::EnableParallelCompile(LoadProc);
+    ShaderSubmitTime = Engine::Platform::GetTime();
+
+    // Fixed resolution unless a budget is given, so runs stay comparable
+    UseDynamicResolution = Options.TargetFrameMs > 0.0f;
+    UseDepthPrepass = Options.DepthPrepass;
+    if (UseDynamicResolution)
+        ResolutionSettings.TargetFrameMs = Options.TargetFrameMs;
+    InitRenderTarget();
+    InitText();
+    Engine::SpriteBatch *Sprites = nullptr;
+    Engine::Material *SpriteBatchMaterial = nullptr;
+    Engine::TextureAtlas *SpriteAtlas = nullptr;
+    std::vector<Engine::TextureAtlas::Handle> SpriteAtlasEntries;
+    if (Options.Scene == "stress")
+    {
+        Stress = new Engine::StressScene(StressOptions);
+        PointLights = Stress->GetPointLights();
+        DirectionalLights = Stress->GetDirectionalLights();
+        Spotlights = Stress->GetSpotLights();
+        Options.SceneParameters = Stress->Describe();
+    }
+    else if (Options.Scene == "sprites")
+    {
+        Sprites = new Engine::SpriteBatch(&RenderWidth, &RenderHeight);
+        SpriteBatchMaterial = new Engine::Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Main/Frag.glsl", {"Assets/Textures/Checkerboard.png"});
+        SpriteBatchMaterial->EnableKeyword("USE_TEXTURE");
+        SpriteBatchMaterial->SetDepthSortingMode(Engine::Material::DepthSortingMode::None);
+        SpriteBatchMaterial->SetBlendingMode(Engine::Material::BlendingMode::AlphaBlend);
+        // Submits the vertex colour variant the batch binds, so it compiles with everything else
+        SpriteBatchMaterial->Bind(Engine::ShaderLibrary::GetKeywordMask("USE_VERTEX_COLOR"));
+        SpriteAtlas = new Engine::TextureAtlas();
+        for (const char *Path : {"Assets/Textures/Checkerboard.png", "Assets/Textures/Font/Arial.png"})
+        {
+            Engine::TextureAtlas::Handle Entry = SpriteAtlas->InsertFromFile(Path);
+            if (Entry >= 0)
+                SpriteAtlasEntries.push_back(Entry);
+        }
+        if (SpriteAtlasEntries.empty())
+        {
+            std::cerr << "Failed to fill the sprite atlas!" << std::endl;
+            delete SpriteAtlas;
+            delete SpriteBatchMaterial;
+            delete Sprites;
+            DestroyBenchmarkContext(Window);
+            return 1;
+        }
+        Options.SceneParameters = "{\"sprites\": " + std::to_string(Options.Sprites) + "}";
+    }
+    else
+        InitModel(Options.Scene);
+    OutputRenderTarget = new Engine::RenderTarget(glm::vec2(RenderWidth, RenderHeight), {{GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE}});
+
+    // Loading and shader compiles must not leak into the measured frames
+    Engine::ShaderLibrary::WaitForAll();
+    Engine::JobSystem::PumpMainThread();
+    glViewport(0, 0, RenderWidth, RenderHeight);
+
+    std::vector<Engine::FrameBenchmark::CameraKey> CameraPath = Engine::FrameBenchmark::LoadCameraPath(Options.CameraPath);
+    Engine::FrameSnapshot Snapshot;
+    std::vector<Engine::FrameBenchmark::Counter> Counters;
+    if (Sprites)
+        Counters.push_back({"sprite_draw_calls", [Sprites]() { return static_cast<double>(Sprites->GetDrawCallCount()); }});
+    else
+        Counters.push_back({"gbuffer_samples", []() { return static_cast<double>(GBufferSamples->GetLast()); }});
+
+    int Result = Engine::FrameBenchmark::Run(Options, [&](int Frame, double Time, float Progress)
+    {
+        if (Sprites)
+        {
+            RenderSprites(*Sprites, SpriteBatchMaterial, *SpriteAtlas, SpriteAtlasEntries, Options.Sprites, Time);
+            return;
+        }
+
+        glm::vec3 Position;
+        glm::quat Rotation;
+        Engine::FrameBenchmark::SampleCameraPath(CameraPath, Progress, Position, Rotation);
+        MainCamera.SetPosition(Position);
+        MainCamera.SetRotation(Rotation);
+
+        Snapshot.FrameIndex = Frame;
+        SimulateFrame(Snapshot, Time, static_cast<float>(Options.TimeStep));
+        Snapshot.UIText.clear();
+        RenderFrame(Snapshot);
+    }, Counters);
+
+    delete Sprites;
+    delete SpriteBatchMaterial;
+    delete SpriteAtlas;
+    delete OutputRenderTarget;
+    OutputRenderTarget = nullptr;
+    ReleaseScene();
+    DestroyBenchmarkContext(Window);
+    return Result;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--bench-jobs")
+            return Engine::JobBenchmark::Run();
+        if (std::string(argv[i]) == "--bench-cpu")
+            return Engine::CpuBenchmark::Run(argc, argv);
+    }
+
+    // GLFW lives on the main thread, which also acts as job worker 0
+    Engine::JobSystem::Initialize();
+
+    int Result = 0;
+    Engine::FrameBenchmark::Settings BenchmarkSettings;
+    Engine::StressScene::Settings StressSettings;
+    Engine::StressScene::ParseArguments(argc, argv, StressSettings);
+    if (Engine::FrameBenchmark::ParseArguments(argc, argv, BenchmarkSettings))
+        Result = RunBenchmark(BenchmarkSettings, StressSettings);
+    else
+        RunEngine();
+
+    Engine::JobSystem::Shutdown();
+    return Result;
 }
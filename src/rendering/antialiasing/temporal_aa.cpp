@@ -0,0 +1,129 @@
+#include "temporal_aa.h"
+
+Engine::TemporalAA::TemporalAA(const Settings &Options)
+    : Options(Options)
+{
+    this->Options.HistoryWeight = std::clamp(Options.HistoryWeight, 0.0f, 0.99f);
+
+    ResolveMaterial = new Material("Assets/Shaders/Main/Vert.glsl", "Assets/Shaders/Temporal/Frag.glsl", {});
+    ResolveSprite = new Sprite(ResolveMaterial, glm::vec2(0, 0), glm::vec2(0, 0), &Width, &Height);
+    ResolveMaterial->SetDepthSortingMode(Material::DepthSortingMode::None);
+    ResolveMaterial->Compile();
+}
+
+Engine::TemporalAA::~TemporalAA()
+{
+    delete History[0];
+    delete History[1];
+    delete ResolveSprite;
+    delete ResolveMaterial;
+}
+
+float Engine::TemporalAA::Halton(uint64_t Index, int Base)
+{
+    float Result = 0.0f, Fraction = 1.0f;
+    while (Index > 0)
+    {
+        Fraction /= Base;
+        Result += Fraction * (Index % Base);
+        Index /= Base;
+    }
+    return Result;
+}
+
+void Engine::TemporalAA::Prepare(Camera &View, const glm::uvec2 &RenderSize, Frame &Out)
+{
+    // Motion vectors are measured against the unjittered matrix, jittered or not
+    glm::mat4 ViewProjection = View.GetProjectionMatrix() * View.GetViewMatrix();
+    if (HasPrevious)
+        View.SetPreviousViewProjection(PreviousViewProjection);
+    PreviousViewProjection = ViewProjection;
+    HasPrevious = true;
+
+    Out.Enabled = Options.Enabled && RenderSize.x > 0 && RenderSize.y > 0;
+    Out.Jitter = glm::vec2(0.0f);
+    if (!Out.Enabled)
+        return;
+
+    // Halton points start at index 1, index 0 would sit on the texel corner every cycle
+    uint64_t Index = Phase % JitterPhases;
+    glm::vec2 Offset(Halton(Index + 1, 2) - 0.5f, Halton(Index + 1, 3) - 0.5f);
+    Out.Jitter = Offset * 2.0f / glm::vec2(RenderSize);
+    View.SetJitter(Out.Jitter, (Index + 0.5f) / JitterPhases);
+    ++Phase;
+}
+
+void Engine::TemporalAA::SetEnabled(bool Enabled)
+{
+    Options.Enabled = Enabled;
+}
+
+bool Engine::TemporalAA::IsEnabled() const
+{
+    return Options.Enabled;
+}
+
+void Engine::TemporalAA::Resolve(GLuint Color, GLuint Velocity, GLuint Depth, const glm::uvec2 &InputSize, const glm::uvec2 &OutputSize, const Frame &Data)
+{
+    ENGINE_PROFILE_GPU_SCOPE("TemporalAA");
+
+    // Both targets are sized together, a new output size starts the history over
+    if (!History[0])
+    {
+        for (RenderTarget *&Target : History)
+            Target = new RenderTarget(glm::vec2(OutputSize), {{GL_RGBA16F, GL_RGBA, GL_FLOAT}});
+        HistoryValid = false;
+    }
+    else if (glm::uvec2(History[0]->TargetSize) != OutputSize)
+    {
+        for (RenderTarget *Target : History)
+            Target->Resize(glm::vec2(OutputSize));
+        HistoryValid = false;
+    }
+    Width = OutputSize.x;
+    Height = OutputSize.y;
+
+    int Previous = Current;
+    Current = 1 - Current;
+    History[Current]->Bind();
+
+    static const std::string SamplerUniforms[] = {"InputTexture", "VelocityTexture", "DepthTexture", "HistoryTexture"};
+    static const std::string InputSizeUniform = "InputSize";
+    static const std::string OutputSizeUniform = "OutputSize";
+    static const std::string JitterUniform = "Jitter";
+    static const std::string HistoryWeightUniform = "HistoryWeight";
+    static const std::string HistoryValidUniform = "HistoryValid";
+    ResolveMaterial->SetTexture(0, Color);
+    ResolveMaterial->SetTexture(1, Velocity);
+    ResolveMaterial->SetTexture(2, Depth);
+    ResolveMaterial->SetTexture(3, History[Previous]->Textures[0]);
+    for (int i = 0; i < 4; ++i)
+        ResolveMaterial->SetUniform(SamplerUniforms[i], i);
+    ResolveMaterial->SetUniform(InputSizeUniform, glm::vec2(InputSize));
+    ResolveMaterial->SetUniform(OutputSizeUniform, glm::vec2(OutputSize));
+    // The jitter moved the scene by half its clip space offset in texture coordinates
+    ResolveMaterial->SetUniform(JitterUniform, Data.Jitter * 0.5f * glm::vec2(InputSize));
+    ResolveMaterial->SetUniform(HistoryWeightUniform, Options.HistoryWeight);
+    ResolveMaterial->SetUniform(HistoryValidUniform, HistoryValid ? 1.0f : 0.0f);
+
+    ResolveSprite->SetSize(glm::vec2(OutputSize));
+    ResolveSprite->Render();
+    HistoryValid = true;
+}
+
+void Engine::TemporalAA::Present(GLuint Framebuffer)
+{
+    if (!History[Current])
+        return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, History[Current]->FBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, Framebuffer);
+    glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glViewport(0, 0, Width, Height);
+}
+
+void Engine::TemporalAA::InvalidateHistory()
+{
+    HistoryValid = false;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#ifndef temporal_aa_h
+#define temporal_aa_h
+
+#include <cstdint>
+#include <algorithm>
+#include <string>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../camera/camera.h"
+#include "../materials/material.h"
+#include "../sprites/sprite.h"
+#include "../render_target/render_target.h"
+#include "../../core/profiler/profiler.h"
+
+namespace Engine
+{
+    // Temporal anti-aliasing and upsampling. The camera is offset by a different subpixel amount every frame
+    // and the G-buffer stores how far each pixel moved since the last one. The resolve reconstructs the
+    // jittered input at the output resolution, blends it with the reprojected history clipped to the colors
+    // around it, and keeps the result as the next frame's history. With a render size below the output size
+    // the history gathers the samples of the whole jitter sequence, which upsamples as it anti-aliases.
+    //
+    // Prepare runs on the simulation thread and jitters the frame's camera, Resolve and Present run on the
+    // GL thread.
+    class TemporalAA
+    {
+    public:
+        // Length of the Halton (2, 3) jitter sequence
+        static constexpr int JitterPhases = 8;
+
+        struct Settings
+        {
+            bool Enabled = true;
+            // Share of the history kept per frame where this frame's samples land on the output pixel
+            float HistoryWeight = 0.9f;
+        };
+
+        struct Frame
+        {
+            bool Enabled = false;
+            // Clip space offset the camera was jittered by
+            glm::vec2 Jitter = glm::vec2(0.0f);
+        };
+
+        TemporalAA(const Settings &Options);
+        ~TemporalAA();
+
+        // Simulation thread. Jitters View for a scene drawn at RenderSize and hands it last frame's view
+        // projection for the motion vectors
+        void Prepare(Camera &View, const glm::uvec2 &RenderSize, Frame &Out);
+        // Simulation thread. Disabled frames are neither jittered nor resolved
+        void SetEnabled(bool Enabled);
+        bool IsEnabled() const;
+
+        // GL thread. Resolves the lit scene in Color, drawn into the lower left InputSize texels like the
+        // Velocity and Depth G-buffer textures, into a new history of OutputSize
+        void Resolve(GLuint Color, GLuint Velocity, GLuint Depth, const glm::uvec2 &InputSize, const glm::uvec2 &OutputSize, const Frame &Data);
+        // GL thread. Copies the history to Framebuffer and leaves it bound with a full viewport
+        void Present(GLuint Framebuffer);
+        // GL thread. Starts over without history, e.g. after frames that were not resolved
+        void InvalidateHistory();
+
+    private:
+        Settings Options;
+
+        // Simulation thread
+        uint64_t Phase = 0;
+        glm::mat4 PreviousViewProjection = glm::mat4(1.0f);
+        bool HasPrevious = false;
+
+        // GL thread
+        Material *ResolveMaterial = nullptr;
+        Sprite *ResolveSprite = nullptr;
+        RenderTarget *History[2] = {nullptr, nullptr};
+        int Current = 0;
+        bool HistoryValid = false;
+        unsigned int Width = 0, Height = 0;
+
+        static float Halton(uint64_t Index, int Base);
+    };
+};
+
+#endif
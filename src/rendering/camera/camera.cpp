@@ -1,4 +1,4 @@
-#include "Camera.h"
+#include "camera.h"
 
 Engine::Camera::Camera(CameraMode Mode, unsigned int* WindowWidth, unsigned int* WindowHeight)
     : Mode(Mode), WindowWidth(WindowWidth), WindowHeight(WindowHeight),
@@ -27,6 +27,11 @@ void Engine::Camera::SetRotation(const glm::quat& Rot) {
     this->Rotation = Rot;
 }
 
+void Engine::Camera::SetWindowSize(unsigned int* WindowWidth, unsigned int* WindowHeight) {
+    this->WindowWidth = WindowWidth;
+    this->WindowHeight = WindowHeight;
+}
+
 glm::vec3 Engine::Camera::GetPosition() const {
     return Position;
 }
@@ -49,3 +54,32 @@ glm::mat4 Engine::Camera::GetProjectionMatrix() const {
         return glm::ortho(-HalfSize * AspectRatio, HalfSize * AspectRatio, -HalfSize, HalfSize, NearPlane, FarPlane);
     }
 }
+
+void Engine::Camera::SetJitter(const glm::vec2& Offset, float Phase) {
+    this->Jitter = Offset;
+    this->JitterPhase = Phase;
+}
+
+glm::vec2 Engine::Camera::GetJitter() const {
+    return Jitter;
+}
+
+float Engine::Camera::GetJitterPhase() const {
+    return JitterPhase;
+}
+
+glm::mat4 Engine::Camera::GetJitteredProjectionMatrix() const {
+    // Shifting clip space x and y by w times the offset moves every projected point by the offset
+    return glm::translate(glm::mat4(1.0f), glm::vec3(Jitter, 0.0f)) * GetProjectionMatrix();
+}
+
+void Engine::Camera::SetPreviousViewProjection(const glm::mat4& ViewProjection) {
+    this->PreviousViewProjection = ViewProjection;
+    this->HasPreviousViewProjection = true;
+}
+
+glm::mat4 Engine::Camera::GetPreviousViewProjectionMatrix() const {
+    if (!HasPreviousViewProjection)
+        return GetProjectionMatrix() * GetViewMatrix();
+    return PreviousViewProjection;
+}
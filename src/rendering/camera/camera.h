@@ -25,12 +25,26 @@ namespace Engine
         void SetOrthographic(float Size, float NearPlane, float FarPlane);
         void SetPosition(const glm::vec3 &Pos);
         void SetRotation(const glm::quat &Rot);
+        // Points the projection at a different viewport size, e.g. the size captured in a frame snapshot
+        void SetWindowSize(unsigned int *WindowWidth, unsigned int *WindowHeight);
 
         glm::vec3 GetPosition() const;
         glm::quat GetRotation() const;
         glm::mat4 GetViewMatrix() const;
         glm::mat4 GetProjectionMatrix() const;
 
+        // Subpixel offset in normalized device coordinates for temporal anti-aliasing, only the jittered
+        // projection applies it. Phase is in [0, 1) and moves along with the offset so dithering can too
+        void SetJitter(const glm::vec2 &Offset, float Phase);
+        glm::vec2 GetJitter() const;
+        float GetJitterPhase() const;
+        glm::mat4 GetJitteredProjectionMatrix() const;
+
+        // Unjittered view projection of the previous frame that motion vectors are measured against, the
+        // camera counts as not having moved until one is set
+        void SetPreviousViewProjection(const glm::mat4 &ViewProjection);
+        glm::mat4 GetPreviousViewProjectionMatrix() const;
+
     private:
         CameraMode Mode;
         float FOV;
@@ -41,6 +55,11 @@ namespace Engine
         glm::vec3 Position;
         glm::quat Rotation;
 
+        glm::vec2 Jitter = glm::vec2(0.0f);
+        float JitterPhase = 0.0f;
+        glm::mat4 PreviousViewProjection = glm::mat4(1.0f);
+        bool HasPreviousViewProjection = false;
+
         unsigned int *WindowWidth;
         unsigned int *WindowHeight;
     };
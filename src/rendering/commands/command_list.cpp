@@ -0,0 +1,220 @@
+#include "command_list.h"
+
+unsigned int Engine::CommandList::DrawBuffer = 0;
+size_t Engine::CommandList::DrawBufferCapacity = 0;
+
+namespace
+{
+    template <typename T>
+    T Read(const uint8_t *&Cursor)
+    {
+        T Value;
+        std::memcpy(&Value, Cursor, sizeof(T));
+        Cursor += sizeof(T);
+        return Value;
+    }
+}
+
+void Engine::CommandList::Reset()
+{
+    Commands.clear();
+    DrawParams.clear();
+    DrawCount = 0;
+    LastMaterial = nullptr;
+    LastVAO = 0;
+}
+
+bool Engine::CommandList::IsEmpty() const
+{
+    return Commands.empty();
+}
+
+size_t Engine::CommandList::GetCommandBytes() const
+{
+    return Commands.size();
+}
+
+size_t Engine::CommandList::GetDrawCount() const
+{
+    return DrawCount;
+}
+
+void Engine::CommandList::BindMaterial(const Material *MaterialPtr)
+{
+    if (MaterialPtr == LastMaterial)
+        return;
+
+    Write(Op::BindMaterial);
+    Write(MaterialPtr);
+    LastMaterial = MaterialPtr;
+}
+
+void Engine::CommandList::BindVertexArray(unsigned int VAO)
+{
+    if (VAO == LastVAO)
+        return;
+
+    Write(Op::BindVertexArray);
+    Write(VAO);
+    LastVAO = VAO;
+}
+
+void Engine::CommandList::SetDrawParams(const glm::mat4 &Model, const glm::mat4 &ViewProjection, const glm::mat4 &PreviousModelViewProjection,
+                                        const glm::vec4 &Temporal)
+{
+    // std140 DrawParams { mat4 Model; mat4 ViewProjection; mat4 PreviousModelViewProjection; mat3 NormalMatrix;
+    // vec4 Temporal; }, column major with a 16 byte column stride. The normal matrix is inverted here once per
+    // draw instead of once per vertex
+    size_t Offset = DrawParams.size();
+    DrawParams.resize(Offset + DrawParamsStride);
+    uint8_t *Block = DrawParams.data() + Offset;
+    std::memcpy(Block, &Model[0][0], sizeof(glm::mat4));
+    std::memcpy(Block + sizeof(glm::mat4), &ViewProjection[0][0], sizeof(glm::mat4));
+    std::memcpy(Block + sizeof(glm::mat4) * 2, &PreviousModelViewProjection[0][0], sizeof(glm::mat4));
+
+    glm::mat3 NormalMatrix = TransformHierarchy::GetNormalMatrix(Model);
+    for (int Column = 0; Column < 3; ++Column)
+        std::memcpy(Block + sizeof(glm::mat4) * 3 + sizeof(glm::vec4) * Column, &NormalMatrix[Column][0], sizeof(glm::vec3));
+    std::memcpy(Block + sizeof(glm::mat4) * 3 + sizeof(glm::vec4) * 3, &Temporal[0], sizeof(glm::vec4));
+
+    Write(Op::SetDrawRange);
+    Write(static_cast<uint32_t>(Offset));
+}
+
+void Engine::CommandList::DrawElements(unsigned int IndexCount, unsigned int FirstIndex)
+{
+    Write(Op::DrawElements);
+    Write(static_cast<uint32_t>(IndexCount));
+    Write(static_cast<uint32_t>(FirstIndex));
+    ++DrawCount;
+}
+
+void Engine::CommandList::SetCapability(GLenum Capability, bool Enabled)
+{
+    Write(Op::SetCapability);
+    Write(static_cast<uint32_t>(Capability));
+    Write(static_cast<uint8_t>(Enabled));
+}
+
+void Engine::CommandList::SetDepthEqual(bool Enabled)
+{
+    Write(Op::SetDepthEqual);
+    Write(static_cast<uint8_t>(Enabled));
+    // The depth state is applied on material binds, so the next one must not be dropped
+    LastMaterial = nullptr;
+}
+
+void Engine::CommandList::Execute(const CommandList &List)
+{
+    Execute(&List, 1);
+}
+
+void Engine::CommandList::Execute(const std::vector<CommandList> &Lists)
+{
+    Execute(Lists.data(), Lists.size());
+}
+
+void Engine::CommandList::Execute(const CommandList *Lists, size_t Count)
+{
+    ENGINE_PROFILE_FUNCTION();
+    size_t TotalParams = 0;
+    for (size_t i = 0; i < Count; ++i)
+        TotalParams += Lists[i].DrawParams.size();
+
+    if (TotalParams > 0)
+    {
+        if (DrawBuffer == 0)
+            glGenBuffers(1, &DrawBuffer);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, DrawBuffer);
+        if (TotalParams > DrawBufferCapacity)
+            DrawBufferCapacity = std::max(TotalParams, DrawBufferCapacity * 2);
+
+        // Orphan the previous frame's blocks, then upload every list's blocks back to back
+        glBufferData(GL_UNIFORM_BUFFER, DrawBufferCapacity, nullptr, GL_STREAM_DRAW);
+        MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, DrawBuffer, MemoryTracker::GpuOwner::Uniforms, DrawBufferCapacity);
+        size_t Offset = 0;
+        for (size_t i = 0; i < Count; ++i)
+        {
+            if (!Lists[i].DrawParams.empty())
+                glBufferSubData(GL_UNIFORM_BUFFER, Offset, Lists[i].DrawParams.size(), Lists[i].DrawParams.data());
+            Offset += Lists[i].DrawParams.size();
+        }
+    }
+
+    GLintptr Base = 0;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        Decode(Lists[i], Base);
+        Base += static_cast<GLintptr>(Lists[i].DrawParams.size());
+    }
+    glBindVertexArray(0);
+}
+
+void Engine::CommandList::Decode(const CommandList &List, GLintptr DrawParamsBase)
+{
+    const uint8_t *Cursor = List.Commands.data();
+    const uint8_t *End = Cursor + List.Commands.size();
+
+    // Draws are skipped while the bound material's shader variant is still compiling
+    bool Skip = false;
+    bool DepthEqual = false;
+
+    while (Cursor < End)
+    {
+        switch (Read<Op>(Cursor))
+        {
+        case Op::BindMaterial:
+        {
+            const Material *MaterialPtr = Read<const Material *>(Cursor);
+            Skip = !MaterialPtr->Bind();
+            if (!Skip && DepthEqual && MaterialPtr->GetDepthSortingMode() == Material::DepthSortingMode::ReadWrite)
+            {
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            break;
+        }
+        case Op::BindVertexArray:
+            glBindVertexArray(Read<unsigned int>(Cursor));
+            break;
+        case Op::SetDrawRange:
+            glBindBufferRange(GL_UNIFORM_BUFFER, Shader::DrawBlockBinding, DrawBuffer, DrawParamsBase + Read<uint32_t>(Cursor), DrawParamsSize);
+            break;
+        case Op::DrawElements:
+        {
+            uint32_t IndexCount = Read<uint32_t>(Cursor);
+            uint32_t FirstIndex = Read<uint32_t>(Cursor);
+            if (!Skip)
+                glDrawElements(GL_TRIANGLES, IndexCount, GL_UNSIGNED_INT, (void *)(static_cast<size_t>(FirstIndex) * sizeof(unsigned int)));
+            break;
+        }
+        case Op::SetCapability:
+        {
+            GLenum Capability = Read<uint32_t>(Cursor);
+            if (Read<uint8_t>(Cursor))
+                glEnable(Capability);
+            else
+                glDisable(Capability);
+            break;
+        }
+        case Op::SetDepthEqual:
+            DepthEqual = Read<uint8_t>(Cursor) != 0;
+            break;
+        default:
+            std::cerr << "CommandList: Unknown command, aborting replay" << std::endl;
+            return;
+        }
+    }
+}
+
+void Engine::CommandList::Release()
+{
+    if (DrawBuffer != 0)
+    {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, DrawBuffer);
+        glDeleteBuffers(1, &DrawBuffer);
+    }
+    DrawBuffer = 0;
+    DrawBufferCapacity = 0;
+}
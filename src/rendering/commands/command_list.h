@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef command_list_h
+#define command_list_h
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "../materials/material.h"
+#include "../../core/profiler/profiler.h"
+#include "../../core/transforms/transform_hierarchy.h"
+
+namespace Engine
+{
+    // Compact binary draw commands. Lists are recorded on any thread without touching GL, per-draw matrices
+    // and the normal matrix are packed into std140 DrawParams blocks at record time, and the GL thread replays lists in order with
+    // a single upload of all packed blocks followed by a tight decode loop.
+    class CommandList
+    {
+    public:
+        enum class Op : uint8_t
+        {
+            BindMaterial,
+            BindVertexArray,
+            SetDrawRange,
+            DrawElements,
+            SetCapability,
+            SetDepthEqual
+        };
+
+        // Per-draw block stride, 256 is the largest offset alignment GL allows so every driver accepts it
+        static constexpr size_t DrawParamsStride = 256;
+        // Three mat4, a std140 mat3 whose columns are padded to vec4 and a vec4, exactly one stride
+        static constexpr size_t DrawParamsSize = sizeof(glm::mat4) * 3 + sizeof(glm::vec4) * 4;
+
+        void Reset();
+        bool IsEmpty() const;
+        size_t GetCommandBytes() const;
+        size_t GetDrawCount() const;
+
+        // Redundant material and vertex array changes are dropped while recording
+        void BindMaterial(const Material *MaterialPtr);
+        void BindVertexArray(unsigned int VAO);
+        // PreviousModelViewProjection is unjittered and gives the motion vectors, Temporal holds the clip space
+        // jitter of ViewProjection in xy and the camera's jitter phase in z
+        void SetDrawParams(const glm::mat4 &Model, const glm::mat4 &ViewProjection, const glm::mat4 &PreviousModelViewProjection,
+                           const glm::vec4 &Temporal);
+        void DrawElements(unsigned int IndexCount, unsigned int FirstIndex = 0);
+        void SetCapability(GLenum Capability, bool Enabled);
+        // While enabled, materials that read and write depth are bound with an equal depth test and no depth
+        // writes instead, for draws whose depth a pre-pass already laid down
+        void SetDepthEqual(bool Enabled);
+
+        // Replays the lists in order on the GL thread
+        static void Execute(const CommandList *Lists, size_t Count);
+        static void Execute(const std::vector<CommandList> &Lists);
+        static void Execute(const CommandList &List);
+        static void Release();
+
+    private:
+        TaggedVector<uint8_t, MemoryTracker::Tag::FrameTemporary> Commands;
+        TaggedVector<uint8_t, MemoryTracker::Tag::FrameTemporary> DrawParams;
+        size_t DrawCount = 0;
+        const Material *LastMaterial = nullptr;
+        unsigned int LastVAO = 0;
+
+        template <typename T>
+        void Write(const T &Value)
+        {
+            size_t Offset = Commands.size();
+            Commands.resize(Offset + sizeof(T));
+            std::memcpy(Commands.data() + Offset, &Value, sizeof(T));
+        }
+
+        static unsigned int DrawBuffer;
+        static size_t DrawBufferCapacity;
+
+        static void Decode(const CommandList &List, GLintptr DrawParamsBase);
+    };
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "light.h"
+
+namespace
+{
+    enum LightField { ColorField, IntensityField, CutoffField, OuterCutoffField, PositionField, DirectionField, FieldCount };
+
+    // Uniform names are built once per prefix, so the per-frame upload never formats or allocates strings
+    struct UniformNames
+    {
+        std::string Count;
+        std::vector<std::string> Fields; // FieldCount names per light
+    };
+
+    const UniformNames &GetUniformNames(const std::string &Prefix)
+    {
+        static std::unordered_map<std::string, UniformNames> Cache;
+        auto It = Cache.find(Prefix);
+        if (It != Cache.end())
+            return It->second;
+
+        static const char *FieldNames[FieldCount] = {"Color", "Intensity", "Cutoff", "OuterCutoff", "Position", "Direction"};
+        UniformNames Names;
+        Names.Count = "Num" + Prefix;
+        for (int i = 0; i < Engine::Light::MaxPerType; i++)
+        {
+            for (const char *Field : FieldNames)
+                Names.Fields.push_back(Prefix + "[" + std::to_string(i) + "]." + Field);
+        }
+        return Cache.emplace(Prefix, std::move(Names)).first->second;
+    }
+}
+
+void Engine::Light::SetUniforms(Material *Target, const std::vector<Light> &Lights, const std::string &Prefix)
+{
+    const UniformNames &Names = GetUniformNames(Prefix);
+    int Count = std::min(static_cast<int>(Lights.size()), MaxPerType);
+    Target->SetUniform(Names.Count, Count);
+
+    bool Spot = Prefix == "SpotLights";
+    bool Positional = Spot || Prefix == "PointLights";
+    bool Directional = Prefix == "DirectionalLights";
+    for (int i = 0; i < Count; i++)
+    {
+        const std::string *Field = &Names.Fields[i * FieldCount];
+        Target->SetUniform(Field[ColorField], Lights[i].Color);
+        Target->SetUniform(Field[IntensityField], Lights[i].Intensity);
+
+        if (Spot)
+        {
+            Target->SetUniform(Field[CutoffField], Lights[i].CutOff);
+            Target->SetUniform(Field[OuterCutoffField], Lights[i].OuterCutOff);
+        }
+
+        if (Positional)
+        {
+            Target->SetUniform(Field[PositionField], Lights[i].Position);
+        }
+
+        if (Directional || Spot)
+        {
+            Target->SetUniform(Field[DirectionField], Lights[i].Direction);
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#ifndef light_h
+#define light_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "../materials/material.h"
+
+namespace Engine
+{
+    struct Light
+    {
+        glm::vec3 Position, Direction, Color;
+        float Intensity, CutOff, OuterCutOff;
+
+        // Array size of each light type in the deferred lighting shader
+        static constexpr int MaxPerType = 64;
+
+        // Writes Num<Prefix> and the <Prefix>[i] struct array used by the deferred lighting shader, lights past
+        // MaxPerType are dropped. GL thread only, the uniform names are cached per prefix
+        static void SetUniforms(Material *Target, const std::vector<Light> &Lights, const std::string &Prefix);
+    };
+};
+
+#endif
@@ -1,11 +1,11 @@
-#include "Material.h"
+#include "material.h"
 
 Engine::Material::Material(
     const std::string &VertexPath,
     const std::string &FragmentPath,
     const std::vector<std::string> &TexturePaths,
     const std::vector<std::pair<GLint, GLint>> &FilterOptions)
-    : Shader(VertexPath, FragmentPath)
+    : VertexPath(VertexPath), FragmentPath(FragmentPath)
 {
     std::vector<std::pair<GLint, GLint>> ValidFilterOptions = FilterOptions;
     if (ValidFilterOptions.empty())
@@ -23,17 +23,169 @@ Engine::Material::Material(
 
 Engine::Material::~Material()
 {
+    if (ShaderInstance && ShaderInstance->UniformOwner == this)
+        ShaderInstance->UniformOwner = nullptr;
+    if (ExtraShaderInstance && ExtraShaderInstance->UniformOwner == this)
+        ExtraShaderInstance->UniformOwner = nullptr;
+    UniformArena::Free(Block);
     UnloadTextures();
 }
 
+Engine::Shader *Engine::Material::ResolveShader() const
+{
+    // Variants are looked up lazily so a material only compiles the keyword set it is finally drawn with
+    if (ShaderDirty)
+    {
+        if (ShaderInstance && ShaderInstance->UniformOwner == this)
+            ShaderInstance->UniformOwner = nullptr;
+        ShaderInstance = ShaderLibrary::GetVariant(VertexPath, FragmentPath, Keywords);
+        ShaderDirty = false;
+        if (ExtraShaderInstance && ExtraShaderInstance->UniformOwner == this)
+            ExtraShaderInstance->UniformOwner = nullptr;
+        ExtraShaderInstance.reset();
+    }
+    return ShaderInstance.get();
+}
+
 Engine::Shader *Engine::Material::GetShader()
 {
-    return &Shader;
+    return ResolveShader();
+}
+
+void Engine::Material::ApplyUniforms(Engine::Shader *Program) const
+{
+    for (const auto &[Name, Value] : Uniforms)
+    {
+        if (Program->FindMaterialBlockMember(Name))
+            continue;
+        std::visit([Program, &Name = Name](const auto &Data)
+                   { Program->SetUniform(Name, Data); },
+                   Value);
+    }
+}
+
+template <typename T>
+void Engine::Material::SetUniformValue(const std::string &Name, const T &Value)
+{
+    Uniforms[Name] = Value;
+    // The extra variant is not bound here, it picks the value up with everything else on its next bind
+    if (ExtraShaderInstance && ExtraShaderInstance->UniformOwner == this)
+        ExtraShaderInstance->UniformOwner = nullptr;
+    if (ShaderDirty || !ShaderInstance)
+        return;
+
+    if (ShaderInstance->FindMaterialBlockMember(Name))
+    {
+        BlockDirty = true;
+        return;
+    }
+
+    // Upload straight away only while this material owns the program, otherwise Bind() applies it
+    if (ShaderInstance->UniformOwner == this)
+    {
+        ShaderInstance->Bind();
+        ShaderInstance->SetUniform(Name, Value);
+    }
+}
+
+void Engine::Material::Compile() const
+{
+    ResolveShader();
 }
 
-void Engine::Material::Bind() const
+bool Engine::Material::IsReady() const
 {
-    Shader.Bind();
+    return ResolveShader()->IsReady();
+}
+
+void Engine::Material::UpdateParameterBlock(Engine::Shader *Program) const
+{
+    int BlockSize = Program->GetMaterialBlockSize();
+    if (BlockSize == 0)
+        return;
+
+    // A different variant may lay the block out differently, repack everything for it
+    if (BlockLayout != Program || Block.Size != BlockSize)
+    {
+        if (Block.Size != BlockSize)
+        {
+            UniformArena::Free(Block);
+            Block = UniformArena::Allocate(BlockSize);
+        }
+        BlockLayout = Program;
+        BlockDirty = true;
+    }
+
+    if (BlockDirty)
+    {
+        BlockData.assign(BlockSize, 0);
+        for (const auto &[Name, Value] : Uniforms)
+        {
+            const Shader::BlockMember *Member = Program->FindMaterialBlockMember(Name);
+            if (!Member)
+                continue;
+
+            unsigned char *Target = BlockData.data() + Member->Offset;
+            std::visit([Target, Member, BlockSize, Offset = Member->Offset](const auto &Data)
+                       {
+                           using T = std::decay_t<decltype(Data)>;
+                           if constexpr (std::is_same_v<T, glm::mat4>)
+                           {
+                               // std140 matrices are stored column by column at the reflected stride
+                               for (int Column = 0; Column < 4; ++Column)
+                               {
+                                   if (Offset + Column * Member->MatrixStride + sizeof(glm::vec4) <= static_cast<size_t>(BlockSize))
+                                       std::memcpy(Target + Column * Member->MatrixStride, &Data[Column], sizeof(glm::vec4));
+                               }
+                           }
+                           else if (Offset + sizeof(T) <= static_cast<size_t>(BlockSize))
+                           {
+                               std::memcpy(Target, &Data, sizeof(T));
+                           }
+                       },
+                       Value);
+        }
+
+        UniformArena::Upload(Block, BlockData.data(), BlockData.size());
+        BlockDirty = false;
+    }
+
+    UniformArena::BindRange(Shader::MaterialBlockBinding, Block);
+}
+
+bool Engine::Material::Bind() const
+{
+    return BindProgram(ResolveShader());
+}
+
+bool Engine::Material::Bind(ShaderLibrary::KeywordMask ExtraKeywords) const
+{
+    Engine::Shader *Program = ResolveShader();
+    if ((Keywords | ExtraKeywords) == Keywords)
+        return BindProgram(Program);
+
+    if (!ExtraShaderInstance || ExtraKeywordMask != ExtraKeywords)
+    {
+        if (ExtraShaderInstance && ExtraShaderInstance->UniformOwner == this)
+            ExtraShaderInstance->UniformOwner = nullptr;
+        ExtraShaderInstance = ShaderLibrary::GetVariant(VertexPath, FragmentPath, Keywords | ExtraKeywords);
+        ExtraKeywordMask = ExtraKeywords;
+    }
+    return BindProgram(ExtraShaderInstance.get());
+}
+
+bool Engine::Material::BindProgram(Engine::Shader *Program) const
+{
+    if (!Program->IsReady())
+        return false;
+
+    Program->Bind();
+    if (Program->UniformOwner != this)
+    {
+        ApplyUniforms(Program);
+        Program->UniformOwner = this;
+    }
+    UpdateParameterBlock(Program);
     glEnable(GL_DEPTH_TEST); 
 
     // Configure depth sorting
@@ -91,42 +243,37 @@ void Engine::Material::Bind() const
         glActiveTexture(GL_TEXTURE0 + i);
         glBindTexture(GL_TEXTURE_2D, TextureIDs[i]);
     }
+    return true;
 }
 
 void Engine::Material::SetUniform(const std::string &Name, int Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::SetUniform(const std::string &Name, float Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::SetUniform(const std::string &Name, const glm::vec2 &Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::SetUniform(const std::string &Name, const glm::vec3 &Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::SetUniform(const std::string &Name, const glm::vec4 &Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::SetUniform(const std::string &Name, const glm::mat4 &Value)
 {
-    Shader.Bind();
-    Shader.SetUniform(Name, Value);
+    SetUniformValue(Name, Value);
 }
 
 void Engine::Material::LoadTexture(int Unit, const std::string &TexturePath, GLint MinFilter, GLint MagFilter)
@@ -168,8 +315,35 @@ void Engine::Material::SetTexture(int Unit, unsigned int TextureID)
 
 void Engine::Material::SetShader(const std::string &VertexPath, const std::string &FragmentPath)
 {
-    Shader.Unload();
-    Shader = Engine::Shader(VertexPath, FragmentPath);
+    this->VertexPath = VertexPath;
+    this->FragmentPath = FragmentPath;
+    ShaderDirty = true;
+}
+
+void Engine::Material::EnableKeyword(const std::string &Keyword)
+{
+    SetKeyword(Keyword, true);
+}
+
+void Engine::Material::DisableKeyword(const std::string &Keyword)
+{
+    SetKeyword(Keyword, false);
+}
+
+void Engine::Material::SetKeyword(const std::string &Keyword, bool Enabled)
+{
+    ShaderLibrary::KeywordMask Mask = ShaderLibrary::GetKeywordMask(Keyword);
+    ShaderLibrary::KeywordMask NewKeywords = Enabled ? (Keywords | Mask) : (Keywords & ~Mask);
+    if (NewKeywords != Keywords)
+    {
+        Keywords = NewKeywords;
+        ShaderDirty = true;
+    }
+}
+
+bool Engine::Material::IsKeywordEnabled(const std::string &Keyword) const
+{
+    return (Keywords & ShaderLibrary::GetKeywordMask(Keyword)) != 0;
 }
 
 void Engine::Material::LoadTextures(const std::vector<std::string> &TexturePaths, const std::vector<std::pair<GLint, GLint>> &FilterOptions)
@@ -283,3 +457,14 @@ int Engine::Material::GetSortOrder() const
 {
     return SortOrder;
 }
+
+void Engine::Material::SetAlphaTest(bool Enabled)
+{
+    AlphaTest = Enabled;
+    SetKeyword("USE_ALPHA_TEST", Enabled);
+}
+
+bool Engine::Material::IsAlphaTested() const
+{
+    return AlphaTest;
+}
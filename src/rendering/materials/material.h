@@ -6,8 +6,15 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <memory>
+#include <variant>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
 #include <glm/glm.hpp>
 #include "../shaders/shader.h"
+#include "../shaders/shader_library.h"
+#include "uniform_arena.h"
 #include "../../util/util.h"
 
 namespace Engine
@@ -42,10 +49,23 @@ namespace Engine
                  const std::vector<std::pair<GLint, GLint>> &FilterOptions = {});
         ~Material();
 
-        void Bind() const;
+        // Returns false without binding anything while the shader variant is still compiling
+        bool Bind() const;
+        // Binds the variant with ExtraKeywords on top of the material's own, for renderers that feed the
+        // shader more than the material asks for. The material's keywords are left as they are
+        bool Bind(ShaderLibrary::KeywordMask ExtraKeywords) const;
+        // Submits the variant compile up front so it overlaps with the rest of the loading
+        void Compile() const;
+        bool IsReady() const;
         Shader *GetShader();
         void SetShader(const std::string &VertexPath, const std::string &FragmentPath);
 
+        // Feature keywords select the compiled shader variant, e.g. USE_TEXTURE
+        void EnableKeyword(const std::string &Keyword);
+        void DisableKeyword(const std::string &Keyword);
+        void SetKeyword(const std::string &Keyword, bool Enabled);
+        bool IsKeywordEnabled(const std::string &Keyword) const;
+
         void SetUniform(const std::string &Name, int Value);
         void SetUniform(const std::string &Name, float Value);
         void SetUniform(const std::string &Name, const glm::vec2 &Value);
@@ -80,13 +100,47 @@ namespace Engine
         void SetSortOrder(int Order);
         int GetSortOrder() const;
 
+        // Alpha tested materials may discard fragments, which rules out early depth testing. They enable the
+        // USE_ALPHA_TEST keyword, skip the depth pre-pass and draw after the opaque materials of their sort order
+        void SetAlphaTest(bool Enabled);
+        bool IsAlphaTested() const;
+
     private:
-        Shader Shader;
+        using UniformValue = std::variant<int, float, glm::vec2, glm::vec3, glm::vec4, glm::mat4>;
+
+        std::string VertexPath;
+        std::string FragmentPath;
+        ShaderLibrary::KeywordMask Keywords = 0;
+        mutable std::shared_ptr<Engine::Shader> ShaderInstance;
+        mutable bool ShaderDirty = true;
+        // Last variant bound with extra keywords, dropped whenever the material's own keywords change
+        mutable std::shared_ptr<Engine::Shader> ExtraShaderInstance;
+        mutable ShaderLibrary::KeywordMask ExtraKeywordMask = 0;
+
+        // Variants are shared between materials, so every uniform value is kept here and re-applied when
+        // another material used the program in between
+        std::unordered_map<std::string, UniformValue> Uniforms;
+
+        // Values of members of the shader's MaterialParams block are packed into this material's slice of
+        // the shared uniform arena instead of being set with glUniform
+        mutable std::vector<unsigned char> BlockData;
+        mutable UniformArena::Allocation Block;
+        mutable const Engine::Shader *BlockLayout = nullptr;
+        mutable bool BlockDirty = true;
+
         std::vector<unsigned int> TextureIDs;
         DepthSortingMode SortingMode = DepthSortingMode::ReadWrite;
         BlendingMode BlendMode = BlendingMode::None;
         CullingMode CullMode = CullingMode::Front;
         int SortOrder = 0;
+        bool AlphaTest = false;
+
+        Engine::Shader *ResolveShader() const;
+        bool BindProgram(Engine::Shader *Program) const;
+        void ApplyUniforms(Engine::Shader *Program) const;
+        void UpdateParameterBlock(Engine::Shader *Program) const;
+        template <typename T>
+        void SetUniformValue(const std::string &Name, const T &Value);
     };
 
 }
@@ -0,0 +1,152 @@
+#include "uniform_arena.h"
+
+unsigned int Engine::UniformArena::Buffer = 0;
+size_t Engine::UniformArena::Capacity = 0;
+size_t Engine::UniformArena::Top = 0;
+size_t Engine::UniformArena::Used = 0;
+GLint Engine::UniformArena::Alignment = 0;
+std::unordered_map<size_t, std::vector<GLintptr>> Engine::UniformArena::FreeBlocks;
+std::vector<Engine::UniformArena::Allocation> Engine::UniformArena::BoundRanges;
+size_t Engine::UniformArena::RangeBinds = 0;
+size_t Engine::UniformArena::Uploads = 0;
+
+size_t Engine::UniformArena::AlignSize(size_t Size)
+{
+    if (Alignment == 0)
+    {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &Alignment);
+        Alignment = std::max(Alignment, 16);
+    }
+    return (Size + Alignment - 1) / Alignment * Alignment;
+}
+
+void Engine::UniformArena::Grow(size_t MinimumCapacity)
+{
+    size_t NewCapacity = std::max<size_t>(Capacity, 64 * 1024);
+    while (NewCapacity < MinimumCapacity)
+        NewCapacity *= 2;
+
+    unsigned int NewBuffer;
+    glGenBuffers(1, &NewBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, NewCapacity, nullptr, GL_DYNAMIC_DRAW);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, NewBuffer, MemoryTracker::GpuOwner::Uniforms, NewCapacity);
+
+    // Copy on the GPU so every block keeps its contents and offset
+    if (Buffer != 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, Buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, Top);
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, Buffer);
+        glDeleteBuffers(1, &Buffer);
+        std::cout << "UniformArena: Grew to " << NewCapacity / 1024 << " KB" << std::endl;
+    }
+
+    Buffer = NewBuffer;
+    Capacity = NewCapacity;
+    BoundRanges.clear();
+}
+
+Engine::UniformArena::Allocation Engine::UniformArena::Allocate(size_t Size)
+{
+    Allocation Block;
+    if (Size == 0)
+        return Block;
+
+    size_t Aligned = AlignSize(Size);
+    Block.Size = static_cast<GLsizeiptr>(Size);
+
+    std::vector<GLintptr> &Recycled = FreeBlocks[Aligned];
+    if (!Recycled.empty())
+    {
+        Block.Offset = Recycled.back();
+        Recycled.pop_back();
+    }
+    else
+    {
+        if (Top + Aligned > Capacity)
+            Grow(Top + Aligned);
+        Block.Offset = static_cast<GLintptr>(Top);
+        Top += Aligned;
+    }
+
+    Used += Aligned;
+    return Block;
+}
+
+void Engine::UniformArena::Free(Allocation &Block)
+{
+    if (!Block.IsValid())
+        return;
+
+    size_t Aligned = AlignSize(Block.Size);
+    FreeBlocks[Aligned].push_back(Block.Offset);
+    Used -= Aligned;
+    Block = Allocation();
+}
+
+void Engine::UniformArena::Upload(const Allocation &Block, const void *Data, size_t Size)
+{
+    if (!Block.IsValid() || Buffer == 0)
+        return;
+
+    glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, Block.Offset, std::min<size_t>(Size, Block.Size), Data);
+    ++Uploads;
+}
+
+void Engine::UniformArena::BindRange(GLuint Binding, const Allocation &Block)
+{
+    if (!Block.IsValid() || Buffer == 0)
+        return;
+
+    if (BoundRanges.size() <= Binding)
+        BoundRanges.resize(Binding + 1);
+
+    Allocation &Bound = BoundRanges[Binding];
+    if (Bound.Offset == Block.Offset && Bound.Size == Block.Size)
+        return;
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, Binding, Buffer, Block.Offset, Block.Size);
+    Bound = Block;
+    ++RangeBinds;
+}
+
+void Engine::UniformArena::Release()
+{
+    if (Buffer != 0)
+    {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, Buffer);
+        glDeleteBuffers(1, &Buffer);
+    }
+
+    Buffer = 0;
+    Capacity = Top = Used = 0;
+    FreeBlocks.clear();
+    BoundRanges.clear();
+}
+
+unsigned int Engine::UniformArena::GetBuffer()
+{
+    return Buffer;
+}
+
+size_t Engine::UniformArena::GetCapacity()
+{
+    return Capacity;
+}
+
+size_t Engine::UniformArena::GetUsedBytes()
+{
+    return Used;
+}
+
+size_t Engine::UniformArena::GetRangeBindCount()
+{
+    return RangeBinds;
+}
+
+size_t Engine::UniformArena::GetUploadCount()
+{
+    return Uploads;
+}
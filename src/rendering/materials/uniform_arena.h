@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef uniform_arena_h
+#define uniform_arena_h
+
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+#include <glad/glad.h>
+#include "../../core/memory/memory_tracker.h"
+
+namespace Engine
+{
+    // One shared uniform buffer that is suballocated into per-material std140 blocks. Blocks are aligned to
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so each one can be bound on its own with glBindBufferRange, and
+    // freed blocks are recycled by size. The buffer doubles when full, offsets stay valid across growth.
+    class UniformArena
+    {
+    public:
+        struct Allocation
+        {
+            GLintptr Offset = 0;
+            GLsizeiptr Size = 0;
+
+            bool IsValid() const { return Size > 0; }
+        };
+
+        static Allocation Allocate(size_t Size);
+        static void Free(Allocation &Block);
+        static void Upload(const Allocation &Block, const void *Data, size_t Size);
+        // Skips the bind when the binding point already references this range
+        static void BindRange(GLuint Binding, const Allocation &Block);
+        static void Release();
+
+        static unsigned int GetBuffer();
+        static size_t GetCapacity();
+        static size_t GetUsedBytes();
+        static size_t GetRangeBindCount();
+        static size_t GetUploadCount();
+
+    private:
+        static unsigned int Buffer;
+        static size_t Capacity;
+        static size_t Top;
+        static size_t Used;
+        static GLint Alignment;
+        static std::unordered_map<size_t, std::vector<GLintptr>> FreeBlocks;
+        static std::vector<Allocation> BoundRanges;
+        static size_t RangeBinds;
+        static size_t Uploads;
+
+        static size_t AlignSize(size_t Size);
+        static void Grow(size_t MinimumCapacity);
+    };
+};
+
+#endif
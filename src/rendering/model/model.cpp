@@ -5,12 +5,13 @@ Engine::Model::Mesh::~Mesh()
     Meshes.clear();
     MaterialData.clear();
     Lights.clear();
+    Nodes.Clear();
+    MeshNodes.clear();
 }
 
 Engine::Model::Mesh Engine::Model::LoadMesh(std::string Path)
 {
-    std::filesystem::path FullPath = std::filesystem::path(Util::GetExecutablePath()) / Path;
-    std::string FullPathStr = FullPath.string();
+    std::string FullPathStr = Util::GetAssetPath(Path);
     const char *FullPathString = FullPathStr.c_str();
     Assimp::Importer Importer;
     const aiScene *Scene = Importer.ReadFile(FullPathString,
@@ -19,15 +20,22 @@ Engine::Model::Mesh Engine::Model::LoadMesh(std::string Path)
                                                  aiProcess_JoinIdenticalVertices |
                                                  aiProcess_SortByPType);
 
-    Mesh ModelMesh;
-
     if (!Scene || Scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !Scene->mRootNode)
     {
         std::string ErrorMessage = Importer.GetErrorString();
         std::cout << "Assimp Error: " << ErrorMessage << "\n";
-        return ModelMesh;
+        return Mesh();
     }
 
+    Mesh ModelMesh = LoadMesh(Scene);
+    ClassifyMaterials(ModelMesh.MaterialData, std::filesystem::path(Path).parent_path().generic_string() + "/");
+    return ModelMesh;
+}
+
+Engine::Model::Mesh Engine::Model::LoadMesh(const aiScene *Scene)
+{
+    Mesh ModelMesh;
+
     // Process Lights in the scene
     for (unsigned int i = 0; i < Scene->mNumLights; i++)
     {
@@ -155,36 +163,64 @@ Engine::Model::Mesh Engine::Model::LoadMesh(std::string Path)
         ModelMesh.MaterialData[i] = material;
     }
 
-    // Process Meshes in the scene
-    for (unsigned int MeshIndex = 0; MeshIndex < Scene->mNumMeshes; MeshIndex++)
+    // Extract vertex and index data of every mesh on the job system, the GL uploads below stay on this thread
+    struct ExtractedMesh
     {
-        aiMesh *AssimpMesh = Scene->mMeshes[MeshIndex];
-        MeshData Mesh;
-        std::vector<float> Vertices;
-        std::vector<unsigned int> Indices;
-
-        // Extracting vertex data
-        for (unsigned int i = 0; i < AssimpMesh->mNumVertices; i++)
+        TaggedVector<float, MemoryTracker::Tag::MeshImport> Vertices;
+        TaggedVector<unsigned int, MemoryTracker::Tag::MeshImport> Indices;
+        glm::vec3 BoundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 BoundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+    };
+    std::vector<ExtractedMesh> Extracted(Scene->mNumMeshes);
+
+    JobSystem::ParallelFor(Scene->mNumMeshes, 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t MeshIndex = Begin; MeshIndex < End; MeshIndex++)
         {
-            aiVector3D Pos = AssimpMesh->mVertices[i];
-            aiVector3D Normal = AssimpMesh->HasNormals() ? AssimpMesh->mNormals[i] : aiVector3D(0, 0, 0);
-            aiVector3D TexCoords = AssimpMesh->HasTextureCoords(0) ? AssimpMesh->mTextureCoords[0][i] : aiVector3D(0, 0, 0);
-
-            Vertices.insert(Vertices.end(), {Pos.x, Pos.y, Pos.z,
-                                             TexCoords.x, TexCoords.y,
-                                             Normal.x, Normal.y, Normal.z,
-                                             1.0f, 1.0f, 1.0f});
-        }
+            aiMesh *AssimpMesh = Scene->mMeshes[MeshIndex];
+            auto &Vertices = Extracted[MeshIndex].Vertices;
+            auto &Indices = Extracted[MeshIndex].Indices;
+            Vertices.reserve(AssimpMesh->mNumVertices * 11);
+            Indices.reserve(AssimpMesh->mNumFaces * 3);
+
+            // Extracting vertex data
+            for (unsigned int i = 0; i < AssimpMesh->mNumVertices; i++)
+            {
+                aiVector3D Pos = AssimpMesh->mVertices[i];
+                aiVector3D Normal = AssimpMesh->HasNormals() ? AssimpMesh->mNormals[i] : aiVector3D(0, 0, 0);
+                aiVector3D TexCoords = AssimpMesh->HasTextureCoords(0) ? AssimpMesh->mTextureCoords[0][i] : aiVector3D(0, 0, 0);
+                Extracted[MeshIndex].BoundsMin = glm::min(Extracted[MeshIndex].BoundsMin, glm::vec3(Pos.x, Pos.y, Pos.z));
+                Extracted[MeshIndex].BoundsMax = glm::max(Extracted[MeshIndex].BoundsMax, glm::vec3(Pos.x, Pos.y, Pos.z));
+
+                Vertices.insert(Vertices.end(), {Pos.x, Pos.y, Pos.z,
+                                                 TexCoords.x, TexCoords.y,
+                                                 Normal.x, Normal.y, Normal.z,
+                                                 1.0f, 1.0f, 1.0f});
+            }
 
-        // Extracting face data
-        for (unsigned int i = 0; i < AssimpMesh->mNumFaces; i++)
-        {
-            aiFace Face = AssimpMesh->mFaces[i];
-            for (unsigned int j = 0; j < Face.mNumIndices; j++)
+            // Extracting face data
+            for (unsigned int i = 0; i < AssimpMesh->mNumFaces; i++)
             {
-                Indices.push_back(Face.mIndices[j]);
+                const aiFace &Face = AssimpMesh->mFaces[i];
+                for (unsigned int j = 0; j < Face.mNumIndices; j++)
+                {
+                    Indices.push_back(Face.mIndices[j]);
+                }
             }
         }
+    });
+
+    for (unsigned int MeshIndex = 0; MeshIndex < Scene->mNumMeshes; MeshIndex++)
+    {
+        aiMesh *AssimpMesh = Scene->mMeshes[MeshIndex];
+        MeshData Mesh;
+        const auto &Vertices = Extracted[MeshIndex].Vertices;
+        const auto &Indices = Extracted[MeshIndex].Indices;
+        if (!Vertices.empty())
+        {
+            Mesh.BoundsMin = Extracted[MeshIndex].BoundsMin;
+            Mesh.BoundsMax = Extracted[MeshIndex].BoundsMax;
+        }
 
         glGenVertexArrays(1, &Mesh.VAO);
         glGenBuffers(1, &Mesh.VBO);
@@ -195,6 +231,8 @@ Engine::Model::Mesh Engine::Model::LoadMesh(std::string Path)
         glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(float), Vertices.data(), GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, Mesh.EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), Indices.data(), GL_STATIC_DRAW);
+        MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, Mesh.VBO, MemoryTracker::GpuOwner::Meshes, Vertices.size() * sizeof(float));
+        MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, Mesh.EBO, MemoryTracker::GpuOwner::Meshes, Indices.size() * sizeof(unsigned int));
 
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void *)0);
         glEnableVertexAttribArray(0);
@@ -211,106 +249,447 @@ Engine::Model::Mesh Engine::Model::LoadMesh(std::string Path)
         ModelMesh.Meshes.push_back(Mesh);
     }
 
+    // Flatten the node tree depth first, a node is only reached after its parent was added
+    std::vector<std::pair<const aiNode *, int>> Pending;
+    if (Scene->mRootNode)
+        Pending.push_back({Scene->mRootNode, TransformHierarchy::None});
+    while (!Pending.empty())
+    {
+        const aiNode *Node = Pending.back().first;
+        int Parent = Pending.back().second;
+        Pending.pop_back();
+
+        // Assimp matrices are row major and packed, so they are transposed field by field
+        const aiMatrix4x4 &T = Node->mTransformation;
+        glm::mat4 Transform(T.a1, T.b1, T.c1, T.d1, T.a2, T.b2, T.c2, T.d2,
+                            T.a3, T.b3, T.c3, T.d3, T.a4, T.b4, T.c4, T.d4);
+        int Index = ModelMesh.Nodes.Add(Transform, Parent);
+        for (unsigned int i = 0; i < Node->mNumMeshes; i++)
+        {
+            if (Node->mMeshes[i] < ModelMesh.Meshes.size())
+                ModelMesh.MeshNodes.push_back({Index, Node->mMeshes[i]});
+        }
+        for (unsigned int i = Node->mNumChildren; i > 0; i--)
+            Pending.push_back({Node->mChildren[i - 1], Index});
+    }
+    ModelMesh.Nodes.Update();
+
     return ModelMesh;
 }
 
-void Engine::Model::DrawModel(const MeshData &Mesh, Material *MaterialPtr, const glm::mat4 &ModelMatrix, Camera *MainCamera)
+namespace
 {
-    if (!MaterialPtr || !MainCamera)
+    using AlphaMode = Engine::Model::MaterialData::AlphaMode;
+
+    // Alpha at or below ClearAlpha is a hole, at or above SolidAlpha covered, out of 255
+    constexpr int ClearAlpha = 8;
+    constexpr int SolidAlpha = 247;
+    // Alpha in between within EdgeRadius texels of a hole or a covered texel is a soft mask edge, anything
+    // further in is translucent. A material stays masked while at most MaxTranslucentShare of it is
+    constexpr int EdgeRadius = 2;
+    constexpr float MaxTranslucentShare = 0.01f;
+
+    // Diffuse textures keep alpha in their last channel when they have one, masks in their first
+    AlphaMode ClassifyTexture(const std::string &Path, bool Mask)
     {
-        return;
+        int Width = 0, Height = 0, Channels = 0;
+        if (!Engine::Util::GetTextureInfo(Path, Width, Height, Channels))
+            return AlphaMode::Opaque;
+        if (!Mask && Channels != 2 && Channels != 4)
+            return AlphaMode::Opaque;
+
+        Engine::Util::TextureData Image = Engine::Util::DecodeTexture(Path);
+        if (!Image.Pixels)
+            return AlphaMode::Opaque;
+
+        int Channel = Mask ? 0 : Image.NumChannels - 1;
+        auto AlphaAt = [&](int X, int Y)
+        {
+            return static_cast<int>(Image.Pixels[(static_cast<size_t>(Y) * Image.Width + X) * Image.NumChannels + Channel]);
+        };
+
+        size_t Uncovered = 0, Translucent = 0;
+        for (int Y = 0; Y < Image.Height; ++Y)
+        {
+            for (int X = 0; X < Image.Width; ++X)
+            {
+                int Value = AlphaAt(X, Y);
+                if (Value >= SolidAlpha)
+                    continue;
+                ++Uncovered;
+                if (Value <= ClearAlpha)
+                    continue;
+
+                bool Edge = false;
+                for (int NY = std::max(Y - EdgeRadius, 0); NY <= std::min(Y + EdgeRadius, Image.Height - 1) && !Edge; ++NY)
+                {
+                    for (int NX = std::max(X - EdgeRadius, 0); NX <= std::min(X + EdgeRadius, Image.Width - 1) && !Edge; ++NX)
+                    {
+                        int Neighbor = AlphaAt(NX, NY);
+                        Edge = Neighbor <= ClearAlpha || Neighbor >= SolidAlpha;
+                    }
+                }
+                if (!Edge)
+                    ++Translucent;
+            }
+        }
+        size_t PixelCount = static_cast<size_t>(Image.Width) * Image.Height;
+        Engine::Util::FreeTextureData(Image);
+
+        if (Uncovered == 0)
+            return AlphaMode::Opaque;
+        return Translucent <= PixelCount * MaxTranslucentShare ? AlphaMode::Masked : AlphaMode::Translucent;
     }
 
-    MaterialPtr->Bind();
-    MaterialPtr->SetUniform("Model", ModelMatrix);
-    MaterialPtr->SetUniform("View", MainCamera->GetViewMatrix());
-    MaterialPtr->SetUniform("Projection", MainCamera->GetProjectionMatrix());
+    AlphaMode ClassifyMaterial(const Engine::Model::MaterialData &Data, const std::string &TextureDirectory)
+    {
+        if (Data.DiffuseColor.a * Data.Transparency < SolidAlpha / 255.0f)
+            return AlphaMode::Translucent;
+
+        AlphaMode Mode = AlphaMode::Opaque;
+        if (!Data.DiffuseTextures.empty())
+            Mode = std::max(Mode, ClassifyTexture(TextureDirectory + Data.DiffuseTextures[0], false));
+        if (!Data.OpacityTextures.empty())
+            Mode = std::max(Mode, ClassifyTexture(TextureDirectory + Data.OpacityTextures[0], true));
+        return Mode;
+    }
+}
 
-    glBindVertexArray(Mesh.VAO);
-    glDrawElements(GL_TRIANGLES, Mesh.IndexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+void Engine::Model::ClassifyMaterials(std::vector<MaterialData> &Materials, const std::string &TextureDirectory)
+{
+    ENGINE_PROFILE_FUNCTION();
+    // Every material decodes its own textures, so they are spread over the workers one by one
+    JobSystem::ParallelFor(Materials.size(), 1, [&](size_t Begin, size_t End)
+    {
+        for (size_t i = Begin; i < End; ++i)
+            Materials[i].Alpha = ClassifyMaterial(Materials[i], TextureDirectory);
+    });
+
+    size_t Counts[3] = {};
+    for (const MaterialData &Data : Materials)
+        ++Counts[static_cast<int>(Data.Alpha)];
+    std::cout << "Classified " << Materials.size() << " materials: " << Counts[0] << " opaque, " << Counts[1] << " masked, "
+              << Counts[2] << " translucent" << std::endl;
 }
 
-void Engine::Model::DrawMesh(const Mesh &ModelMesh, const std::vector<Material *> &Materials, const glm::mat4 &ModelMatrix, Camera *MainCamera)
+namespace
 {
-    if (Materials.empty() || !MainCamera)
+    struct DrawItem
     {
-        return;
+        const Engine::Model::MeshData *Mesh;
+        Engine::Material *MaterialPtr;
+        const glm::mat4 *InstanceTransform;
+        // Last frame's transform of a dynamic instance, null for static ones
+        const glm::mat4 *PreviousInstanceTransform;
+        // World matrix of the mesh's node inside the model, null when the mesh sits at the model origin
+        const glm::mat4 *NodeTransform;
+        const glm::mat4 *Transform;
+        int SortIndex;
+        float Distance;
+    };
+
+    // Conservative box test against the six clip planes of ViewProjection, box given in object space
+    bool IsBoxVisible(const glm::mat4 &ModelViewProjection, const glm::vec3 &Min, const glm::vec3 &Max)
+    {
+        glm::vec3 Center = (Min + Max) * 0.5f;
+        glm::vec3 Extent = (Max - Min) * 0.5f;
+        glm::vec4 ClipCenter = ModelViewProjection * glm::vec4(Center, 1.0f);
+
+        // Projected extent of the box along each clip axis
+        glm::vec4 ClipExtent = glm::abs(ModelViewProjection[0]) * Extent.x +
+                               glm::abs(ModelViewProjection[1]) * Extent.y +
+                               glm::abs(ModelViewProjection[2]) * Extent.z;
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            if (ClipCenter[Axis] - ClipExtent[Axis] > ClipCenter.w + ClipExtent.w)
+                return false;
+            if (ClipCenter[Axis] + ClipExtent[Axis] < -(ClipCenter.w + ClipExtent.w))
+                return false;
+        }
+        return true;
     }
 
-    std::vector<std::pair<int, size_t>> SortedMeshes;
+    // One item per mesh of every accepted instance, sized up front since growing a vector in the bump
+    // allocator would strand every smaller copy
+    template <typename Filter>
+    void CollectItems(const std::vector<Engine::Model::InstanceRef> &Instances, Engine::FrameVector<DrawItem> &Items, const Filter &Accept)
+    {
+        size_t ItemCount = 0;
+        for (const Engine::Model::InstanceRef &Ref : Instances)
+        {
+            const Engine::Model::Mesh &ModelMesh = Ref.Instance->ModelMesh;
+            if (!Ref.Instance->Materials.empty() && Accept(Ref))
+                ItemCount += ModelMesh.MeshNodes.empty() ? ModelMesh.Meshes.size() : ModelMesh.MeshNodes.size();
+        }
+
+        Items.reserve(ItemCount);
+        for (const Engine::Model::InstanceRef &Ref : Instances)
+        {
+            const Engine::Model::ModelInstance &Instance = *Ref.Instance;
+            if (Instance.Materials.empty() || !Accept(Ref))
+                continue;
+
+            auto AddItem = [&](size_t MeshIndex, const glm::mat4 *NodeTransform)
+            {
+                Engine::Material *MaterialPtr = (MeshIndex < Instance.Materials.size()) ? Instance.Materials[MeshIndex] : Instance.Materials.back();
+                const glm::mat4 *PreviousTransform = Ref.Dynamic ? &Ref.PreviousTransform : nullptr;
+                Items.push_back({&Instance.ModelMesh.Meshes[MeshIndex], MaterialPtr, &Ref.Transform, PreviousTransform, NodeTransform, nullptr, 0, 0.0f});
+            };
 
-    for (size_t i = 0; i < ModelMesh.Meshes.size(); ++i)
+            if (Instance.ModelMesh.MeshNodes.empty())
+            {
+                for (size_t i = 0; i < Instance.ModelMesh.Meshes.size(); ++i)
+                    AddItem(i, nullptr);
+            }
+            else
+            {
+                for (const Engine::Model::MeshNode &Node : Instance.ModelMesh.MeshNodes)
+                    AddItem(Node.MeshIndex, &Instance.ModelMesh.Nodes.GetWorld(Node.Node));
+            }
+        }
+    }
+
+    // Resolves world matrices into Transforms, fills the sort keys and drops items outside ViewProjection,
+    // one pass per item so it spreads over the workers
+    void CullItems(Engine::FrameVector<DrawItem> &Items, Engine::FrameVector<glm::mat4> &Transforms, const glm::mat4 &ViewProjection, const glm::vec3 &ViewPosition)
     {
-        Material *MaterialPtr = (i < Materials.size()) ? Materials[i] : Materials.back();
+        Transforms.resize(Items.size());
+        Engine::FrameVector<uint8_t> Visible(Items.size(), 0);
+        Engine::JobSystem::ParallelFor(Items.size(), 256, [&](size_t Begin, size_t End)
+        {
+            ENGINE_PROFILE_SCOPE("CullAndSortKeys");
+            for (size_t i = Begin; i < End; ++i)
+            {
+                DrawItem &Item = Items[i];
+                if (Item.NodeTransform)
+                {
+                    Engine::TransformHierarchy::Multiply(*Item.InstanceTransform, *Item.NodeTransform, Transforms[i]);
+                    Item.Transform = &Transforms[i];
+                }
+                else
+                    Item.Transform = Item.InstanceTransform;
 
-        int SortIndex = MaterialPtr->GetSortOrder();
+                Visible[i] = IsBoxVisible(ViewProjection * *Item.Transform, Item.Mesh->BoundsMin, Item.Mesh->BoundsMax);
+                Item.SortIndex = Item.MaterialPtr->GetSortOrder();
+                Item.Distance = glm::length(glm::vec3((*Item.Transform)[3]) - ViewPosition);
+            }
+        });
 
-        SortedMeshes.emplace_back(SortIndex, i);
+        size_t VisibleCount = 0;
+        for (size_t i = 0; i < Items.size(); ++i)
+        {
+            if (Visible[i])
+                Items[VisibleCount++] = Items[i];
+        }
+        Items.resize(VisibleCount);
     }
 
-    std::sort(SortedMeshes.begin(), SortedMeshes.end(),
-              [](const std::pair<int, size_t> &A, const std::pair<int, size_t> &B)
-              {
-                  return A.first < B.first;
-              });
+    // Camera matrices every draw of a pass shares
+    struct PassTransforms
+    {
+        glm::mat4 ViewProjection;
+        glm::mat4 PreviousViewProjection;
+        glm::vec4 Temporal;
+    };
+
+    // Opaque materials that write depth, the ones a depth pre-pass lays down
+    bool IsPrepassed(const Engine::Material *MaterialPtr)
+    {
+        return MaterialPtr->GetBlendingMode() == Engine::Material::BlendingMode::None && !MaterialPtr->IsAlphaTested() &&
+               MaterialPtr->GetDepthSortingMode() == Engine::Material::DepthSortingMode::ReadWrite;
+    }
 
-    for (const auto &[_, i] : SortedMeshes)
+    // Records disjoint ranges into separate lists, replaying them in order keeps the item order. Every item
+    // binds MaterialOverride instead of its own material when one is given. With DepthPrepass set the items
+    // a pre-pass drew are tested for equal depth
+    void RecordItems(const Engine::FrameVector<DrawItem> &Items, const PassTransforms &Pass, const Engine::Material *MaterialOverride, bool DepthPrepass, std::vector<Engine::CommandList> &Lists)
     {
-        Material *MaterialPtr = (i < Materials.size()) ? Materials[i] : Materials.back();
-        DrawModel(ModelMesh.Meshes[i], MaterialPtr, ModelMatrix, MainCamera);
+        size_t Chunk = std::max<size_t>(64, (Items.size() + Engine::JobSystem::GetWorkerCount() - 1) / Engine::JobSystem::GetWorkerCount());
+        size_t ListCount = (Items.size() + Chunk - 1) / Chunk;
+        Lists.resize(ListCount);
+
+        Engine::JobSystem::ParallelFor(ListCount, 1, [&](size_t Begin, size_t End)
+        {
+            ENGINE_PROFILE_SCOPE("RecordCommands");
+            for (size_t ListIndex = Begin; ListIndex < End; ++ListIndex)
+            {
+                Engine::CommandList &List = Lists[ListIndex];
+                List.Reset();
+                bool DepthEqual = false;
+
+                size_t Last = std::min(Items.size(), (ListIndex + 1) * Chunk);
+                for (size_t i = ListIndex * Chunk; i < Last; ++i)
+                {
+                    const DrawItem &Item = Items[i];
+                    glm::mat4 PreviousModel = *Item.Transform;
+                    if (Item.PreviousInstanceTransform && Item.NodeTransform)
+                        Engine::TransformHierarchy::Multiply(*Item.PreviousInstanceTransform, *Item.NodeTransform, PreviousModel);
+                    else if (Item.PreviousInstanceTransform)
+                        PreviousModel = *Item.PreviousInstanceTransform;
+
+                    bool Prepassed = DepthPrepass && IsPrepassed(Item.MaterialPtr);
+                    if (Prepassed != DepthEqual)
+                    {
+                        List.SetDepthEqual(Prepassed);
+                        DepthEqual = Prepassed;
+                    }
+                    List.BindMaterial(MaterialOverride ? MaterialOverride : Item.MaterialPtr);
+                    List.BindVertexArray(Item.Mesh->VAO);
+                    List.SetDrawParams(*Item.Transform, Pass.ViewProjection, Pass.PreviousViewProjection * PreviousModel, Pass.Temporal);
+                    List.DrawElements(Item.Mesh->IndexCount);
+                }
+            }
+        });
     }
 }
 
-void Engine::Model::DrawModelInstances(const std::vector<ModelInstance> &ModelInstances, Camera *MainCamera)
+void Engine::Model::DrawModel(const MeshData &Mesh, Material *MaterialPtr, const glm::mat4 &ModelMatrix, Camera *MainCamera)
 {
-    if (!MainCamera)
+    if (!MaterialPtr || !MainCamera)
     {
         return;
     }
 
-    std::vector<std::tuple<int, const MeshData *, Material *, glm::mat4>> SortedMeshes;
+    CommandList List;
+    List.BindMaterial(MaterialPtr);
+    List.BindVertexArray(Mesh.VAO);
+    glm::mat4 ViewProjection = MainCamera->GetProjectionMatrix() * MainCamera->GetViewMatrix();
+    List.SetDrawParams(ModelMatrix, ViewProjection, ViewProjection * ModelMatrix, glm::vec4(0.0f));
+    List.DrawElements(Mesh.IndexCount);
+    CommandList::Execute(List);
+}
 
-    for (const auto &Instance : ModelInstances)
+void Engine::Model::DrawMesh(const Mesh &ModelMesh, const std::vector<Material *> &Materials, const glm::mat4 &ModelMatrix, Camera *MainCamera)
+{
+    if (Materials.empty() || !MainCamera)
     {
-        const Mesh &ModelMesh = Instance.ModelMesh;
-        const glm::mat4 &ModelMatrix = Instance.Transform;
+        return;
+    }
 
-        for (size_t i = 0; i < ModelMesh.Meshes.size(); ++i)
-        {
-            Material *MaterialPtr = (i < Instance.Materials.size()) ? Instance.Materials[i] : Instance.Materials.back();
+    ModelInstance Instance(ModelMesh, Materials, ModelMatrix);
+    std::vector<CommandList> Lists;
+    RecordModelInstances({{&Instance, ModelMatrix}}, *MainCamera, Lists);
+    CommandList::Execute(Lists);
+}
+
+void Engine::Model::DrawModelInstances(const std::vector<ModelInstance> &ModelInstances, Camera *MainCamera)
+{
+    if (!MainCamera)
+    {
+        return;
+    }
+
+    std::vector<InstanceRef> Instances;
+    for (const ModelInstance &Instance : ModelInstances)
+        Instances.push_back({&Instance, Instance.Transform});
 
-            int SortIndex = MaterialPtr->GetSortOrder();
+    std::vector<CommandList> Lists;
+    RecordModelInstances(Instances, *MainCamera, Lists);
+    CommandList::Execute(Lists);
+}
+
+void Engine::Model::RecordModelInstances(const std::vector<InstanceRef> &Instances, const Camera &MainCamera, std::vector<CommandList> &Lists)
+{
+    std::vector<CommandList> NoPrepass;
+    RecordModelInstances(Instances, MainCamera, Lists, nullptr, NoPrepass);
+}
 
-            SortedMeshes.emplace_back(SortIndex, &ModelMesh.Meshes[i], MaterialPtr, ModelMatrix);
+void Engine::Model::RecordModelInstances(const std::vector<InstanceRef> &Instances, const Camera &MainCamera, std::vector<CommandList> &Lists,
+                                         const Material *PrepassMaterial, std::vector<CommandList> &PrepassLists)
+{
+    ENGINE_PROFILE_FUNCTION();
+    glm::mat4 View = MainCamera.GetViewMatrix();
+    PassTransforms Pass = {MainCamera.GetJitteredProjectionMatrix() * View, MainCamera.GetPreviousViewProjectionMatrix(),
+                           glm::vec4(MainCamera.GetJitter(), MainCamera.GetJitterPhase(), 0.0f)};
+
+    FrameVector<DrawItem> Items;
+    FrameVector<glm::mat4> Transforms;
+    CollectItems(Instances, Items, [](const InstanceRef &) { return true; });
+    CullItems(Items, Transforms, Pass.ViewProjection, MainCamera.GetPosition());
+
+    // Sort order first, opaque before alpha tested, then front to back, then by material so equal keys share state
+    std::sort(Items.begin(), Items.end(), [](const DrawItem &A, const DrawItem &B)
+    {
+        if (A.SortIndex != B.SortIndex)
+            return A.SortIndex < B.SortIndex;
+        if (A.MaterialPtr->IsAlphaTested() != B.MaterialPtr->IsAlphaTested())
+            return B.MaterialPtr->IsAlphaTested();
+        if (A.Distance != B.Distance)
+            return A.Distance < B.Distance;
+        return A.MaterialPtr < B.MaterialPtr;
+    });
+
+    if (PrepassMaterial)
+    {
+        // Same culled items in the same front to back order, minus everything the equal test would not cover
+        FrameVector<DrawItem> PrepassItems;
+        PrepassItems.reserve(Items.size());
+        for (const DrawItem &Item : Items)
+        {
+            if (IsPrepassed(Item.MaterialPtr))
+                PrepassItems.push_back(Item);
         }
+        RecordItems(PrepassItems, Pass, PrepassMaterial, false, PrepassLists);
     }
+    else
+        PrepassLists.clear();
 
-    std::sort(SortedMeshes.begin(), SortedMeshes.end(),
-              [MainCamera](const auto &A, const auto &B)
-              {
-                  int SortIndexA = std::get<0>(A);
-                  int SortIndexB = std::get<0>(B);
+    RecordItems(Items, Pass, nullptr, PrepassMaterial != nullptr, Lists);
+}
+
+void Engine::Model::RecordDepthPass(const std::vector<InstanceRef> &Instances, const glm::mat4 &View, const glm::mat4 &Projection, DepthCasters Casters, const Material *DepthMaterial, std::vector<CommandList> &Lists)
+{
+    ENGINE_PROFILE_FUNCTION();
+    FrameVector<DrawItem> Items;
+    FrameVector<glm::mat4> Transforms;
+    CollectItems(Instances, Items, [Casters](const InstanceRef &Ref)
+                 { return Casters == DepthCasters::All || Ref.Dynamic == (Casters == DepthCasters::Dynamic); });
 
-                  // First, compare the SortIndex
-                  if (SortIndexA != SortIndexB)
-                  {
-                      return SortIndexA < SortIndexB;
-                  }
+    // Blended surfaces cast no shadow
+    Items.erase(std::remove_if(Items.begin(), Items.end(), [](const DrawItem &Item)
+                               { return Item.MaterialPtr->GetBlendingMode() != Material::BlendingMode::None; }),
+                Items.end());
 
-                  // If SortIndex is the same, compare by distance to the camera
-                  glm::vec3 ModelPosA = glm::vec3(std::get<3>(A)[3]);
-                  glm::vec3 ModelPosB = glm::vec3(std::get<3>(B)[3]);
-                  float DistanceA = glm::length(ModelPosA - MainCamera->GetPosition());
-                  float DistanceB = glm::length(ModelPosB - MainCamera->GetPosition());
+    glm::mat4 ViewProjection = Projection * View;
+    CullItems(Items, Transforms, ViewProjection, glm::vec3(glm::inverse(View)[3]));
 
-                  return DistanceA < DistanceB;
-              });
+    // Only one material is bound, grouping by vertex array drops most of the remaining state changes
+    std::sort(Items.begin(), Items.end(), [](const DrawItem &A, const DrawItem &B)
+              { return A.Mesh->VAO < B.Mesh->VAO; });
 
-    for (const auto &[_, Mesh, MaterialPtr, ModelMatrix] : SortedMeshes)
+    RecordItems(Items, {ViewProjection, ViewProjection, glm::vec4(0.0f)}, DepthMaterial, false, Lists);
+}
+
+void Engine::Model::GetInstanceBounds(const ModelInstance &Instance, glm::vec3 &Min, glm::vec3 &Max)
+{
+    const Mesh &ModelMesh = Instance.ModelMesh;
+    Min = glm::vec3(std::numeric_limits<float>::max());
+    Max = glm::vec3(std::numeric_limits<float>::lowest());
+
+    auto AddMesh = [&](const MeshData &Data, const glm::mat4 &Transform)
+    {
+        glm::vec3 Center = glm::vec3(Transform * glm::vec4((Data.BoundsMin + Data.BoundsMax) * 0.5f, 1.0f));
+        glm::vec3 Extent = (Data.BoundsMax - Data.BoundsMin) * 0.5f;
+        glm::vec3 Reach = glm::abs(glm::vec3(Transform[0])) * Extent.x + glm::abs(glm::vec3(Transform[1])) * Extent.y +
+                          glm::abs(glm::vec3(Transform[2])) * Extent.z;
+        Min = glm::min(Min, Center - Reach);
+        Max = glm::max(Max, Center + Reach);
+    };
+
+    if (ModelMesh.MeshNodes.empty())
     {
-        DrawModel(*Mesh, MaterialPtr, ModelMatrix, MainCamera);
+        for (const MeshData &Data : ModelMesh.Meshes)
+            AddMesh(Data, glm::mat4(1.0f));
     }
+    else
+    {
+        for (const MeshNode &Node : ModelMesh.MeshNodes)
+            AddMesh(ModelMesh.Meshes[Node.MeshIndex], ModelMesh.Nodes.GetWorld(Node.Node));
+    }
+
+    if (Min.x > Max.x)
+        Min = Max = glm::vec3(0.0f);
 }
 
 void Engine::Model::UnloadModelInstance(ModelInstance &instance)
@@ -324,6 +703,8 @@ void Engine::Model::UnloadMesh(Mesh &ModelMesh)
 {
     for (MeshData &Mesh : ModelMesh.Meshes)
     {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, Mesh.VBO);
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, Mesh.EBO);
         glDeleteVertexArrays(1, &Mesh.VAO);
         glDeleteBuffers(1, &Mesh.VBO);
         glDeleteBuffers(1, &Mesh.EBO);
@@ -332,5 +713,6 @@ void Engine::Model::UnloadMesh(Mesh &ModelMesh)
     }
     ModelMesh.Meshes.clear();
     ModelMesh.MaterialData.clear();
-    delete &ModelMesh;
+    ModelMesh.Nodes.Clear();
+    ModelMesh.MeshNodes.clear();
 }
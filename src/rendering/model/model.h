@@ -13,9 +13,14 @@
 #include <assimp/postprocess.h>
 #include <glm/glm.hpp>
 #include <algorithm>
+#include <limits>
 #include "../../util/util.h"
 #include "../materials/material.h"
 #include "../camera/camera.h"
+#include "../../core/jobs/job_system.h"
+#include "../commands/command_list.h"
+#include "../../core/memory/frame_arena.h"
+#include "../../core/transforms/transform_hierarchy.h"
 
 namespace Engine
 {
@@ -27,6 +32,8 @@ namespace Engine
             unsigned int VAO, VBO, EBO;
             unsigned int IndexCount;
             int MaterialIndex;
+            glm::vec3 BoundsMin = glm::vec3(0.0f); // Object space bounding box
+            glm::vec3 BoundsMax = glm::vec3(0.0f);
         };
 
 
@@ -48,12 +55,16 @@ namespace Engine
         };
         
         struct MaterialData {
+            // How see through a material is: not at all, cut out where its alpha drops to zero or blended
+            enum class AlphaMode { Opaque, Masked, Translucent };
+
             glm::vec4 DiffuseColor;      // Diffuse color
             glm::vec4 AmbientColor;      // Ambient color
             glm::vec4 SpecularColor;     // Specular color
             glm::vec4 EmissiveColor;     // Emissive color
             float Shininess;             // Shininess (specular exponent)
             float Transparency;          // Transparency factor
+            AlphaMode Alpha;             // Classified from the diffuse alpha and opacity textures
         
             // Texture paths
             std::vector<std::string> DiffuseTextures;      // Diffuse texture paths
@@ -76,15 +87,27 @@ namespace Engine
                   SpecularColor(glm::vec4(0.0f)), // Default black specular
                   EmissiveColor(glm::vec4(0.0f)), // Default black emissive
                   Shininess(32.0f),               // Default shininess
-                  Transparency(1.0f) {}            // Fully opaque by default
+                  Transparency(1.0f),             // Fully opaque by default
+                  Alpha(AlphaMode::Opaque) {}
         };
         
         
+        // A mesh placed by a node of the imported scene graph
+        struct MeshNode
+        {
+            int Node;
+            unsigned int MeshIndex;
+        };
+
         struct Mesh
         {
             std::vector<MeshData> Meshes;
-            std::vector<MaterialData> MaterialData;
+            std::vector<Model::MaterialData> MaterialData;
             std::vector<LightData> Lights;
+            // Node transforms of the imported scene relative to the model, meshes no node references are
+            // drawn at the model origin when MeshNodes is empty
+            TransformHierarchy Nodes;
+            std::vector<MeshNode> MeshNodes;
         
             ~Mesh();
         };
@@ -105,12 +128,46 @@ namespace Engine
         };
         
 
+        // An instance to draw with the transform it should be drawn at this frame. Static instances may be
+        // cached by passes like the shadow maps, an instance that moves has to be flagged Dynamic and carry
+        // the transform it was drawn at last frame for its motion vectors
+        struct InstanceRef
+        {
+            const ModelInstance *Instance;
+            glm::mat4 Transform;
+            bool Dynamic = false;
+            glm::mat4 PreviousTransform = glm::mat4(1.0f);
+        };
+
+        enum class DepthCasters { Static, Dynamic, All };
+
         static void UnloadModelInstance(ModelInstance& instance);
+        // Imports the file and classifies its materials with the textures next to it
         static Mesh LoadMesh(std::string Path);
+        // Builds the mesh from an already imported scene, lights, materials and GL buffers included
+        static Mesh LoadMesh(const aiScene *Scene);
+        // Sets the AlphaMode of every material by scanning its diffuse alpha and opacity textures, paths are
+        // taken relative to TextureDirectory. Only textures that can hold alpha are decoded
+        static void ClassifyMaterials(std::vector<MaterialData> &Materials, const std::string &TextureDirectory);
         static void UnloadMesh(Mesh &Mesh);
         static void DrawModel(const MeshData &Mesh, class Material *MaterialPtr, const glm::mat4 &ModelMatrix, Camera *MainCamera);
         static void DrawMesh(const Mesh &ModelMesh, const std::vector<Material *> &Materials, const glm::mat4 &ModelMatrix, Camera *MainCamera);
         static void DrawModelInstances(const std::vector<ModelInstance> &ModelInstances, Camera *MainCamera);
+        // Frustum culls, sorts and records the instances into command lists on the job system without any
+        // GL calls, replay the lists on the GL thread with CommandList::Execute. Draws use the camera's
+        // jittered projection and its previous view projection for motion vectors. Scratch data comes from
+        // the calling thread's FrameArena buffer
+        static void RecordModelInstances(const std::vector<InstanceRef> &Instances, const Camera &MainCamera, std::vector<CommandList> &Lists);
+        // Also records a depth pre-pass into PrepassLists when PrepassMaterial is set. Opaque draws are laid
+        // down depth only with PrepassMaterial first and then shaded with an equal depth test, alpha tested and
+        // blended ones are left to the main lists as they are
+        static void RecordModelInstances(const std::vector<InstanceRef> &Instances, const Camera &MainCamera, std::vector<CommandList> &Lists,
+                                         const Material *PrepassMaterial, std::vector<CommandList> &PrepassLists);
+        // Records depth-only draws of the instances Casters selects with DepthMaterial bound for every mesh,
+        // culled against View and Projection. Blended materials are skipped
+        static void RecordDepthPass(const std::vector<InstanceRef> &Instances, const glm::mat4 &View, const glm::mat4 &Projection, DepthCasters Casters, const Material *DepthMaterial, std::vector<CommandList> &Lists);
+        // Box around every mesh of the instance in model space, node transforms included
+        static void GetInstanceBounds(const ModelInstance &Instance, glm::vec3 &Min, glm::vec3 &Max);
     };
 };
 
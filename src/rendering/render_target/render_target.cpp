@@ -26,6 +26,7 @@ Engine::RenderTarget::RenderTarget(glm::vec2 Size, const std::vector<Attachment>
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
 
     glDrawBuffers(DrawBuffers.size(), DrawBuffers.data());
+    TrackMemory();
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cerr << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
@@ -37,7 +38,11 @@ Engine::RenderTarget::~RenderTarget()
 {
     glDeleteFramebuffers(1, &FBO);
     for (GLuint Texture : Textures)
+    {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Texture, Texture);
         glDeleteTextures(1, &Texture);
+    }
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Renderbuffer, RBO);
     glDeleteRenderbuffers(1, &RBO);
 }
 
@@ -54,6 +59,9 @@ void Engine::RenderTarget::Unbind()
 
 void Engine::RenderTarget::Resize(glm::vec2 Size)
 {
+    // Reallocating every frame is costly, the size rarely changes
+    if (Size == TargetSize)
+        return;
     TargetSize = Size;
 
     for (size_t i = 0; i < Attachments.size(); ++i)
@@ -64,4 +72,14 @@ void Engine::RenderTarget::Resize(glm::vec2 Size)
 
     glBindRenderbuffer(GL_RENDERBUFFER, RBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, TargetSize.x, TargetSize.y);
+    TrackMemory();
+}
+
+void Engine::RenderTarget::TrackMemory()
+{
+    for (size_t i = 0; i < Attachments.size(); ++i)
+        MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, Textures[i], MemoryTracker::GpuOwner::RenderTargets,
+                                MemoryTracker::GetTextureSize(Attachments[i].InternalFormat, TargetSize.x, TargetSize.y));
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Renderbuffer, RBO, MemoryTracker::GpuOwner::RenderTargets,
+                            MemoryTracker::GetTextureSize(GL_DEPTH24_STENCIL8, TargetSize.x, TargetSize.y));
 }
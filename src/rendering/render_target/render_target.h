@@ -5,6 +5,7 @@
 #include <iostream>
 #include <glm/glm.hpp>
 #include <vector>
+#include "../../core/memory/memory_tracker.h"
 
 namespace Engine
 {
@@ -31,6 +32,9 @@ namespace Engine
         void Bind();
         void Unbind();
         void Resize(glm::vec2 Size);
+
+    private:
+        void TrackMemory();
     };
 };
 #endif
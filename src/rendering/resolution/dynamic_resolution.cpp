@@ -0,0 +1,143 @@
+#include "dynamic_resolution.h"
+
+Engine::DynamicResolution::DynamicResolution(const Settings &Options)
+    : Options(Options)
+{
+    this->Options.MaxScale = std::clamp(Options.MaxScale, 0.1f, 1.0f);
+    this->Options.MinScale = std::clamp(Options.MinScale, 0.1f, this->Options.MaxScale);
+    this->Options.TargetFrameMs = std::max(Options.TargetFrameMs, 0.1f);
+    Scale = this->Options.MaxScale;
+    History.reserve(HistorySize);
+
+    for (Query &Slot : Queries)
+    {
+        glGenQueries(1, &Slot.Start);
+        glGenQueries(1, &Slot.End);
+    }
+}
+
+Engine::DynamicResolution::~DynamicResolution()
+{
+    for (Query &Slot : Queries)
+    {
+        glDeleteQueries(1, &Slot.Start);
+        glDeleteQueries(1, &Slot.End);
+    }
+}
+
+void Engine::DynamicResolution::BeginFrame(float FrameScale)
+{
+    // The slot about to be reused was issued QueryLatency frames ago, a result that is still not available
+    // is dropped rather than waited for
+    Query &Slot = Queries[QueryIndex];
+    if (Slot.Pending)
+    {
+        GLint Available = 0;
+        glGetQueryObjectiv(Slot.End, GL_QUERY_RESULT_AVAILABLE, &Available);
+        if (Available)
+        {
+            GLuint64 Start = 0, End = 0;
+            glGetQueryObjectui64v(Slot.Start, GL_QUERY_RESULT, &Start);
+            glGetQueryObjectui64v(Slot.End, GL_QUERY_RESULT, &End);
+            Update(Slot, static_cast<float>((End - Start) / 1.0e6));
+        }
+        Slot.Pending = false;
+    }
+
+    Slot.Scale = FrameScale;
+    glQueryCounter(Slot.Start, GL_TIMESTAMP);
+    Timing = true;
+}
+
+void Engine::DynamicResolution::EndFrame()
+{
+    if (!Timing)
+        return;
+
+    Query &Slot = Queries[QueryIndex];
+    glQueryCounter(Slot.End, GL_TIMESTAMP);
+    Slot.Pending = true;
+    QueryIndex = (QueryIndex + 1) % QueryLatency;
+    Timing = false;
+}
+
+void Engine::DynamicResolution::Update(const Query &Finished, float GpuMs)
+{
+    if (Options.Enabled && GpuMs > 0.0f)
+    {
+        // GPU time follows the pixel count, so the scale that fits the budget goes with the square root of
+        // the time ratio. It is taken relative to the scale the measured frame was drawn at, the frames in
+        // flight since then are already moving towards it
+        float Budget = Options.TargetFrameMs * Options.Headroom;
+        float Ideal = std::clamp(Finished.Scale * std::sqrt(Budget / GpuMs), Options.MinScale, Options.MaxScale);
+
+        // Over budget shows as a hitch, so drop quickly and only climb back slowly
+        float Current = Scale;
+        float Rate = (Ideal < Current) ? Options.Gain : Options.Gain * 0.25f;
+        Scale = std::clamp(Current + (Ideal - Current) * Rate, Options.MinScale, Options.MaxScale);
+    }
+    else
+        Scale = Options.MaxScale;
+
+    std::lock_guard<std::mutex> Lock(HistoryMutex);
+    Sample Entry = {Finished.Scale, GpuMs};
+    if (History.size() < HistorySize)
+        History.push_back(Entry);
+    else
+        History[HistoryNext] = Entry;
+    HistoryNext = (HistoryNext + 1) % HistorySize;
+}
+
+void Engine::DynamicResolution::SetEnabled(bool Enabled)
+{
+    Options.Enabled = Enabled;
+    if (!Enabled)
+        Scale = Options.MaxScale;
+}
+
+bool Engine::DynamicResolution::IsEnabled() const
+{
+    return Options.Enabled;
+}
+
+float Engine::DynamicResolution::GetScale() const
+{
+    return Scale;
+}
+
+glm::uvec2 Engine::DynamicResolution::GetRenderSize(const glm::uvec2 &OutputSize) const
+{
+    glm::vec2 Size = glm::round(glm::vec2(OutputSize) * Scale.load());
+    return glm::clamp(glm::uvec2(Size), glm::uvec2(1), glm::max(OutputSize, glm::uvec2(1)));
+}
+
+std::vector<Engine::DynamicResolution::Sample> Engine::DynamicResolution::GetHistory() const
+{
+    std::lock_guard<std::mutex> Lock(HistoryMutex);
+    std::vector<Sample> Ordered;
+    Ordered.reserve(History.size());
+    size_t First = (History.size() < HistorySize) ? 0 : HistoryNext;
+    for (size_t i = 0; i < History.size(); ++i)
+        Ordered.push_back(History[(First + i) % History.size()]);
+    return Ordered;
+}
+
+std::string Engine::DynamicResolution::GetOverlayText() const
+{
+    std::vector<Sample> Samples = GetHistory();
+    std::ostringstream Text;
+    Text << std::fixed << std::setprecision(0);
+    if (Samples.empty())
+        return "Render scale: not measured yet";
+
+    float Lowest = Samples[0].Scale, Highest = Samples[0].Scale;
+    for (const Sample &Entry : Samples)
+    {
+        Lowest = std::min(Lowest, Entry.Scale);
+        Highest = std::max(Highest, Entry.Scale);
+    }
+    Text << "Render scale: " << Samples.back().Scale * 100.0f << "% (" << Lowest * 100.0f << "-" << Highest * 100.0f
+         << "% over " << Samples.size() << " frames)" << std::setprecision(2) << ", GPU " << Samples.back().GpuMs << " / "
+         << Options.TargetFrameMs << " ms";
+    return Text.str();
+}
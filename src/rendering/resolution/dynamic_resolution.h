@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef dynamic_resolution_h
+#define dynamic_resolution_h
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+namespace Engine
+{
+    // Closed loop render scale governor. The GPU time of every frame is measured with timestamp queries that
+    // are read back QueryLatency frames later, only once available, and the scale moves towards the one whose
+    // pixel count fits the budget. Render targets keep their full size, a scaled frame only draws into the
+    // lower left corner of them and the upscaler stretches that over the output.
+    //
+    // BeginFrame, EndFrame and SetEnabled are GL thread only. The current scale, the history and the overlay
+    // text built from it can be read from any thread, the simulation thread picks each frame's render size.
+    class DynamicResolution
+    {
+    public:
+        static constexpr int QueryLatency = 4;
+        static constexpr size_t HistorySize = 240;
+
+        struct Settings
+        {
+            bool Enabled = true;
+            float TargetFrameMs = 1000.0f / 60.0f;
+            // Share of the budget the governor aims for, what is left absorbs spikes
+            float Headroom = 0.9f;
+            float MinScale = 0.5f;
+            float MaxScale = 1.0f;
+            // Fraction of the way to the ideal scale moved per measured frame when dropping, rising is slower
+            float Gain = 0.3f;
+        };
+
+        struct Sample
+        {
+            float Scale;
+            float GpuMs;
+        };
+
+        DynamicResolution(const Settings &Options);
+        ~DynamicResolution();
+
+        // Reads back finished measurements, updates the scale and starts timing the frame, which is drawn at
+        // FrameScale. That is the scale its render size was picked with and may lag the current one
+        void BeginFrame(float FrameScale);
+        void EndFrame();
+
+        // Leaving the governor disabled renders at MaxScale
+        void SetEnabled(bool Enabled);
+        bool IsEnabled() const;
+
+        float GetScale() const;
+        // Size of the region the scene is drawn into for an output of OutputSize, never zero
+        glm::uvec2 GetRenderSize(const glm::uvec2 &OutputSize) const;
+
+        // Scale and GPU time of the last measured frames, oldest first
+        std::vector<Sample> GetHistory() const;
+        std::string GetOverlayText() const;
+
+    private:
+        struct Query
+        {
+            GLuint Start = 0, End = 0;
+            float Scale = 1.0f;
+            bool Pending = false;
+        };
+
+        Settings Options;
+        std::atomic<float> Scale{1.0f};
+        Query Queries[QueryLatency];
+        int QueryIndex = 0;
+        bool Timing = false;
+
+        mutable std::mutex HistoryMutex;
+        std::vector<Sample> History;
+        size_t HistoryNext = 0;
+
+        void Update(const Query &Finished, float GpuMs);
+    };
+};
+
+#endif
@@ -1,23 +1,32 @@
 #include "shader.h"
 
-Engine::Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath) {
-    std::string vertexSource = LoadShaderSource(vertexPath);
-    std::string fragmentSource = LoadShaderSource(fragmentPath);
-
-    unsigned int vertexShaderId = CreateShader(GL_VERTEX_SHADER, vertexSource);
-    unsigned int fragmentShaderId = CreateShader(GL_FRAGMENT_SHADER, fragmentSource);
-
-    if (vertexShaderId != 0 && fragmentShaderId != 0) {
-        ID = CreateProgram(vertexShaderId, fragmentShaderId);
-        glDeleteShader(vertexShaderId);
-        glDeleteShader(fragmentShaderId);
-        if (ID == 0) { // Check if program creation failed
-            std::cerr << "Failed to create shader program (linking error)" << std::endl;
-        }
-    } else {
-        std::cerr << "Failed to create shader program (compilation error)" << std::endl;
-        ID = 0;
+bool Engine::Shader::ParallelCompile = false;
+
+Engine::Shader::Shader(const std::string &vertexPath, const std::string &fragmentPath, const std::vector<std::string> &defines) {
+    std::string vertexSource = PreprocessSource(vertexPath, defines);
+    std::string fragmentSource = PreprocessSource(fragmentPath, defines);
+
+    std::string defineList;
+    for (const std::string &define : defines) {
+        defineList += define + ";";
+    }
+
+    CacheKey = ShaderCache::ComputeKey(vertexSource, fragmentSource, defineList);
+    ID = ShaderCache::Load(CacheKey);
+    if (ID != 0) {
+        Status = CompileStatus::Ready;
+        ReflectUniformBlocks();
+        return;
     }
+
+    // Submit compile and link without querying any status, the driver can work on it in the background
+    // while the remaining programs are submitted. IsReady() collects the result later.
+    auto submitStart = std::chrono::steady_clock::now();
+    VertexShaderId = CreateShader(GL_VERTEX_SHADER, vertexSource);
+    FragmentShaderId = CreateShader(GL_FRAGMENT_SHADER, fragmentSource);
+    ID = CreateProgram(VertexShaderId, FragmentShaderId);
+    BlockingSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - submitStart).count();
+    Status = (ID != 0) ? CompileStatus::Compiling : CompileStatus::Failed;
 }
 
 Engine::Shader::~Shader() {
@@ -38,6 +47,11 @@ void Engine::Shader::Unbind() const {
 }
 
 void Engine::Shader::Unload() {
+    if (VertexShaderId != 0) {
+        glDeleteShader(VertexShaderId);
+        glDeleteShader(FragmentShaderId);
+        VertexShaderId = FragmentShaderId = 0;
+    }
     if (ID != 0) {
         glDeleteProgram(ID);
         ID = 0;
@@ -49,25 +63,22 @@ unsigned int Engine::Shader::CreateShader(unsigned int shaderType, const std::st
     const char* source = shaderSource.c_str();
     glShaderSource(shaderId, 1, &source, nullptr);
     glCompileShader(shaderId);
+    return shaderId;
+}
 
+bool Engine::Shader::CompileShader(unsigned int shaderId) {
     int status;
     glGetShaderiv(shaderId, GL_COMPILE_STATUS, &status);
     if (!status) {
         char infoLog[512];
         glGetShaderInfoLog(shaderId, sizeof(infoLog), nullptr, infoLog);
         std::cerr << "Shader compilation error:\n" << infoLog << std::endl;
-        glDeleteShader(shaderId);
-        return 0;
+        return false;
     }
-    return shaderId;
+    return true;
 }
 
 unsigned int Engine::Shader::CreateProgram(unsigned int vertexShaderId, unsigned int fragmentShaderId) {
-    if (vertexShaderId == 0 || fragmentShaderId == 0) {
-        std::cerr << "Error: One or both shaders failed to compile!" << std::endl;
-        return 0;
-    }
-
     unsigned int programId = glCreateProgram();
     if (programId == 0) {
         std::cerr << "Error: glCreateProgram() failed!" << std::endl;
@@ -76,24 +87,142 @@ unsigned int Engine::Shader::CreateProgram(unsigned int vertexShaderId, unsigned
 
     glAttachShader(programId, vertexShaderId);
     glAttachShader(programId, fragmentShaderId);
+    glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(programId);
+    return programId;
+}
 
+bool Engine::Shader::LinkProgram(unsigned int programId) {
     int status;
     glGetProgramiv(programId, GL_LINK_STATUS, &status);
     if (!status) {
         char infoLog[1024];
         glGetProgramInfoLog(programId, sizeof(infoLog), nullptr, infoLog);
         std::cerr << "Shader linking error:\n" << infoLog << std::endl;
-        glDeleteProgram(programId);
-        return 0;
+        return false;
     }
 
     std::cout << "Shader Program Linked Successfully. ID: " << programId << std::endl;
-    return programId;
+    return true;
+}
+
+bool Engine::Shader::IsReady() {
+    if (Status != CompileStatus::Compiling) {
+        return Status == CompileStatus::Ready;
+    }
+
+    // With KHR_parallel_shader_compile the completion query never blocks, otherwise the first query waits
+    if (ParallelCompile) {
+        int complete = 0;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &complete);
+        if (!complete) {
+            return false;
+        }
+    }
+
+    // Only time spent inside the compile and link calls is counted, the wall time since submission would
+    // include whatever loading and frames ran while the program was pending
+    auto finalizeStart = std::chrono::steady_clock::now();
+    bool compiled = CompileShader(VertexShaderId) & CompileShader(FragmentShaderId);
+    bool linked = compiled && LinkProgram(ID);
+    glDeleteShader(VertexShaderId);
+    glDeleteShader(FragmentShaderId);
+    VertexShaderId = FragmentShaderId = 0;
+
+    BlockingSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - finalizeStart).count();
+    ShaderCache::RecordMiss(BlockingSeconds);
+
+    if (!linked) {
+        std::cerr << "Failed to create shader program (" << (compiled ? "linking" : "compilation") << " error)" << std::endl;
+        glDeleteProgram(ID);
+        ID = 0;
+        Status = CompileStatus::Failed;
+        return false;
+    }
+
+    ShaderCache::Store(CacheKey, ID, BlockingSeconds);
+    Status = CompileStatus::Ready;
+    ReflectUniformBlocks();
+    return true;
+}
+
+void Engine::Shader::ReflectUniformBlocks() {
+    unsigned int drawBlockIndex = glGetUniformBlockIndex(ID, "DrawParams");
+    if (drawBlockIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(ID, drawBlockIndex, DrawBlockBinding);
+    }
+
+    unsigned int blockIndex = glGetUniformBlockIndex(ID, "MaterialParams");
+    if (blockIndex == GL_INVALID_INDEX) {
+        return;
+    }
+
+    // GLSL 410 has no binding layout qualifier, so the binding point is assigned here
+    glUniformBlockBinding(ID, blockIndex, MaterialBlockBinding);
+    glGetActiveUniformBlockiv(ID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &MaterialBlockSize);
+
+    int memberCount = 0;
+    glGetActiveUniformBlockiv(ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+    std::vector<GLint> indices(memberCount);
+    glGetActiveUniformBlockiv(ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+
+    std::vector<GLuint> unsignedIndices(indices.begin(), indices.end());
+    std::vector<GLint> offsets(memberCount), matrixStrides(memberCount);
+    glGetActiveUniformsiv(ID, memberCount, unsignedIndices.data(), GL_UNIFORM_OFFSET, offsets.data());
+    glGetActiveUniformsiv(ID, memberCount, unsignedIndices.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+
+    for (int i = 0; i < memberCount; ++i) {
+        char memberName[256];
+        glGetActiveUniformName(ID, unsignedIndices[i], sizeof(memberName), nullptr, memberName);
+        MaterialBlockMembers[memberName] = {offsets[i], matrixStrides[i]};
+    }
+}
+
+int Engine::Shader::GetMaterialBlockSize() const {
+    return MaterialBlockSize;
+}
+
+const Engine::Shader::BlockMember *Engine::Shader::FindMaterialBlockMember(const std::string &name) const {
+    auto it = MaterialBlockMembers.find(name);
+    return (it != MaterialBlockMembers.end()) ? &it->second : nullptr;
+}
+
+bool Engine::Shader::IsCompiling() const {
+    return Status == CompileStatus::Compiling;
+}
+
+void Engine::Shader::EnableParallelCompile(GLADloadproc loader) {
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+    for (GLint i = 0; i < extensionCount; ++i) {
+        const char *extension = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        bool khr = std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0;
+        bool arb = std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0;
+        if (!khr && !arb) {
+            continue;
+        }
+
+        // Let the driver pick as many compiler threads as it likes
+        using MaxThreadsProc = void (APIENTRYP)(GLuint);
+        MaxThreadsProc maxThreads = reinterpret_cast<MaxThreadsProc>(loader(khr ? "glMaxShaderCompilerThreadsKHR" : "glMaxShaderCompilerThreadsARB"));
+        if (maxThreads) {
+            maxThreads(0xFFFFFFFF);
+        }
+        ParallelCompile = true;
+        std::cout << "Parallel shader compilation enabled (" << extension << ")" << std::endl;
+        return;
+    }
+
+    std::cout << "Parallel shader compilation unavailable, programs finish on first use" << std::endl;
+}
+
+bool Engine::Shader::IsParallelCompileEnabled() {
+    return ParallelCompile;
 }
 
 std::string Engine::Shader::LoadShaderSource(const std::string &filePath) {
-    std::filesystem::path fullPath = std::filesystem::path(Util::GetExecutablePath()) / filePath;
+    std::filesystem::path fullPath = Util::GetAssetPath(filePath);
     std::ifstream file(fullPath);
     
     if (!file) {
@@ -110,6 +239,64 @@ std::string Engine::Shader::LoadShaderSource(const std::string &filePath) {
     return source;
 }
 
+std::string Engine::Shader::ExpandIncludes(const std::filesystem::path &filePath, std::unordered_set<std::string> &included, int depth) {
+    if (depth > 16) {
+        std::cerr << "Shader include depth exceeded at: " << filePath << std::endl;
+        return "";
+    }
+
+    std::string source = LoadShaderSource(filePath.string());
+    std::stringstream input(source);
+    std::stringstream output;
+    std::string line;
+    int lineNumber = 0;
+
+    while (std::getline(input, line)) {
+        ++lineNumber;
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            output << line << "\n";
+            continue;
+        }
+
+        size_t open = line.find('"', start);
+        size_t close = (open == std::string::npos) ? open : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cerr << "Malformed #include in " << filePath << " line " << lineNumber << std::endl;
+            continue;
+        }
+
+        // Every file is included at most once, like #pragma once
+        std::filesystem::path includePath = (filePath.parent_path() / line.substr(open + 1, close - open - 1)).lexically_normal();
+        if (included.insert(includePath.generic_string()).second) {
+            output << "#line 1\n" << ExpandIncludes(includePath, included, depth + 1);
+        }
+        output << "#line " << lineNumber + 1 << "\n";
+    }
+
+    return output.str();
+}
+
+std::string Engine::Shader::PreprocessSource(const std::string &filePath, const std::vector<std::string> &defines) {
+    std::unordered_set<std::string> included = { std::filesystem::path(filePath).lexically_normal().generic_string() };
+    std::string source = ExpandIncludes(filePath, included, 0);
+
+    // Defines must follow the #version directive
+    size_t versionLine = source.find("#version");
+    size_t insertAt = (versionLine == std::string::npos) ? 0 : source.find('\n', versionLine);
+    insertAt = (insertAt == std::string::npos) ? source.size() : insertAt + 1;
+
+    std::string defineBlock;
+    for (const std::string &define : defines) {
+        defineBlock += "#define " + define + "\n";
+    }
+    if (!defineBlock.empty()) {
+        int versionLineNumber = static_cast<int>(std::count(source.begin(), source.begin() + insertAt, '\n'));
+        defineBlock += "#line " + std::to_string(versionLineNumber + 1) + "\n";
+        source.insert(insertAt, defineBlock);
+    }
+    return source;
+}
 
 int Engine::Shader::GetUniformLocation(const std::string &name) {
     if (ID == 0) {
@@ -122,12 +309,12 @@ int Engine::Shader::GetUniformLocation(const std::string &name) {
         return it->second;
     }
 
+    // Missing uniforms are cached too, variants compile out unused ones and should only warn once
     int location = glGetUniformLocation(ID, name.c_str());
     if (location == -1) {
         std::cerr << "Warning: Uniform '" << name << "' not found in shader program " << ID << "!" << std::endl;
-    } else {
-        UniformCache[name] = location;
     }
+    UniformCache[name] = location;
 
     return location;
 }
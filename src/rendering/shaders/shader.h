@@ -8,10 +8,20 @@
 #include <sstream>
 #include <iostream>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <filesystem>
+#include <chrono>
 #include <glad/glad.h>
 #include "../../util/util.h"
+#include "shader_cache.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstring>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 
 namespace Engine
@@ -20,14 +30,39 @@ namespace Engine
     {
     public:
         unsigned int ID;
+        // Material whose uniform values were last applied to this program, shared variants re-apply on change
+        const void *UniformOwner = nullptr;
 
-        Shader(const std::string &vertexPath, const std::string &fragmentPath);
+        // Defines are injected after #version, #include "file" is resolved relative to the including file
+        Shader(const std::string &vertexPath, const std::string &fragmentPath, const std::vector<std::string> &defines = {});
         ~Shader();
+        Shader(const Shader &) = delete;
+        Shader &operator=(const Shader &) = delete;
 
         void Bind() const;
         void Unbind() const;
         void Unload();
 
+        // Programs are compiled and linked asynchronously, IsReady() collects the result without blocking
+        // when the driver supports parallel compilation and finalizes the program on the first true
+        bool IsReady();
+        bool IsCompiling() const;
+
+        static void EnableParallelCompile(GLADloadproc loader);
+        static bool IsParallelCompileEnabled();
+
+        // std140 "MaterialParams" block, bound to MaterialBlockBinding and reflected once the program is ready
+        struct BlockMember
+        {
+            int Offset;
+            int MatrixStride;
+        };
+        static constexpr unsigned int MaterialBlockBinding = 0;
+        // Per-draw transforms written by CommandList
+        static constexpr unsigned int DrawBlockBinding = 1;
+        int GetMaterialBlockSize() const;
+        const BlockMember *FindMaterialBlockMember(const std::string &name) const;
+
         int GetUniformLocation(const std::string &name);
 
         // Set Uniforms
@@ -40,7 +75,20 @@ namespace Engine
         void ListUniforms();
 
     private:
+        enum class CompileStatus { Compiling, Ready, Failed };
+
         std::unordered_map<std::string, int> UniformCache;
+        CompileStatus Status = CompileStatus::Failed;
+        unsigned int VertexShaderId = 0;
+        unsigned int FragmentShaderId = 0;
+        uint64_t CacheKey = 0;
+        double BlockingSeconds = 0.0; // Time spent blocked in compile and link calls, not since submission
+
+        static bool ParallelCompile;
+
+        int MaterialBlockSize = 0;
+        std::unordered_map<std::string, BlockMember> MaterialBlockMembers;
+        void ReflectUniformBlocks();
 
         unsigned int CreateShader(unsigned int shaderType, const std::string &shaderSource);
         bool CompileShader(unsigned int shaderId);
@@ -48,6 +96,8 @@ namespace Engine
         bool LinkProgram(unsigned int programId);
 
         std::string LoadShaderSource(const std::string &filePath);
+        std::string PreprocessSource(const std::string &filePath, const std::vector<std::string> &defines);
+        std::string ExpandIncludes(const std::filesystem::path &filePath, std::unordered_set<std::string> &included, int depth);
     };
 };
 #endif
\ No newline at end of file
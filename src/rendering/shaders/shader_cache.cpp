@@ -0,0 +1,179 @@
+#include "shader_cache.h"
+
+namespace
+{
+    constexpr uint32_t CacheMagic = 0x43474F45; // "EOGC"
+    constexpr uint32_t CacheFormatVersion = 1;
+
+    struct CacheHeader
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t BinaryFormat;
+        uint32_t BinaryLength;
+        double BlockingSeconds;
+    };
+
+    uint64_t HashBytes(uint64_t Hash, const char *Data, size_t Length)
+    {
+        // FNV-1a, with a separator so "ab"+"c" and "a"+"bc" hash differently
+        for (size_t i = 0; i < Length; ++i)
+        {
+            Hash ^= static_cast<unsigned char>(Data[i]);
+            Hash *= 0x100000001B3ull;
+        }
+        Hash ^= 0xFF;
+        Hash *= 0x100000001B3ull;
+        return Hash;
+    }
+
+    uint64_t HashString(uint64_t Hash, const char *Text)
+    {
+        return HashBytes(Hash, Text ? Text : "", Text ? std::strlen(Text) : 0);
+    }
+}
+
+bool Engine::ShaderCache::Enabled = true;
+int Engine::ShaderCache::Supported = -1;
+Engine::ShaderCache::Statistics Engine::ShaderCache::Stats;
+
+uint64_t Engine::ShaderCache::ComputeKey(const std::string &VertexSource, const std::string &FragmentSource, const std::string &Defines)
+{
+    uint64_t Hash = 0xCBF29CE484222325ull;
+    Hash = HashBytes(Hash, VertexSource.data(), VertexSource.size());
+    Hash = HashBytes(Hash, FragmentSource.data(), FragmentSource.size());
+    Hash = HashBytes(Hash, Defines.data(), Defines.size());
+    Hash = HashString(Hash, reinterpret_cast<const char *>(glGetString(GL_VENDOR)));
+    Hash = HashString(Hash, reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+    Hash = HashString(Hash, reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+    return Hash;
+}
+
+bool Engine::ShaderCache::CheckSupport()
+{
+    if (Supported < 0)
+    {
+        GLint FormatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &FormatCount);
+        Supported = (glProgramBinary && glGetProgramBinary && FormatCount > 0) ? 1 : 0;
+        if (!Supported)
+            std::cout << "ShaderCache: Driver exposes no program binary formats, cache disabled" << std::endl;
+    }
+    return Enabled && Supported;
+}
+
+std::filesystem::path Engine::ShaderCache::GetCachePath(uint64_t Key)
+{
+    char Name[32];
+    std::snprintf(Name, sizeof(Name), "%016llx.bin", static_cast<unsigned long long>(Key));
+    return std::filesystem::path(Util::GetExecutablePath()) / "ShaderCache" / Name;
+}
+
+unsigned int Engine::ShaderCache::Load(uint64_t Key)
+{
+    if (!CheckSupport())
+        return 0;
+
+    auto Start = std::chrono::steady_clock::now();
+    std::filesystem::path CachePath = GetCachePath(Key);
+    std::ifstream File(CachePath, std::ios::binary | std::ios::ate);
+    if (!File)
+        return 0;
+
+    // The header is checked and the length bounded by the file size before anything is allocated, so a
+    // truncated or garbage file can never request a huge buffer
+    std::streamoff FileSize = File.tellg();
+    File.seekg(0);
+    CacheHeader Header = {};
+    File.read(reinterpret_cast<char *>(&Header), sizeof(Header));
+    bool Valid = File && Header.Magic == CacheMagic && Header.Version == CacheFormatVersion && Header.BinaryLength > 0 &&
+                 Header.BinaryLength <= FileSize - static_cast<std::streamoff>(sizeof(Header));
+    std::vector<char> Binary(Valid ? Header.BinaryLength : 0);
+    if (Valid)
+        Valid = static_cast<bool>(File.read(Binary.data(), Binary.size()));
+    File.close();
+
+    if (!Valid)
+    {
+        std::cout << "ShaderCache: Corrupt cache entry " << CachePath.filename() << ", rebuilding" << std::endl;
+        std::error_code Error;
+        std::filesystem::remove(CachePath, Error);
+        ++Stats.Corrupt;
+        return 0;
+    }
+
+    unsigned int ProgramID = glCreateProgram();
+    glProgramBinary(ProgramID, Header.BinaryFormat, Binary.data(), static_cast<GLsizei>(Binary.size()));
+
+    int Status = 0;
+    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Status);
+    if (!Status)
+    {
+        // Stale entry from another driver, drop it so the rebuilt program replaces it
+        std::cout << "ShaderCache: Driver rejected cached binary " << CachePath.filename() << ", rebuilding" << std::endl;
+        glDeleteProgram(ProgramID);
+        std::error_code Error;
+        std::filesystem::remove(CachePath, Error);
+        ++Stats.Rejected;
+        return 0;
+    }
+
+    ++Stats.Hits;
+    Stats.LoadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+    Stats.SavedSeconds += Header.BlockingSeconds;
+    return ProgramID;
+}
+
+void Engine::ShaderCache::RecordMiss(double BlockingSeconds)
+{
+    ++Stats.Misses;
+    Stats.BlockingSeconds += BlockingSeconds;
+}
+
+void Engine::ShaderCache::Store(uint64_t Key, unsigned int ProgramID, double BlockingSeconds)
+{
+    if (ProgramID == 0 || !CheckSupport())
+        return;
+
+    GLint Length = 0;
+    glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &Length);
+    if (Length <= 0)
+        return;
+
+    std::vector<char> Binary(Length);
+    GLenum Format = 0;
+    glGetProgramBinary(ProgramID, Length, &Length, &Format, Binary.data());
+
+    std::filesystem::path CachePath = GetCachePath(Key);
+    std::error_code Error;
+    std::filesystem::create_directories(CachePath.parent_path(), Error);
+
+    std::ofstream File(CachePath, std::ios::binary | std::ios::trunc);
+    if (!File)
+    {
+        std::cerr << "ShaderCache: Failed to write " << CachePath << std::endl;
+        return;
+    }
+
+    CacheHeader Header = {CacheMagic, CacheFormatVersion, Format, static_cast<uint32_t>(Length), BlockingSeconds};
+    File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+    File.write(Binary.data(), Length);
+}
+
+void Engine::ShaderCache::SetEnabled(bool Enable)
+{
+    Enabled = Enable;
+}
+
+bool Engine::ShaderCache::IsEnabled()
+{
+    return Enabled;
+}
+
+void Engine::ShaderCache::LogStatistics()
+{
+    double SavedMilliseconds = (Stats.SavedSeconds - Stats.LoadSeconds) * 1000.0;
+    std::cout << "ShaderCache: " << Stats.Hits << " hits, " << Stats.Misses << " misses, " << Stats.Rejected << " rejected, " << Stats.Corrupt << " corrupt"
+              << " | blocked compiling for " << Stats.BlockingSeconds * 1000.0 << " ms"
+              << " | loaded in " << Stats.LoadSeconds * 1000.0 << " ms, saving " << SavedMilliseconds << " ms of blocking" << std::endl;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#ifndef shader_cache_h
+#define shader_cache_h
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <glad/glad.h>
+#include "../../util/util.h"
+
+namespace Engine
+{
+    // On-disk cache of linked program binaries. Entries are keyed by a hash of the preprocessed sources,
+    // the defines and the driver's vendor, renderer and version strings, so a driver update or a shader
+    // edit simply misses. Binaries the driver rejects are deleted and the caller rebuilds from source.
+    class ShaderCache
+    {
+    public:
+        static uint64_t ComputeKey(const std::string &VertexSource, const std::string &FragmentSource, const std::string &Defines);
+
+        // Returns a linked program, or 0 on a miss or when the driver rejects the stored binary
+        static unsigned int Load(uint64_t Key);
+        static void Store(uint64_t Key, unsigned int ProgramID, double BlockingSeconds);
+        static void RecordMiss(double BlockingSeconds);
+
+        static void SetEnabled(bool Enabled);
+        static bool IsEnabled();
+        static void LogStatistics();
+
+    private:
+        struct Statistics
+        {
+            unsigned int Hits = 0;
+            unsigned int Misses = 0;
+            unsigned int Rejected = 0;
+            unsigned int Corrupt = 0;
+            // Only time the caller spent blocked in compile and link calls, which stays near zero where
+            // KHR_parallel_shader_compile moves the work to driver threads
+            double BlockingSeconds = 0.0; // Blocked compiling on misses
+            double LoadSeconds = 0.0;    // Time spent loading binaries on hits
+            double SavedSeconds = 0.0;   // Original blocking time of every binary that was loaded
+        };
+
+        static bool Enabled;
+        static int Supported;
+        static Statistics Stats;
+
+        static bool CheckSupport();
+        static std::filesystem::path GetCachePath(uint64_t Key);
+    };
+};
+
+#endif
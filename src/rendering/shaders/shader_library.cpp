@@ -0,0 +1,90 @@
+#include "shader_library.h"
+
+std::vector<std::string> Engine::ShaderLibrary::Keywords;
+std::unordered_map<std::string, std::shared_ptr<Engine::Shader>> Engine::ShaderLibrary::Variants;
+
+Engine::ShaderLibrary::KeywordMask Engine::ShaderLibrary::GetKeywordMask(const std::string &Keyword)
+{
+    for (size_t i = 0; i < Keywords.size(); ++i)
+    {
+        if (Keywords[i] == Keyword)
+            return KeywordMask(1) << i;
+    }
+
+    if (Keywords.size() >= sizeof(KeywordMask) * 8)
+    {
+        std::cerr << "ShaderLibrary: Too many shader keywords, ignoring " << Keyword << std::endl;
+        return 0;
+    }
+
+    Keywords.push_back(Keyword);
+    return KeywordMask(1) << (Keywords.size() - 1);
+}
+
+std::vector<std::string> Engine::ShaderLibrary::GetDefines(KeywordMask Mask)
+{
+    std::vector<std::string> Defines;
+    for (size_t i = 0; i < Keywords.size(); ++i)
+    {
+        if (Mask & (KeywordMask(1) << i))
+            Defines.push_back(Keywords[i]);
+    }
+    return Defines;
+}
+
+std::shared_ptr<Engine::Shader> Engine::ShaderLibrary::GetVariant(const std::string &VertexPath, const std::string &FragmentPath, KeywordMask Mask)
+{
+    std::string Key = VertexPath + "|" + FragmentPath + "|" + std::to_string(Mask);
+    auto It = Variants.find(Key);
+    if (It != Variants.end())
+        return It->second;
+
+    std::vector<std::string> Defines = GetDefines(Mask);
+    std::cout << "ShaderLibrary: Compiling " << FragmentPath << " variant [";
+    for (size_t i = 0; i < Defines.size(); ++i)
+        std::cout << (i ? " " : "") << Defines[i];
+    std::cout << "]" << std::endl;
+
+    std::shared_ptr<Shader> Variant = std::make_shared<Shader>(VertexPath, FragmentPath, Defines);
+    Variants.emplace(Key, Variant);
+    return Variant;
+}
+
+void Engine::ShaderLibrary::ReleaseUnused()
+{
+    for (auto It = Variants.begin(); It != Variants.end();)
+    {
+        if (It->second.use_count() == 1)
+            It = Variants.erase(It);
+        else
+            ++It;
+    }
+}
+
+void Engine::ShaderLibrary::Release()
+{
+    Variants.clear();
+}
+
+size_t Engine::ShaderLibrary::GetVariantCount()
+{
+    return Variants.size();
+}
+
+size_t Engine::ShaderLibrary::PollPending()
+{
+    size_t Pending = 0;
+    for (auto &[Key, Variant] : Variants)
+    {
+        Variant->IsReady();
+        if (Variant->IsCompiling())
+            ++Pending;
+    }
+    return Pending;
+}
+
+void Engine::ShaderLibrary::WaitForAll()
+{
+    while (PollPending() > 0)
+        std::this_thread::yield();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifndef shader_library_h
+#define shader_library_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include <thread>
+#include "shader.h"
+
+namespace Engine
+{
+    // Compiles shader permutations on demand. Materials declare feature keywords, every keyword maps to one
+    // bit, and each (vertex, fragment, keyword mask) variant is compiled once with the keywords as #defines
+    // and shared by all materials that use it.
+    class ShaderLibrary
+    {
+    public:
+        using KeywordMask = uint32_t;
+
+        static KeywordMask GetKeywordMask(const std::string &Keyword);
+        static std::vector<std::string> GetDefines(KeywordMask Mask);
+
+        static std::shared_ptr<Shader> GetVariant(const std::string &VertexPath, const std::string &FragmentPath, KeywordMask Mask);
+        // Drops variants no material references anymore
+        static void ReleaseUnused();
+        // Drops every cached variant, call while the GL context is still current
+        static void Release();
+        static size_t GetVariantCount();
+        // Finalizes variants whose compile finished, returns how many are still compiling
+        static size_t PollPending();
+        // Blocks until every submitted variant is linked, for loading screens and benchmarks
+        static void WaitForAll();
+
+    private:
+        static std::vector<std::string> Keywords;
+        static std::unordered_map<std::string, std::shared_ptr<Shader>> Variants;
+    };
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "cascaded_shadows.h"
+
+Engine::CascadedShadows::CascadedShadows(const Settings &Options)
+    : Options(Options)
+{
+    this->Options.CascadeCount = std::clamp(Options.CascadeCount, 1, MaxCascades);
+    this->Options.Resolution = std::max(Options.Resolution, 64);
+    for (glm::mat4 &Cached : CachedViewProjection)
+        Cached = glm::mat4(0.0f);
+
+    DepthMaterial = new Material("Assets/Shaders/Shadows/Vert.glsl", "Assets/Shaders/Shadows/Frag.glsl");
+    DepthMaterial->SetCullingMode(Material::CullingMode::None);
+    DepthMaterial->Compile();
+}
+
+Engine::CascadedShadows::~CascadedShadows()
+{
+    for (GLuint *Texture : {&StaticAtlas, &CompositeAtlas})
+    {
+        if (*Texture == 0)
+            continue;
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Texture, *Texture);
+        glDeleteTextures(1, Texture);
+    }
+    for (GLuint *Framebuffer : {&StaticFramebuffer, &CompositeFramebuffer})
+    {
+        if (*Framebuffer != 0)
+            glDeleteFramebuffers(1, Framebuffer);
+    }
+    delete DepthMaterial;
+}
+
+void Engine::CascadedShadows::Prepare(const Camera &View, const glm::vec3 &LightDirection, const std::vector<Model::InstanceRef> &Instances, Frame &Out)
+{
+    ENGINE_PROFILE_FUNCTION();
+    Out.CascadeCount = Options.CascadeCount;
+    Out.Enabled = glm::dot(LightDirection, LightDirection) > 0.0f;
+    Out.HasDynamic = false;
+    if (!Out.Enabled)
+        return;
+
+    if (RefreshFailed.exchange(false))
+        StaticValid = false;
+
+    // Planes and slopes come straight from the projection, values recovered through an inverted view
+    // projection pick up rounding noise as the camera turns, which would be enough to invalidate the cache
+    glm::mat4 Projection = View.GetProjectionMatrix();
+    bool Perspective = Projection[3][3] == 0.0f;
+    float NearDistance = Perspective ? Projection[3][2] / (Projection[2][2] - 1.0f) : (Projection[3][2] + 1.0f) / Projection[2][2];
+    float FarDistance = Perspective ? Projection[3][2] / (Projection[2][2] + 1.0f) : (Projection[3][2] - 1.0f) / Projection[2][2];
+    NearDistance = std::max(NearDistance, 0.01f);
+    float ShadowDistance = std::max(std::min(FarDistance, Options.MaxDistance), NearDistance * 2.0f);
+    float SlopeX = 1.0f / Projection[0][0], SlopeY = 1.0f / Projection[1][1];
+
+    glm::vec3 Direction = glm::normalize(LightDirection);
+    glm::vec3 Up = (std::abs(Direction.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 LightView = glm::lookAt(glm::vec3(0.0f), Direction, Up);
+
+    for (const Model::InstanceRef &Ref : Instances)
+    {
+        if (Ref.Dynamic)
+        {
+            Out.HasDynamic = true;
+            break;
+        }
+    }
+
+    for (int Index = 0; Index < Out.CascadeCount; ++Index)
+    {
+        float Fraction = static_cast<float>(Index + 1) / Out.CascadeCount;
+        float Logarithmic = NearDistance * std::pow(ShadowDistance / NearDistance, Fraction);
+        float Uniform = NearDistance + (ShadowDistance - NearDistance) * Fraction;
+        float SliceEnd = Uniform + (Logarithmic - Uniform) * Options.SplitLambda;
+
+        // Sphere around the camera reaching the far corners of the slice. A sphere fitted tightly to the
+        // slice would be sharper, but it swings around with the view and a turning camera would then
+        // invalidate the static cache every frame, this one only moves when the camera does
+        glm::vec3 Center = View.GetPosition();
+        float Radius = Perspective ? SliceEnd * std::sqrt(SlopeX * SlopeX + SlopeY * SlopeY + 1.0f)
+                                   : std::sqrt(SlopeX * SlopeX + SlopeY * SlopeY + SliceEnd * SliceEnd);
+        Radius = std::ceil(Radius * 16.0f) / 16.0f;
+
+        // The tile covers a little more than the sphere, enough for the center to move in steps of whole
+        // texels that are large enough for the static cache to survive small camera moves
+        float HalfExtent = Radius * 1.0625f;
+        float TexelSize = 2.0f * HalfExtent / Options.Resolution;
+        float Step = TexelSize * std::max(1.0f, std::floor(Radius * 0.125f / TexelSize));
+        glm::vec3 LightCenter = glm::floor(glm::vec3(LightView * glm::vec4(Center, 1.0f)) / Step + 0.5f) * Step;
+
+        Cascade &Target = Out.Cascades[Index];
+        Target.View = LightView;
+        Target.Projection = glm::ortho(LightCenter.x - HalfExtent, LightCenter.x + HalfExtent,
+                                       LightCenter.y - HalfExtent, LightCenter.y + HalfExtent,
+                                       -(LightCenter.z + HalfExtent + Options.CasterDistance), -(LightCenter.z - HalfExtent));
+        Target.TexelSize = TexelSize;
+
+        glm::mat4 ViewProjection = Target.Projection * Target.View;
+        Target.RefreshStatic = !StaticValid || ViewProjection != CachedViewProjection[Index];
+        if (Target.RefreshStatic)
+        {
+            Model::RecordDepthPass(Instances, Target.View, Target.Projection, Model::DepthCasters::Static, DepthMaterial, Target.StaticCommands);
+            CachedViewProjection[Index] = ViewProjection;
+        }
+
+        if (Out.HasDynamic)
+            Model::RecordDepthPass(Instances, Target.View, Target.Projection, Model::DepthCasters::Dynamic, DepthMaterial, Target.DynamicCommands);
+    }
+    StaticValid = true;
+}
+
+void Engine::CascadedShadows::InvalidateStatic()
+{
+    StaticValid = false;
+}
+
+void Engine::CascadedShadows::CreateAtlas(GLuint &Texture, GLuint &Framebuffer)
+{
+    int Size = Options.Resolution * 2;
+    glGenTextures(1, &Texture);
+    glBindTexture(GL_TEXTURE_2D, Texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, Size, Size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Hardware depth comparison, linear filtering then gives 2x2 PCF per tap
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, Texture, MemoryTracker::GpuOwner::Shadows,
+                            MemoryTracker::GetTextureSize(GL_DEPTH_COMPONENT24, Size, Size));
+
+    glGenFramebuffers(1, &Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, Texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "CascadedShadows: Shadow atlas framebuffer is not complete" << std::endl;
+}
+
+void Engine::CascadedShadows::BeginTile(int CascadeIndex)
+{
+    int X = (CascadeIndex % 2) * Options.Resolution;
+    int Y = (CascadeIndex / 2) * Options.Resolution;
+    glViewport(X, Y, Options.Resolution, Options.Resolution);
+    glScissor(X, Y, Options.Resolution, Options.Resolution);
+}
+
+void Engine::CascadedShadows::Render(const Frame &Shadows)
+{
+    if (!Shadows.Enabled)
+        return;
+
+    ENGINE_PROFILE_GPU_SCOPE("Shadows");
+    if (StaticAtlas == 0)
+        CreateAtlas(StaticAtlas, StaticFramebuffer);
+    if (Shadows.HasDynamic && CompositeAtlas == 0)
+        CreateAtlas(CompositeAtlas, CompositeFramebuffer);
+
+    bool AnyRefresh = false;
+    for (int Index = 0; Index < Shadows.CascadeCount; ++Index)
+        AnyRefresh |= Shadows.Cascades[Index].RefreshStatic;
+
+    // Nothing may be cached while the depth program is still compiling, have the simulation ask again
+    if (!DepthMaterial->IsReady())
+    {
+        if (AnyRefresh)
+            RefreshFailed = true;
+        for (bool &Valid : TileValid)
+            Valid = false;
+        return;
+    }
+
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glDepthMask(GL_TRUE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, StaticFramebuffer);
+    for (int Index = 0; Index < Shadows.CascadeCount; ++Index)
+    {
+        const Cascade &Source = Shadows.Cascades[Index];
+        if (!Source.RefreshStatic)
+            continue;
+
+        BeginTile(Index);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        CommandList::Execute(Source.StaticCommands);
+        TileValid[Index] = true;
+        StaticRefreshes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Dynamic casters go on top of a copy of the cached depth, the cache itself stays untouched
+    UseComposite = Shadows.HasDynamic;
+    if (UseComposite)
+    {
+        int Size = Options.Resolution * 2;
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, StaticFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, CompositeFramebuffer);
+        glBlitFramebuffer(0, 0, Size, Size, 0, 0, Size, Size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glEnable(GL_SCISSOR_TEST);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, CompositeFramebuffer);
+        for (int Index = 0; Index < Shadows.CascadeCount; ++Index)
+        {
+            BeginTile(Index);
+            CommandList::Execute(Shadows.Cascades[Index].DynamicCommands);
+        }
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Engine::CascadedShadows::Apply(Material *Lighting, int TextureUnit, const Frame &Shadows)
+{
+    static const std::string MapUniform = "ShadowMap";
+    static const std::string CountUniform = "NumShadowCascades";
+    static const std::string TexelUniform = "ShadowTexelSizes";
+    static const std::string AtlasTexelUniform = "ShadowAtlasTexel";
+    static const std::string MatrixUniforms[MaxCascades] = {"ShadowMatrices[0]", "ShadowMatrices[1]", "ShadowMatrices[2]", "ShadowMatrices[3]"};
+
+    // The sampler is always pointed at its own unit, a shadow sampler left on unit 0 would clash with the albedo
+    Lighting->SetTexture(TextureUnit, UseComposite ? CompositeAtlas : StaticAtlas);
+    Lighting->SetUniform(MapUniform, TextureUnit);
+
+    int Count = Shadows.Enabled ? Shadows.CascadeCount : 0;
+    for (int Index = 0; Index < Count; ++Index)
+    {
+        if (!TileValid[Index])
+            Count = 0;
+    }
+    Lighting->SetUniform(CountUniform, Count);
+    if (Count == 0)
+        return;
+
+    // Clip space to [0, 1] texture space of the cascade, the shader offsets it into the cascade's tile
+    const glm::mat4 Bias = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+    glm::vec4 TexelSizes(0.0f);
+    for (int Index = 0; Index < Count; ++Index)
+    {
+        const Cascade &Source = Shadows.Cascades[Index];
+        Lighting->SetUniform(MatrixUniforms[Index], Bias * Source.Projection * Source.View);
+        TexelSizes[Index] = Source.TexelSize;
+    }
+    Lighting->SetUniform(TexelUniform, TexelSizes);
+    Lighting->SetUniform(AtlasTexelUniform, 1.0f / (Options.Resolution * 2));
+}
+
+uint64_t Engine::CascadedShadows::GetStaticRefreshCount() const
+{
+    return StaticRefreshes.load(std::memory_order_relaxed);
+}
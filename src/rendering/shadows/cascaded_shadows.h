@@ -0,0 +1,110 @@
+#pragma once
+
+#ifndef cascaded_shadows_h
+#define cascaded_shadows_h
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../camera/camera.h"
+#include "../model/model.h"
+#include "../materials/material.h"
+#include "../commands/command_list.h"
+#include "../../core/memory/memory_tracker.h"
+#include "../../core/profiler/profiler.h"
+
+namespace Engine
+{
+    // Cascaded shadow maps for the sun, packed as 2x2 tiles of one depth atlas. Each cascade is a sphere
+    // around the camera reaching the end of its slice of the view frustum, snapped to a grid in light space
+    // that is a whole number of texels, so it keeps its size while the camera turns and only moves in steps. Static casters are rendered into a
+    // cached atlas that is only redrawn per cascade when its light space bounds change, dynamic casters are
+    // drawn every frame on top of a copy of it.
+    //
+    // Prepare runs on the simulation thread and records everything the frame needs into a Frame, Render and
+    // Apply run on the GL thread. Each side only touches its own members.
+    class CascadedShadows
+    {
+    public:
+        static constexpr int MaxCascades = 4;
+
+        struct Settings
+        {
+            int CascadeCount = 4;
+            // Size of one cascade tile, the atlas is twice as wide and high
+            int Resolution = 1024;
+            // View distance covered by the last cascade, capped by the camera's far plane
+            float MaxDistance = 150.0f;
+            // Blend between logarithmic (1) and uniform (0) split distances
+            float SplitLambda = 0.75f;
+            // How far towards the light casters outside a cascade are still caught
+            float CasterDistance = 500.0f;
+        };
+
+        struct Cascade
+        {
+            glm::mat4 View = glm::mat4(1.0f);
+            glm::mat4 Projection = glm::mat4(1.0f);
+            // World size of one texel, scales the normal offset in the lighting shader
+            float TexelSize = 0.0f;
+            bool RefreshStatic = false;
+            std::vector<CommandList> StaticCommands;
+            std::vector<CommandList> DynamicCommands;
+        };
+
+        // The shadow work of one frame, part of the frame snapshot
+        struct Frame
+        {
+            bool Enabled = false;
+            int CascadeCount = 0;
+            bool HasDynamic = false;
+            Cascade Cascades[MaxCascades];
+        };
+
+        CascadedShadows(const Settings &Options);
+        ~CascadedShadows();
+
+        // Simulation thread. Fits the cascades to View, records the static casters of cascades whose bounds
+        // changed and the dynamic casters of every cascade
+        void Prepare(const Camera &View, const glm::vec3 &LightDirection, const std::vector<Model::InstanceRef> &Instances, Frame &Out);
+        // Simulation thread. Forces every cascade to redraw its static casters, e.g. after the scene changed
+        void InvalidateStatic();
+
+        // GL thread. Refreshes the cached tiles the frame asks for and composites the dynamic casters
+        void Render(const Frame &Shadows);
+        // GL thread. Binds the atlas to TextureUnit of the lighting material and sets its shadow uniforms
+        void Apply(Material *Lighting, int TextureUnit, const Frame &Shadows);
+
+        // Cascade tiles whose static casters were redrawn since startup
+        uint64_t GetStaticRefreshCount() const;
+
+    private:
+        Settings Options;
+
+        // Simulation thread
+        glm::mat4 CachedViewProjection[MaxCascades];
+        bool StaticValid = false;
+
+        // GL thread
+        Material *DepthMaterial = nullptr;
+        GLuint StaticAtlas = 0, CompositeAtlas = 0;
+        GLuint StaticFramebuffer = 0, CompositeFramebuffer = 0;
+        bool UseComposite = false;
+        bool TileValid[MaxCascades] = {};
+
+        // Set by the GL thread when a requested refresh could not be drawn, the next Prepare redraws everything
+        std::atomic<bool> RefreshFailed{false};
+        std::atomic<uint64_t> StaticRefreshes{0};
+
+        void CreateAtlas(GLuint &Texture, GLuint &Framebuffer);
+        void BeginTile(int CascadeIndex);
+    };
+};
+
+#endif
@@ -0,0 +1,638 @@
+#include "local_shadow_atlas.h"
+
+namespace
+{
+    // Cube face axes, the lighting shader picks faces and projects onto them with the same table
+    const glm::vec3 FaceForward[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+    const glm::vec3 FaceUp[6] = {{0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0}};
+
+    // Texels kept free at every tile edge, so filtering near a frustum edge never reads the neighbouring tile
+    constexpr int GuardTexels = 2;
+    constexpr float MaxSpotAngle = glm::radians(80.0f);
+
+    float GetRange(const Engine::Light &Source, float MinLightLevel)
+    {
+        float Brightness = Source.Intensity * std::max(Source.Color.r, std::max(Source.Color.g, Source.Color.b));
+        return std::sqrt(std::max(Brightness, 0.0f) / MinLightLevel);
+    }
+
+    float GetNear(float Range)
+    {
+        return std::max(0.05f, Range * 0.001f);
+    }
+
+    // Tangent of the half angle a tile covers once the guard band is added
+    float GetTanHalfAngle(float ConeAngle, int TileSize)
+    {
+        return std::tan(ConeAngle) * TileSize / (TileSize - 2.0f * GuardTexels);
+    }
+
+    float GetSpotAngle(float OuterCutOff)
+    {
+        return std::min(std::acos(std::clamp(OuterCutOff, -1.0f, 1.0f)), MaxSpotAngle);
+    }
+
+    glm::mat4 GetSpotView(const glm::vec3 &Position, const glm::vec3 &Direction)
+    {
+        glm::vec3 Forward = glm::normalize(Direction);
+        glm::vec3 Up = (std::abs(Forward.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::lookAt(Position, Position + Forward, Up);
+    }
+
+    // Maps the [-1, 1] clip square onto the tile in [0, 1] atlas texture space
+    glm::mat4 GetTileTransform(const glm::ivec2 &Tile, int TileSize, int AtlasSize)
+    {
+        glm::vec2 Offset = glm::vec2(Tile) / static_cast<float>(AtlasSize);
+        float Scale = static_cast<float>(TileSize) / AtlasSize;
+        glm::mat4 Result = glm::translate(glm::mat4(1.0f), glm::vec3(Offset + Scale * 0.5f, 0.5f));
+        return glm::scale(Result, glm::vec3(Scale * 0.5f, Scale * 0.5f, 0.5f));
+    }
+
+    bool IsSphereVisible(const glm::vec4 (&Planes)[6], const glm::vec3 &Center, float Radius)
+    {
+        for (const glm::vec4 &Plane : Planes)
+        {
+            if (glm::dot(glm::vec3(Plane), Center) + Plane.w < -Radius * glm::length(glm::vec3(Plane)))
+                return false;
+        }
+        return true;
+    }
+
+    std::vector<std::string> MakeUniformNames(const std::string &Name, int Count)
+    {
+        std::vector<std::string> Names;
+        for (int i = 0; i < Count; ++i)
+            Names.push_back(Name + "[" + std::to_string(i) + "]");
+        return Names;
+    }
+}
+
+Engine::LocalShadowAtlas::LocalShadowAtlas(const Settings &Options)
+    : Options(Options)
+{
+    // Sizes are powers of two so that every tile splits evenly down to the smallest one
+    auto FloorPowerOfTwo = [](int Value)
+    {
+        int Result = 1;
+        while (Result * 2 <= Value)
+            Result *= 2;
+        return Result;
+    };
+    this->Options.AtlasSize = FloorPowerOfTwo(std::max(Options.AtlasSize, 256));
+    this->Options.MaxTileSize = std::min(FloorPowerOfTwo(std::max(Options.MaxTileSize, 32)), this->Options.AtlasSize);
+    this->Options.MinTileSize = std::min(FloorPowerOfTwo(std::max(Options.MinTileSize, 16)), this->Options.MaxTileSize);
+    this->Options.MaxTileUpdates = std::max(Options.MaxTileUpdates, 6);
+    this->Options.MinLightLevel = std::max(Options.MinLightLevel, 1e-4f);
+
+    // Every list is sized for its level being completely free, so handing out tiles never allocates
+    FreeLists.resize(GetLevel(this->Options.MinTileSize) + 1);
+    for (size_t Level = 0; Level < FreeLists.size(); ++Level)
+        FreeLists[Level].reserve(size_t(1) << (2 * Level));
+    FreeLists[0].push_back(glm::ivec2(0));
+
+    DepthMaterial = new Material("Assets/Shaders/Shadows/Vert.glsl", "Assets/Shaders/Shadows/Frag.glsl");
+    DepthMaterial->SetCullingMode(Material::CullingMode::None);
+    DepthMaterial->Compile();
+}
+
+Engine::LocalShadowAtlas::~LocalShadowAtlas()
+{
+    if (Atlas != 0)
+    {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Texture, Atlas);
+        glDeleteTextures(1, &Atlas);
+    }
+    if (Framebuffer != 0)
+        glDeleteFramebuffers(1, &Framebuffer);
+    delete DepthMaterial;
+}
+
+int Engine::LocalShadowAtlas::GetLevel(int TileSize) const
+{
+    int Level = 0;
+    while ((Options.AtlasSize >> Level) > TileSize)
+        ++Level;
+    return Level;
+}
+
+bool Engine::LocalShadowAtlas::AllocateTile(int Level, glm::ivec2 &Tile)
+{
+    if (Level < 0)
+        return false;
+
+    std::vector<glm::ivec2> &Free = FreeLists[Level];
+    if (!Free.empty())
+    {
+        Tile = Free.back();
+        Free.pop_back();
+        return true;
+    }
+
+    // Split a tile of the level above, this one takes a quarter and the other three stay free
+    glm::ivec2 Parent;
+    if (!AllocateTile(Level - 1, Parent))
+        return false;
+    int Size = Options.AtlasSize >> Level;
+    Free.push_back(Parent + glm::ivec2(Size, Size));
+    Free.push_back(Parent + glm::ivec2(0, Size));
+    Free.push_back(Parent + glm::ivec2(Size, 0));
+    Tile = Parent;
+    return true;
+}
+
+void Engine::LocalShadowAtlas::FreeTile(int Level, const glm::ivec2 &Tile)
+{
+    std::vector<glm::ivec2> &Free = FreeLists[Level];
+    if (Level > 0)
+    {
+        // Merge back into the parent once all four quarters are free
+        int Size = Options.AtlasSize >> Level;
+        glm::ivec2 Parent = (Tile / (Size * 2)) * (Size * 2);
+        glm::ivec2 Siblings[3];
+        int Found = 0;
+        for (glm::ivec2 Offset : {glm::ivec2(0, 0), glm::ivec2(Size, 0), glm::ivec2(0, Size), glm::ivec2(Size, Size)})
+        {
+            glm::ivec2 Sibling = Parent + Offset;
+            if (Sibling != Tile && std::find(Free.begin(), Free.end(), Sibling) != Free.end())
+                Siblings[Found++] = Sibling;
+        }
+
+        if (Found == 3)
+        {
+            for (const glm::ivec2 &Sibling : Siblings)
+            {
+                auto It = std::find(Free.begin(), Free.end(), Sibling);
+                *It = Free.back();
+                Free.pop_back();
+            }
+            FreeTile(Level - 1, Parent);
+            return;
+        }
+    }
+    Free.push_back(Tile);
+}
+
+bool Engine::LocalShadowAtlas::AllocateTiles(int TileSize, int Count, glm::ivec2 *Tiles)
+{
+    int Level = GetLevel(TileSize);
+    for (int i = 0; i < Count; ++i)
+    {
+        if (!AllocateTile(Level, Tiles[i]))
+        {
+            while (i-- > 0)
+                FreeTile(Level, Tiles[i]);
+            return false;
+        }
+    }
+    UsedTexels += static_cast<int64_t>(TileSize) * TileSize * Count;
+    return true;
+}
+
+void Engine::LocalShadowAtlas::ReleaseTiles(LightRecord &Record, int Count)
+{
+    if (Record.TileSize == 0)
+        return;
+
+    int Level = GetLevel(Record.TileSize);
+    for (int i = 0; i < Count; ++i)
+        FreeTile(Level, Record.Tiles[i]);
+    UsedTexels -= static_cast<int64_t>(Record.TileSize) * Record.TileSize * Count;
+    Record.TileSize = 0;
+    Record.Rendered = false;
+    Record.Dirty = true;
+}
+
+void Engine::LocalShadowAtlas::UpdateRecords(const std::vector<Light> &Lights, std::vector<LightRecord> &Records, bool Point, const Camera &View)
+{
+    int Faces = Point ? 6 : 1;
+    for (size_t i = Lights.size(); i < Records.size(); ++i)
+        ReleaseTiles(Records[i], Faces);
+    Records.resize(Lights.size());
+
+    glm::mat4 Projection = View.GetProjectionMatrix();
+    glm::mat4 ViewProjection = Projection * View.GetViewMatrix();
+    glm::vec3 ViewPosition = View.GetPosition();
+    glm::vec4 Planes[6];
+    for (int Axis = 0; Axis < 3; ++Axis)
+    {
+        glm::vec4 Row(ViewProjection[0][Axis], ViewProjection[1][Axis], ViewProjection[2][Axis], ViewProjection[3][Axis]);
+        glm::vec4 W(ViewProjection[0][3], ViewProjection[1][3], ViewProjection[2][3], ViewProjection[3][3]);
+        Planes[Axis * 2] = W + Row;
+        Planes[Axis * 2 + 1] = W - Row;
+    }
+
+    for (size_t i = 0; i < Lights.size(); ++i)
+    {
+        const Light &Source = Lights[i];
+        LightRecord &Record = Records[i];
+        float Range = GetRange(Source, Options.MinLightLevel);
+
+        // A changed light makes the old depth useless, it is hidden until redrawn
+        bool Changed = Source.Position != Record.Position || Range != Record.Range;
+        if (!Point)
+            Changed |= Source.Direction != Record.Direction || Source.OuterCutOff != Record.OuterCutOff;
+        if (Changed)
+        {
+            Record.Position = Source.Position;
+            Record.Direction = Source.Direction;
+            Record.Range = Range;
+            Record.OuterCutOff = Source.OuterCutOff;
+            Record.Rendered = false;
+            Record.Dirty = true;
+        }
+
+        // Share of the screen height the light's range covers, lights past the shader's array are never shaded
+        Record.Importance = 0.0f;
+        bool Valid = i < static_cast<size_t>(Light::MaxPerType) && Range > 0.0f && (Point || glm::dot(Source.Direction, Source.Direction) > 0.0f);
+        if (Valid && IsSphereVisible(Planes, Source.Position, Range))
+        {
+            float Distance = glm::length(Source.Position - ViewPosition);
+            if (Distance <= Range)
+                Record.Importance = 1.0f;
+            else
+                Record.Importance = std::min(1.0f, Range / std::sqrt(Distance * Distance - Range * Range) * Projection[1][1]);
+        }
+    }
+}
+
+void Engine::LocalShadowAtlas::MarkCaster(const Model::InstanceRef &Caster)
+{
+    glm::vec3 Min, Max;
+    Model::GetInstanceBounds(*Caster.Instance, Min, Max);
+    glm::vec3 Center = glm::vec3(Caster.Transform * glm::vec4((Min + Max) * 0.5f, 1.0f));
+    float Scale = std::max(glm::length(glm::vec3(Caster.Transform[0])),
+                           std::max(glm::length(glm::vec3(Caster.Transform[1])), glm::length(glm::vec3(Caster.Transform[2]))));
+    float Radius = glm::length(Max - Min) * 0.5f * Scale;
+
+    for (std::vector<LightRecord> *Records : {&PointRecords, &SpotRecords})
+    {
+        for (LightRecord &Record : *Records)
+        {
+            float Reach = Record.Range + Radius;
+            if (Record.TileSize != 0 && glm::dot(Center - Record.Position, Center - Record.Position) < Reach * Reach)
+                Record.Dirty = true;
+        }
+    }
+}
+
+void Engine::LocalShadowAtlas::MarkMovedCasters(const std::vector<Model::InstanceRef> &Instances)
+{
+    // Both where a caster was and where it is now may have changed in a light's tiles
+    size_t Count = 0;
+    for (const Model::InstanceRef &Ref : Instances)
+    {
+        if (!Ref.Dynamic)
+            continue;
+
+        if (Count == DynamicCasters.size())
+        {
+            DynamicCasters.push_back(Ref);
+            MarkCaster(Ref);
+        }
+        else
+        {
+            Model::InstanceRef &Previous = DynamicCasters[Count];
+            if (Previous.Instance != Ref.Instance || Previous.Transform != Ref.Transform)
+            {
+                MarkCaster(Previous);
+                MarkCaster(Ref);
+                Previous = Ref;
+            }
+        }
+        ++Count;
+    }
+
+    for (size_t i = Count; i < DynamicCasters.size(); ++i)
+        MarkCaster(DynamicCasters[i]);
+    DynamicCasters.resize(Count);
+}
+
+void Engine::LocalShadowAtlas::SelectLights(std::vector<LightRecord> &Records, bool Point, int MaxShadows)
+{
+    // Only the most important lights in view keep tiles, the rest give theirs back before anything is assigned
+    Order.clear();
+    for (size_t i = 0; i < Records.size(); ++i)
+    {
+        if (Records[i].Importance > 0.0f)
+            Order.push_back(static_cast<int>(i));
+    }
+    std::sort(Order.begin(), Order.end(), [&](int A, int B)
+    {
+        if (Records[A].Importance != Records[B].Importance)
+            return Records[A].Importance > Records[B].Importance;
+        return A < B;
+    });
+    for (size_t Rank = MaxShadows; Rank < Order.size(); ++Rank)
+        Records[Order[Rank]].Importance = 0.0f;
+
+    int Faces = Point ? 6 : 1;
+    for (LightRecord &Record : Records)
+    {
+        if (Record.Importance == 0.0f)
+            ReleaseTiles(Record, Faces);
+    }
+}
+
+void Engine::LocalShadowAtlas::AssignTiles(std::vector<LightRecord> &Records, bool Point)
+{
+    Order.clear();
+    for (size_t i = 0; i < Records.size(); ++i)
+    {
+        if (Records[i].Importance > 0.0f)
+            Order.push_back(static_cast<int>(i));
+    }
+    std::sort(Order.begin(), Order.end(), [&](int A, int B)
+    {
+        if (Records[A].Importance != Records[B].Importance)
+            return Records[A].Importance > Records[B].Importance;
+        return A < B;
+    });
+
+    int Faces = Point ? 6 : 1;
+    int Largest = Point ? std::max(Options.MaxTileSize / 2, Options.MinTileSize) : Options.MaxTileSize;
+    for (int Index : Order)
+    {
+        LightRecord &Record = Records[Index];
+        float Ideal = Largest * Record.Importance;
+        int Target = Options.MinTileSize;
+        while (Target * 2 <= Ideal && Target < Largest)
+            Target *= 2;
+
+        // Sizes only change once the importance is well past the boundary, so a light near it does not
+        // lose its tiles every other frame
+        if (Record.TileSize != 0)
+        {
+            if (Target > Record.TileSize && Ideal < Target * 1.25f)
+                Target = std::max(Record.TileSize, Target / 2);
+            else if (Target < Record.TileSize && Ideal >= Record.TileSize * 0.75f)
+                Target = Record.TileSize;
+        }
+        if (Target == Record.TileSize)
+            continue;
+
+        // Growing keeps the current tiles until larger ones are found, everything else starts from scratch
+        glm::ivec2 Tiles[6];
+        int Size = Target;
+        if (Target > Record.TileSize && Record.TileSize != 0)
+        {
+            while (Size > Record.TileSize && !AllocateTiles(Size, Faces, Tiles))
+                Size /= 2;
+            if (Size == Record.TileSize)
+                continue;
+            ReleaseTiles(Record, Faces);
+        }
+        else
+        {
+            ReleaseTiles(Record, Faces);
+            while (Size >= Options.MinTileSize && !AllocateTiles(Size, Faces, Tiles))
+                Size /= 2;
+            if (Size < Options.MinTileSize)
+                continue;
+        }
+
+        Record.TileSize = Size;
+        std::copy(Tiles, Tiles + Faces, Record.Tiles);
+        Record.Rendered = false;
+        Record.Dirty = true;
+    }
+}
+
+void Engine::LocalShadowAtlas::RecordTile(const std::vector<Model::InstanceRef> &Instances, const glm::ivec2 &Tile, int TileSize,
+                                          const glm::mat4 &View, const glm::mat4 &Projection, Frame &Out)
+{
+    // Updates only grow, shrinking would free the command lists kept for the next frame
+    if (Out.UpdateCount == static_cast<int>(Out.Updates.size()))
+        Out.Updates.emplace_back();
+    TileUpdate &Update = Out.Updates[Out.UpdateCount++];
+    Update.Viewport = glm::ivec3(Tile, TileSize);
+    Model::RecordDepthPass(Instances, View, Projection, Model::DepthCasters::All, DepthMaterial, Update.Commands);
+}
+
+void Engine::LocalShadowAtlas::ScheduleUpdates(const std::vector<Model::InstanceRef> &Instances, Frame &Out)
+{
+    Out.UpdateCount = 0;
+    size_t Total = PointRecords.size() + SpotRecords.size();
+    if (Total == 0)
+        return;
+
+    // Round robin from where the last frame stopped, a light's tiles are always redrawn together
+    int Budget = Options.MaxTileUpdates;
+    size_t Next = Cursor % Total;
+    for (size_t Step = 0; Step < Total && Budget > 0; ++Step)
+    {
+        size_t Index = (Cursor + Step) % Total;
+        bool Point = Index < PointRecords.size();
+        LightRecord &Record = Point ? PointRecords[Index] : SpotRecords[Index - PointRecords.size()];
+        int Faces = Point ? 6 : 1;
+        if (Record.TileSize == 0 || !Record.Dirty || Faces > Budget)
+            continue;
+
+        float Near = GetNear(Record.Range);
+        if (Point)
+        {
+            float TanHalf = GetTanHalfAngle(glm::radians(45.0f), Record.TileSize);
+            glm::mat4 Projection = glm::perspective(2.0f * std::atan(TanHalf), 1.0f, Near, Record.Range);
+            for (int Face = 0; Face < 6; ++Face)
+            {
+                glm::mat4 View = glm::lookAt(Record.Position, Record.Position + FaceForward[Face], FaceUp[Face]);
+                RecordTile(Instances, Record.Tiles[Face], Record.TileSize, View, Projection, Out);
+            }
+        }
+        else
+        {
+            float TanHalf = GetTanHalfAngle(GetSpotAngle(Record.OuterCutOff), Record.TileSize);
+            glm::mat4 Projection = glm::perspective(2.0f * std::atan(TanHalf), 1.0f, Near, Record.Range);
+            RecordTile(Instances, Record.Tiles[0], Record.TileSize, GetSpotView(Record.Position, Record.Direction), Projection, Out);
+        }
+
+        Record.Dirty = false;
+        Record.Rendered = true;
+        Budget -= Faces;
+        Next = Index + 1;
+    }
+    Cursor = Next;
+    TilesUpdated = Options.MaxTileUpdates - Budget;
+}
+
+void Engine::LocalShadowAtlas::Prepare(const Camera &View, const std::vector<Light> &PointLights, const std::vector<Light> &SpotLights,
+                                       const std::vector<Model::InstanceRef> &Instances, Frame &Out)
+{
+    ENGINE_PROFILE_FUNCTION();
+    Out.Enabled = true;
+    if (RefreshFailed.exchange(false))
+    {
+        ++Generation;
+        InvalidateAll();
+    }
+    Out.Generation = Generation;
+
+    UpdateRecords(PointLights, PointRecords, true, View);
+    UpdateRecords(SpotLights, SpotRecords, false, View);
+    MarkMovedCasters(Instances);
+    SelectLights(PointRecords, true, MaxPointShadows);
+    SelectLights(SpotRecords, false, MaxSpotShadows);
+    AssignTiles(PointRecords, true);
+    AssignTiles(SpotRecords, false);
+    ScheduleUpdates(Instances, Out);
+
+    // Publish every light whose tiles hold its shadow, by light index as the shader walks them in order
+    float AtlasSize = static_cast<float>(Options.AtlasSize);
+    Out.PointCount = 0;
+    for (size_t i = 0; i < PointRecords.size() && Out.PointCount < MaxPointShadows; ++i)
+    {
+        const LightRecord &Record = PointRecords[i];
+        if (Record.TileSize == 0 || !Record.Rendered)
+            continue;
+
+        float TanHalf = GetTanHalfAngle(glm::radians(45.0f), Record.TileSize);
+        PointShadow &Shadow = Out.Points[Out.PointCount++];
+        Shadow.Light = static_cast<int>(i);
+        Shadow.Params = glm::vec4(GetNear(Record.Range), Record.Range, 1.0f / TanHalf, 3.0f * TanHalf / Record.TileSize);
+        for (int Face = 0; Face < 6; ++Face)
+            Shadow.Faces[Face] = glm::vec4(glm::vec2(Record.Tiles[Face]) / AtlasSize, glm::vec2(Record.TileSize / AtlasSize));
+    }
+
+    Out.SpotCount = 0;
+    for (size_t i = 0; i < SpotRecords.size() && Out.SpotCount < MaxSpotShadows; ++i)
+    {
+        const LightRecord &Record = SpotRecords[i];
+        if (Record.TileSize == 0 || !Record.Rendered)
+            continue;
+
+        float TanHalf = GetTanHalfAngle(GetSpotAngle(Record.OuterCutOff), Record.TileSize);
+        glm::mat4 Projection = glm::perspective(2.0f * std::atan(TanHalf), 1.0f, GetNear(Record.Range), Record.Range);
+        SpotShadow &Shadow = Out.Spots[Out.SpotCount++];
+        Shadow.Light = static_cast<int>(i);
+        Shadow.Matrix = GetTileTransform(Record.Tiles[0], Record.TileSize, Options.AtlasSize) * Projection * GetSpotView(Record.Position, Record.Direction);
+        Shadow.NormalOffset = 3.0f * TanHalf / Record.TileSize;
+    }
+}
+
+void Engine::LocalShadowAtlas::InvalidateAll()
+{
+    for (std::vector<LightRecord> *Records : {&PointRecords, &SpotRecords})
+    {
+        for (LightRecord &Record : *Records)
+        {
+            Record.Rendered = false;
+            Record.Dirty = true;
+        }
+    }
+}
+
+float Engine::LocalShadowAtlas::GetOccupancy() const
+{
+    return static_cast<float>(static_cast<double>(UsedTexels) / (static_cast<double>(Options.AtlasSize) * Options.AtlasSize));
+}
+
+int Engine::LocalShadowAtlas::GetTilesUpdated() const
+{
+    return TilesUpdated;
+}
+
+void Engine::LocalShadowAtlas::CreateAtlas()
+{
+    int Size = Options.AtlasSize;
+    glGenTextures(1, &Atlas);
+    glBindTexture(GL_TEXTURE_2D, Atlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, Size, Size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, Atlas, MemoryTracker::GpuOwner::Shadows,
+                            MemoryTracker::GetTextureSize(GL_DEPTH_COMPONENT24, Size, Size));
+
+    glGenFramebuffers(1, &Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, Atlas, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "LocalShadowAtlas: Shadow atlas framebuffer is not complete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Engine::LocalShadowAtlas::Render(const Frame &Shadows)
+{
+    if (!Shadows.Enabled || Shadows.UpdateCount == 0)
+        return;
+
+    ENGINE_PROFILE_GPU_SCOPE("LocalShadows");
+    if (Atlas == 0)
+        CreateAtlas();
+
+    // The lights this frame publishes may rely on these tiles, hide everything until the simulation has
+    // seen the failure and scheduled them again
+    if (!DepthMaterial->IsReady())
+    {
+        RefreshFailed = true;
+        ValidFrom = Shadows.Generation + 1;
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    glDepthMask(GL_TRUE);
+
+    for (int i = 0; i < Shadows.UpdateCount; ++i)
+    {
+        const TileUpdate &Update = Shadows.Updates[i];
+        glViewport(Update.Viewport.x, Update.Viewport.y, Update.Viewport.z, Update.Viewport.z);
+        glScissor(Update.Viewport.x, Update.Viewport.y, Update.Viewport.z, Update.Viewport.z);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        CommandList::Execute(Update.Commands);
+    }
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Engine::LocalShadowAtlas::Apply(Material *Lighting, int TextureUnit, const Frame &Shadows)
+{
+    static const std::string MapUniform = "LocalShadowMap";
+    static const std::string AtlasTexelUniform = "LocalShadowAtlasTexel";
+    static const std::string PointCountUniform = "NumPointShadows";
+    static const std::string SpotCountUniform = "NumSpotShadows";
+    static const std::vector<std::string> PointLightUniforms = MakeUniformNames("PointShadowLights", MaxPointShadows);
+    static const std::vector<std::string> PointParamUniforms = MakeUniformNames("PointShadowParams", MaxPointShadows);
+    static const std::vector<std::string> PointFaceUniforms = MakeUniformNames("PointShadowFaces", MaxPointShadows * 6);
+    static const std::vector<std::string> SpotLightUniforms = MakeUniformNames("SpotShadowLights", MaxSpotShadows);
+    static const std::vector<std::string> SpotMatrixUniforms = MakeUniformNames("SpotShadowMatrices", MaxSpotShadows);
+    static const std::vector<std::string> SpotOffsetUniforms = MakeUniformNames("SpotShadowOffsets", MaxSpotShadows);
+
+    // The sampler always gets its own unit and a depth texture, even while no light uses it
+    if (Atlas == 0)
+        CreateAtlas();
+    Lighting->SetTexture(TextureUnit, Atlas);
+    Lighting->SetUniform(MapUniform, TextureUnit);
+    Lighting->SetUniform(AtlasTexelUniform, 1.0f / Options.AtlasSize);
+
+    bool Valid = Shadows.Enabled && Shadows.Generation >= ValidFrom;
+    int PointCount = Valid ? Shadows.PointCount : 0;
+    int SpotCount = Valid ? Shadows.SpotCount : 0;
+    Lighting->SetUniform(PointCountUniform, PointCount);
+    Lighting->SetUniform(SpotCountUniform, SpotCount);
+
+    for (int i = 0; i < PointCount; ++i)
+    {
+        const PointShadow &Shadow = Shadows.Points[i];
+        Lighting->SetUniform(PointLightUniforms[i], Shadow.Light);
+        Lighting->SetUniform(PointParamUniforms[i], Shadow.Params);
+        for (int Face = 0; Face < 6; ++Face)
+            Lighting->SetUniform(PointFaceUniforms[i * 6 + Face], Shadow.Faces[Face]);
+    }
+
+    for (int i = 0; i < SpotCount; ++i)
+    {
+        const SpotShadow &Shadow = Shadows.Spots[i];
+        Lighting->SetUniform(SpotLightUniforms[i], Shadow.Light);
+        Lighting->SetUniform(SpotMatrixUniforms[i], Shadow.Matrix);
+        Lighting->SetUniform(SpotOffsetUniforms[i], Shadow.NormalOffset);
+    }
+}
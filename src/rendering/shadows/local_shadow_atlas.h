@@ -0,0 +1,163 @@
+#pragma once
+
+#ifndef local_shadow_atlas_h
+#define local_shadow_atlas_h
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "../camera/camera.h"
+#include "../model/model.h"
+#include "../lighting/light.h"
+#include "../materials/material.h"
+#include "../commands/command_list.h"
+#include "../../core/memory/memory_tracker.h"
+#include "../../core/profiler/profiler.h"
+
+namespace Engine
+{
+    // Shadows of point and spot lights, all kept in one depth atlas. Every light in view gets a square tile
+    // (six for a point light, one per cube face) sized by how much of the screen its range covers, handed
+    // out by a buddy allocator so tiles of any power of two size pack without fragmenting for long.
+    //
+    // A tile keeps its depth until the light changes, the tile is resized or a dynamic instance moves within
+    // the light's range. Dirty lights are then redrawn round robin, at most MaxTileUpdates tiles per frame,
+    // and keep showing their previous shadow until their turn comes.
+    //
+    // Prepare runs on the simulation thread and records everything the frame needs into a Frame, Render and
+    // Apply run on the GL thread. Each side only touches its own members.
+    class LocalShadowAtlas
+    {
+    public:
+        static constexpr int MaxPointShadows = 8;
+        static constexpr int MaxSpotShadows = 8;
+
+        struct Settings
+        {
+            int AtlasSize = 2048;
+            // Tile size of a light covering the whole screen, point lights use half of it per face
+            int MaxTileSize = 512;
+            int MinTileSize = 64;
+            // Tiles redrawn per frame at most, a point light needs six at once
+            int MaxTileUpdates = 8;
+            // A light's range ends where its color times intensity falls below this
+            float MinLightLevel = 0.01f;
+        };
+
+        // One tile to redraw, Viewport is x, y, size in atlas texels
+        struct TileUpdate
+        {
+            glm::ivec3 Viewport = glm::ivec3(0);
+            std::vector<CommandList> Commands;
+        };
+
+        struct SpotShadow
+        {
+            int Light = 0;
+            // World space to atlas texture space
+            glm::mat4 Matrix = glm::mat4(1.0f);
+            // Normal offset per unit of distance to the light
+            float NormalOffset = 0.0f;
+        };
+
+        struct PointShadow
+        {
+            int Light = 0;
+            // Near, far, face scale and normal offset per unit of distance
+            glm::vec4 Params = glm::vec4(0.0f);
+            // Offset and size of each cube face's tile in atlas texture space
+            glm::vec4 Faces[6];
+        };
+
+        // The shadow work of one frame, part of the frame snapshot. Shadows are sorted by light index
+        struct Frame
+        {
+            bool Enabled = false;
+            uint64_t Generation = 0;
+            int UpdateCount = 0;
+            std::vector<TileUpdate> Updates;
+            int PointCount = 0, SpotCount = 0;
+            PointShadow Points[MaxPointShadows];
+            SpotShadow Spots[MaxSpotShadows];
+        };
+
+        LocalShadowAtlas(const Settings &Options);
+        ~LocalShadowAtlas();
+
+        // Simulation thread. Sizes and allocates the tiles of the lights in view, marks lights whose casters
+        // moved and records the tiles due for a redraw within the budget
+        void Prepare(const Camera &View, const std::vector<Light> &PointLights, const std::vector<Light> &SpotLights,
+                     const std::vector<Model::InstanceRef> &Instances, Frame &Out);
+        // Simulation thread. Redraws every tile, e.g. after the scene changed
+        void InvalidateAll();
+
+        // GL thread. Draws the tiles the frame asks for
+        void Render(const Frame &Shadows);
+        // GL thread. Binds the atlas to TextureUnit of the lighting material and sets its shadow uniforms
+        void Apply(Material *Lighting, int TextureUnit, const Frame &Shadows);
+
+        // Simulation thread. Share of the atlas handed out to tiles and tiles recorded for the last frame
+        float GetOccupancy() const;
+        int GetTilesUpdated() const;
+
+    private:
+        struct LightRecord
+        {
+            // Size of each tile, 0 while the light has none
+            int TileSize = 0;
+            glm::ivec2 Tiles[6];
+            // The tiles hold a shadow of the light as it is now, possibly with stale casters
+            bool Rendered = false;
+            bool Dirty = true;
+            glm::vec3 Position = glm::vec3(0.0f), Direction = glm::vec3(0.0f);
+            float Range = 0.0f, OuterCutOff = 0.0f;
+            float Importance = 0.0f;
+        };
+
+        Settings Options;
+
+        // Simulation thread
+        std::vector<LightRecord> PointRecords, SpotRecords;
+        // Free tiles per level, level 0 is the whole atlas and every level halves the size
+        std::vector<std::vector<glm::ivec2>> FreeLists;
+        int64_t UsedTexels = 0;
+        // Where every dynamic instance was last frame, in the order they appear in the instance list
+        std::vector<Model::InstanceRef> DynamicCasters;
+        std::vector<int> Order;
+        size_t Cursor = 0;
+        uint64_t Generation = 0;
+        int TilesUpdated = 0;
+
+        // GL thread
+        Material *DepthMaterial = nullptr;
+        GLuint Atlas = 0, Framebuffer = 0;
+        uint64_t ValidFrom = 0;
+
+        // Set by the GL thread when requested tiles could not be drawn, the next Prepare redraws everything
+        std::atomic<bool> RefreshFailed{false};
+
+        void CreateAtlas();
+        int GetLevel(int TileSize) const;
+        bool AllocateTile(int Level, glm::ivec2 &Tile);
+        void FreeTile(int Level, const glm::ivec2 &Tile);
+        bool AllocateTiles(int TileSize, int Count, glm::ivec2 *Tiles);
+        void ReleaseTiles(LightRecord &Record, int Count);
+
+        void UpdateRecords(const std::vector<Light> &Lights, std::vector<LightRecord> &Records, bool Point, const Camera &View);
+        void MarkMovedCasters(const std::vector<Model::InstanceRef> &Instances);
+        void MarkCaster(const Model::InstanceRef &Caster);
+        void SelectLights(std::vector<LightRecord> &Records, bool Point, int MaxShadows);
+        void AssignTiles(std::vector<LightRecord> &Records, bool Point);
+        void ScheduleUpdates(const std::vector<Model::InstanceRef> &Instances, Frame &Out);
+        void RecordTile(const std::vector<Model::InstanceRef> &Instances, const glm::ivec2 &Tile, int TileSize,
+                        const glm::mat4 &View, const glm::mat4 &Projection, Frame &Out);
+    };
+};
+
+#endif
@@ -6,7 +6,7 @@ Engine::Sprite::Sprite(Material* material, const glm::vec2 &position,
       ScreenWidth(screenWidth), ScreenHeight(screenHeight)
 {
     MaterialInstance = material;
-    MaterialInstance->SetUniform("UseTexture", true);
+    MaterialInstance->EnableKeyword("USE_TEXTURE");
 
     // Default full UV range (entire texture)
     UV = glm::vec4(0.0f, 1.0f, 1.0f, 0.0f); 
@@ -16,6 +16,8 @@ Engine::Sprite::Sprite(Material* material, const glm::vec2 &position,
 
 Engine::Sprite::~Sprite()
 {
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, VBO);
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, EBO);
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
@@ -23,21 +25,6 @@ Engine::Sprite::~Sprite()
 
 void Engine::Sprite::UpdateVertexData()
 {
-    // Delete old buffers and VAO to avoid memory leaks
-    if (VAO != 0)
-        glDeleteVertexArrays(1, &VAO);
-    if (VBO != 0)
-        glDeleteBuffers(1, &VBO);
-    if (EBO != 0)
-        glDeleteBuffers(1, &EBO);
-
-    // Generate new VAO, VBO, and EBO
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
     float Vertices[] = {
         // Position        // UV        // Normal      // Color
          1.0f,  0.0f, 0.0f,  UV.z, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f, // Top-right
@@ -46,6 +33,20 @@ void Engine::Sprite::UpdateVertexData()
          0.0f,  0.0f, 0.0f,  UV.x, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f  // Top-left
     };
 
+    // Only the UVs change after creation, so reuse the existing buffers instead of recreating them
+    if (VAO != 0)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertices), Vertices);
+        return;
+    }
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+
     unsigned int Indices[] = { 0, 1, 3, 1, 2, 3 };
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
@@ -53,6 +54,8 @@ void Engine::Sprite::UpdateVertexData()
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(Indices), Indices, GL_STATIC_DRAW);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, VBO, MemoryTracker::GpuOwner::Sprites, sizeof(Vertices));
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, EBO, MemoryTracker::GpuOwner::Sprites, sizeof(Indices));
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(0);
@@ -81,7 +84,10 @@ void Engine::Sprite::Render()
         -1.0f, 1.0f
     );
 
-    MaterialInstance->Bind();
+    if (!MaterialInstance->Bind())
+    {
+        return;
+    }
 
     glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(Position, 0.0f));
     model = glm::scale(model, glm::vec3(Size, 1.0f));
@@ -107,7 +113,7 @@ void Engine::Sprite::SetSize(const glm::vec2 &size)
 void Engine::Sprite::SetMaterial(Material* material)
 {
     MaterialInstance = material;
-    MaterialInstance->SetUniform("UseTexture", true);
+    MaterialInstance->EnableKeyword("USE_TEXTURE");
 }
 
 void Engine::Sprite::SetUV(const glm::vec4 &uv)
@@ -132,3 +138,8 @@ glm::vec2 Engine::Sprite::GetSize() const
 {
     return Size;
 }
+
+glm::vec4 Engine::Sprite::GetUV() const
+{
+    return UV;
+}
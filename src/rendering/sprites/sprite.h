@@ -28,6 +28,7 @@ namespace Engine
         Material* GetMaterial() const;
         glm::vec2 GetPosition() const;
         glm::vec2 GetSize() const;
+        glm::vec4 GetUV() const;
 
     private:
         Material* MaterialInstance;
@@ -37,7 +38,7 @@ namespace Engine
         unsigned int *ScreenWidth;
         unsigned int *ScreenHeight;
 
-        unsigned int VAO, VBO, EBO;
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
         glm::vec4 UV; // NEW: Store UV coordinates
 
         void UpdateVertexData(); // NEW: Update VBO with new UV
@@ -0,0 +1,290 @@
+#include "sprite_batch.h"
+
+Engine::SpriteBatch::SpriteBatch(unsigned int *ScreenWidth, unsigned int *ScreenHeight, size_t MaxSprites)
+    : ScreenWidth(ScreenWidth), ScreenHeight(ScreenHeight), MaxSprites(MaxSprites)
+{
+    VertexColorKeyword = ShaderLibrary::GetKeywordMask("USE_VERTEX_COLOR");
+
+    size_t BufferSize = MaxSprites * 4 * sizeof(Vertex) * SectionCount;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+    Persistent = GLAD_GL_VERSION_4_4 && glBufferStorage;
+    if (Persistent)
+    {
+        GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, BufferSize, nullptr, Flags);
+        MappedVertices = static_cast<Vertex *>(glMapBufferRange(GL_ARRAY_BUFFER, 0, BufferSize, Flags));
+        Persistent = MappedVertices != nullptr;
+    }
+    if (!Persistent)
+    {
+        std::cout << "SpriteBatch: Persistent mapping unavailable, using unsynchronized buffer mapping" << std::endl;
+        glBufferData(GL_ARRAY_BUFFER, BufferSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    // Every section reuses the same quad indices through the base vertex
+    std::vector<unsigned int> Indices;
+    Indices.reserve(MaxSprites * 6);
+    for (unsigned int i = 0; i < MaxSprites; ++i)
+    {
+        unsigned int Base = i * 4;
+        Indices.insert(Indices.end(), {Base + 0, Base + 1, Base + 3, Base + 1, Base + 2, Base + 3});
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), Indices.data(), GL_STATIC_DRAW);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, VBO, MemoryTracker::GpuOwner::Sprites, BufferSize);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, EBO, MemoryTracker::GpuOwner::Sprites, Indices.size() * sizeof(unsigned int));
+
+    // Matches the Main vertex shader: position, UV and colour, the normal attribute stays disabled
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, X));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, U));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void *)offsetof(Vertex, Color));
+    glEnableVertexAttribArray(3);
+
+    glBindVertexArray(0);
+}
+
+Engine::SpriteBatch::~SpriteBatch()
+{
+    for (GLsync &Fence : SectionFences)
+    {
+        if (Fence)
+            glDeleteSync(Fence);
+    }
+
+    if (Persistent)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, VBO);
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, EBO);
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+void Engine::SpriteBatch::Begin(SortMode SortingMode)
+{
+    Mode = SortingMode;
+    Entries.clear();
+    Buckets.clear();
+    BucketLookup.clear();
+    SpriteCount = 0;
+    DrawCalls = 0;
+}
+
+uint32_t Engine::SpriteBatch::GetBucket(Material *MaterialPtr, unsigned int TextureID)
+{
+    // Consecutive sprites almost always share state, so check the previous bucket before hashing
+    if (!Buckets.empty() && Buckets[LastBucket].MaterialPtr == MaterialPtr && Buckets[LastBucket].TextureID == TextureID)
+        return LastBucket;
+
+    BucketKey Key = {MaterialPtr, TextureID};
+    auto It = BucketLookup.find(Key);
+    if (It == BucketLookup.end())
+    {
+        It = BucketLookup.emplace(Key, static_cast<uint32_t>(Buckets.size())).first;
+        Buckets.push_back(Key);
+    }
+    LastBucket = It->second;
+    return LastBucket;
+}
+
+void Engine::SpriteBatch::Draw(Material *MaterialPtr, unsigned int TextureID, const glm::vec2 &Position, const glm::vec2 &Size,
+                               float Rotation, const glm::vec4 &UV, const glm::vec4 &Color, const glm::vec2 &Origin)
+{
+    if (!MaterialPtr)
+        return;
+
+    glm::uvec4 Bytes = glm::uvec4(glm::clamp(Color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    uint32_t PackedColor = Bytes.r | (Bytes.g << 8) | (Bytes.b << 16) | (Bytes.a << 24);
+
+    Entries.push_back({Position, Size, Origin, Rotation, UV, PackedColor, GetBucket(MaterialPtr, TextureID)});
+}
+
+void Engine::SpriteBatch::Draw(const Sprite &SpriteInstance, unsigned int TextureID, float Rotation, const glm::vec4 &Color)
+{
+    Draw(SpriteInstance.GetMaterial(), TextureID, SpriteInstance.GetPosition(), SpriteInstance.GetSize(), Rotation, SpriteInstance.GetUV(), Color);
+}
+
+void Engine::SpriteBatch::SortEntries()
+{
+    Order.resize(Entries.size());
+
+    if (Mode == SortMode::Submission)
+    {
+        for (uint32_t i = 0; i < Order.size(); ++i)
+            Order[i] = i;
+        return;
+    }
+
+    // Rank buckets by material sort order, keeping first-use order for ties
+    std::vector<uint32_t> Rank(Buckets.size());
+    for (uint32_t i = 0; i < Rank.size(); ++i)
+        Rank[i] = i;
+    std::stable_sort(Rank.begin(), Rank.end(), [this](uint32_t A, uint32_t B)
+                     { return Buckets[A].MaterialPtr->GetSortOrder() < Buckets[B].MaterialPtr->GetSortOrder(); });
+
+    // Counting sort by bucket rank, stable so submission order is kept inside each bucket
+    std::vector<uint32_t> Offsets(Buckets.size() + 1, 0);
+    std::vector<uint32_t> BucketRank(Buckets.size());
+    for (uint32_t i = 0; i < Rank.size(); ++i)
+        BucketRank[Rank[i]] = i;
+    for (const Entry &SpriteEntry : Entries)
+        ++Offsets[BucketRank[SpriteEntry.Bucket] + 1];
+    for (size_t i = 1; i < Offsets.size(); ++i)
+        Offsets[i] += Offsets[i - 1];
+    for (uint32_t i = 0; i < Entries.size(); ++i)
+        Order[Offsets[BucketRank[Entries[i].Bucket]]++] = i;
+}
+
+void Engine::SpriteBatch::End()
+{
+    if (Entries.empty() || *ScreenHeight == 0)
+        return;
+
+    SortEntries();
+    for (size_t First = 0; First < Order.size(); First += MaxSprites)
+        Flush(First, std::min(MaxSprites, Order.size() - First));
+
+    SpriteCount = Entries.size();
+}
+
+Engine::SpriteBatch::Vertex *Engine::SpriteBatch::AcquireSection(size_t Count)
+{
+    Section = (Section + 1) % SectionCount;
+
+    // Wait until the GPU has finished reading the section written SectionCount flushes ago
+    if (SectionFences[Section])
+    {
+        while (glClientWaitSync(SectionFences[Section], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        {
+        }
+        glDeleteSync(SectionFences[Section]);
+        SectionFences[Section] = nullptr;
+    }
+
+    size_t SectionVertices = MaxSprites * 4;
+    if (Persistent)
+        return MappedVertices + Section * SectionVertices;
+
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    return static_cast<Vertex *>(glMapBufferRange(GL_ARRAY_BUFFER, Section * SectionVertices * sizeof(Vertex), Count * 4 * sizeof(Vertex),
+                                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+}
+
+void Engine::SpriteBatch::ReleaseSection()
+{
+    if (!Persistent)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+}
+
+void Engine::SpriteBatch::Flush(size_t First, size_t Count)
+{
+    Vertex *Out = AcquireSection(Count);
+    if (!Out)
+        return;
+
+    for (size_t i = 0; i < Count; ++i)
+    {
+        const Entry &E = Entries[Order[First + i]];
+        float Cos = std::cos(E.Rotation), Sin = std::sin(E.Rotation);
+
+        // Rotate each corner about the origin, then translate, same winding as Sprite
+        auto Corner = [&](float X, float Y, float U, float V)
+        {
+            glm::vec2 Local = glm::vec2(X, Y) * E.Size - E.Origin;
+            *Out++ = {E.Position.x + Local.x * Cos - Local.y * Sin, E.Position.y + Local.x * Sin + Local.y * Cos, U, V, E.Color};
+        };
+        Corner(1.0f, 0.0f, E.UV.z, E.UV.y); // Top-right
+        Corner(1.0f, 1.0f, E.UV.z, E.UV.w); // Bottom-right
+        Corner(0.0f, 1.0f, E.UV.x, E.UV.w); // Bottom-left
+        Corner(0.0f, 0.0f, E.UV.x, E.UV.y); // Top-left
+    }
+    ReleaseSection();
+
+    glm::mat4 Projection = glm::ortho(
+        0.0f, static_cast<float>(*ScreenWidth),
+        static_cast<float>(*ScreenHeight), 0.0f,
+        -1.0f, 1.0f);
+
+    static const std::string ModelUniform = "Model";
+    static const std::string ViewUniform = "View";
+    static const std::string ProjectionUniform = "Projection";
+
+    glBindVertexArray(VAO);
+    GLint BaseVertex = static_cast<GLint>(Section * MaxSprites * 4);
+    Material *BoundMaterial = nullptr;
+    // Unit 0 holds a run's own texture instead of the material's
+    bool TextureOverridden = false;
+
+    size_t RunStart = 0;
+    while (RunStart < Count)
+    {
+        uint32_t Bucket = Entries[Order[First + RunStart]].Bucket;
+        size_t RunEnd = RunStart + 1;
+        while (RunEnd < Count && Entries[Order[First + RunEnd]].Bucket == Bucket)
+            ++RunEnd;
+
+        const BucketKey &State = Buckets[Bucket];
+        // Binding the material again also restores its own texture after a run that replaced it
+        if (State.MaterialPtr != BoundMaterial || (State.TextureID == 0 && TextureOverridden))
+        {
+            State.MaterialPtr->SetUniform(ModelUniform, glm::mat4(1.0f));
+            State.MaterialPtr->SetUniform(ViewUniform, glm::mat4(1.0f));
+            State.MaterialPtr->SetUniform(ProjectionUniform, Projection);
+
+            // Runs whose variant is still compiling are skipped for this frame
+            BoundMaterial = nullptr;
+            TextureOverridden = false;
+            if (!State.MaterialPtr->Bind(VertexColorKeyword))
+            {
+                RunStart = RunEnd;
+                continue;
+            }
+            BoundMaterial = State.MaterialPtr;
+        }
+        if (State.TextureID != 0)
+        {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, State.TextureID);
+            TextureOverridden = true;
+        }
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>((RunEnd - RunStart) * 6), GL_UNSIGNED_INT,
+                                 (void *)(RunStart * 6 * sizeof(unsigned int)), BaseVertex);
+        ++DrawCalls;
+        RunStart = RunEnd;
+    }
+
+    glBindVertexArray(0);
+    SectionFences[Section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+size_t Engine::SpriteBatch::GetSpriteCount() const
+{
+    return SpriteCount;
+}
+
+size_t Engine::SpriteBatch::GetDrawCallCount() const
+{
+    return DrawCalls;
+}
+
+bool Engine::SpriteBatch::IsPersistentlyMapped() const
+{
+    return Persistent;
+}
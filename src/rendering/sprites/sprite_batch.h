@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef sprite_batch_h
+#define sprite_batch_h
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glad/glad.h>
+#include "../materials/material.h"
+#include "sprite.h"
+
+namespace Engine
+{
+    // Collects screen-space sprites for a frame and draws them with one call per material/texture run.
+    // Transforms are applied on the CPU while writing straight into a persistently mapped ring buffer
+    // (falls back to unsynchronized mapping when GL 4.4 buffer storage is unavailable).
+    class SpriteBatch
+    {
+    public:
+        enum class SortMode
+        {
+            Submission,     // Keep submission order, only adjacent sprites with the same state are merged
+            MaterialTexture // Group by material sort order, material and texture, stable within each group
+        };
+
+        SpriteBatch(unsigned int *ScreenWidth, unsigned int *ScreenHeight, size_t MaxSprites = 131072);
+        ~SpriteBatch();
+
+        void Begin(SortMode Mode = SortMode::MaterialTexture);
+        // TextureID 0 keeps the textures bound by the material, UV uses the Sprite::SetUV layout
+        void Draw(Material *MaterialPtr, unsigned int TextureID, const glm::vec2 &Position, const glm::vec2 &Size,
+                  float Rotation = 0.0f, const glm::vec4 &UV = glm::vec4(0.0f, 1.0f, 1.0f, 0.0f),
+                  const glm::vec4 &Color = glm::vec4(1.0f), const glm::vec2 &Origin = glm::vec2(0.0f));
+        void Draw(const Sprite &SpriteInstance, unsigned int TextureID = 0, float Rotation = 0.0f, const glm::vec4 &Color = glm::vec4(1.0f));
+        void End();
+
+        size_t GetSpriteCount() const;
+        size_t GetDrawCallCount() const;
+        bool IsPersistentlyMapped() const;
+
+    private:
+        struct Vertex
+        {
+            float X, Y;
+            float U, V;
+            uint32_t Color;
+        };
+
+        struct Entry
+        {
+            glm::vec2 Position, Size, Origin;
+            float Rotation;
+            glm::vec4 UV;
+            uint32_t Color;
+            uint32_t Bucket;
+        };
+
+        struct BucketKey
+        {
+            Material *MaterialPtr;
+            unsigned int TextureID;
+
+            bool operator==(const BucketKey &Other) const
+            {
+                return MaterialPtr == Other.MaterialPtr && TextureID == Other.TextureID;
+            }
+        };
+
+        struct BucketKeyHash
+        {
+            size_t operator()(const BucketKey &Key) const
+            {
+                return std::hash<const void *>()(Key.MaterialPtr) ^ (std::hash<unsigned int>()(Key.TextureID) * 0x9E3779B97F4A7C15ull);
+            }
+        };
+
+        static constexpr int SectionCount = 3;
+
+        unsigned int *ScreenWidth;
+        unsigned int *ScreenHeight;
+        size_t MaxSprites;
+        SortMode Mode = SortMode::MaterialTexture;
+        // Colour comes per vertex, so every material is bound with this keyword added to its own variant
+        ShaderLibrary::KeywordMask VertexColorKeyword = 0;
+
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        Vertex *MappedVertices = nullptr;
+        bool Persistent = false;
+        GLsync SectionFences[SectionCount] = {};
+        int Section = 0;
+
+        std::vector<Entry> Entries;
+        std::vector<BucketKey> Buckets;
+        std::unordered_map<BucketKey, uint32_t, BucketKeyHash> BucketLookup;
+        std::vector<uint32_t> Order;
+        size_t SpriteCount = 0;
+        size_t DrawCalls = 0;
+
+        uint32_t LastBucket = 0;
+
+        uint32_t GetBucket(Material *MaterialPtr, unsigned int TextureID);
+        void SortEntries();
+        void Flush(size_t First, size_t Count);
+        Vertex *AcquireSection(size_t Count);
+        void ReleaseSection();
+    };
+};
+
+#endif
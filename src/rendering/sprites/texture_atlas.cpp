@@ -0,0 +1,303 @@
+#include "texture_atlas.h"
+
+Engine::TextureAtlas::TextureAtlas(int PageSize, int Padding, int MaxPages, GLint MinFilter, GLint MagFilter)
+    : PageSize(PageSize), Padding(std::max(Padding, 1)), MaxPages(MaxPages), MinFilter(MinFilter), MagFilter(MagFilter)
+{
+    // Entries start on a grid as coarse as the padding so each mip level keeps them texel aligned
+    Alignment = 1;
+    while (Alignment * 2 <= this->Padding)
+        Alignment *= 2;
+}
+
+Engine::TextureAtlas::~TextureAtlas()
+{
+    for (Page &AtlasPage : Pages)
+        Util::UnloadTexture(AtlasPage.TextureID);
+}
+
+int Engine::TextureAtlas::AddPage()
+{
+    Pages.emplace_back(PageSize);
+    Page &AtlasPage = Pages.back();
+
+    int MaxLevel = 0;
+    while ((2 << MaxLevel) <= Alignment)
+        ++MaxLevel;
+
+    glGenTextures(1, &AtlasPage.TextureID);
+    glBindTexture(GL_TEXTURE_2D, AtlasPage.TextureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, PageSize, PageSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MaxLevel);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, AtlasPage.TextureID, MemoryTracker::GpuOwner::Sprites,
+                            MemoryTracker::GetTextureSize(GL_RGBA8, PageSize, PageSize, MaxLevel > 0));
+
+    std::cout << "TextureAtlas: Allocated page " << Pages.size() - 1 << " (" << PageSize << "x" << PageSize << ")" << std::endl;
+    return static_cast<int>(Pages.size()) - 1;
+}
+
+glm::ivec2 Engine::TextureAtlas::GetPaddedSize(const glm::ivec2 &Size) const
+{
+    glm::ivec2 Padded = Size + glm::ivec2(Padding * 2);
+    return (Padded + glm::ivec2(Alignment - 1)) / Alignment * Alignment;
+}
+
+Engine::TextureAtlas::Handle Engine::TextureAtlas::Insert(const unsigned char *Data, int Width, int Height, int NumChannels)
+{
+    if (NumChannels < 1 || NumChannels > 4 || Width <= 0 || Height <= 0 || Data == nullptr)
+        return -1;
+
+    glm::ivec2 Padded = GetPaddedSize(glm::ivec2(Width, Height));
+    if (Padded.x > PageSize || Padded.y > PageSize)
+    {
+        std::cerr << "TextureAtlas: " << Width << "x" << Height << " texture is too large for a " << PageSize << " page" << std::endl;
+        return -1;
+    }
+
+    Handle NewHandle;
+    if (!FreeHandles.empty())
+    {
+        NewHandle = FreeHandles.back();
+        FreeHandles.pop_back();
+    }
+    else
+    {
+        NewHandle = static_cast<Handle>(Entries.size());
+        Entries.emplace_back();
+    }
+
+    Entry &Item = Entries[NewHandle];
+    Item.Alive = true;
+    Item.Size = glm::ivec2(Width, Height);
+    Item.Pixels.resize(static_cast<size_t>(Width) * Height * 4);
+    for (size_t i = 0, Count = static_cast<size_t>(Width) * Height; i < Count; ++i)
+    {
+        const unsigned char *Source = Data + i * NumChannels;
+        unsigned char *Target = &Item.Pixels[i * 4];
+        // Grayscale images are expanded, their second channel is alpha
+        bool Gray = NumChannels < 3;
+        Target[0] = Source[0];
+        Target[1] = Gray ? Source[0] : Source[1];
+        Target[2] = Gray ? Source[0] : Source[2];
+        Target[3] = (NumChannels == 4) ? Source[3] : (NumChannels == 2) ? Source[1] : 255;
+    }
+
+    if (Place(NewHandle))
+        return NewHandle;
+
+    // Out of space, reclaim the holes left by removed entries and try once more
+    if (Repack())
+        return NewHandle;
+
+    std::cerr << "TextureAtlas: Out of space for " << Width << "x" << Height << " texture" << std::endl;
+    Remove(NewHandle);
+    return -1;
+}
+
+Engine::TextureAtlas::Handle Engine::TextureAtlas::InsertFromFile(const std::string &Path)
+{
+    // Decoded like every other texture, which keeps the vertical flip per thread
+    Util::TextureData Image = Util::DecodeTexture(Path);
+    if (!Image.Pixels)
+    {
+        std::cout << "Failed to load texture: " << Path << std::endl;
+        return -1;
+    }
+
+    Handle NewHandle = Insert(Image.Pixels, Image.Width, Image.Height, Image.NumChannels);
+    Util::FreeTextureData(Image);
+    return NewHandle;
+}
+
+bool Engine::TextureAtlas::Place(Handle Index)
+{
+    Entry &Item = Entries[Index];
+    glm::ivec2 Padded = GetPaddedSize(Item.Size);
+    glm::ivec2 Position;
+
+    for (int i = 0; i <= static_cast<int>(Pages.size()); ++i)
+    {
+        if (i == static_cast<int>(Pages.size()))
+        {
+            if (i >= MaxPages)
+                break;
+            AddPage();
+        }
+
+        if (Pages[i].Packer.Pack(Padded.x, Padded.y, Position))
+        {
+            Item.Page = i;
+            Item.Position = Position + glm::ivec2(Padding);
+            Pages[i].LiveArea += static_cast<long long>(Padded.x) * Padded.y;
+            Upload(Item);
+            return true;
+        }
+    }
+
+    Item.Page = -1;
+    return false;
+}
+
+void Engine::TextureAtlas::Upload(const Entry &Item)
+{
+    // Copy the image with its edge texels extruded into the padding, so filtering and mips only ever see
+    // colours belonging to this entry
+    glm::ivec2 Padded = GetPaddedSize(Item.Size);
+    std::vector<unsigned char> Block(static_cast<size_t>(Padded.x) * Padded.y * 4);
+    for (int Y = 0; Y < Padded.y; ++Y)
+    {
+        int SourceY = std::clamp(Y - Padding, 0, Item.Size.y - 1);
+        for (int X = 0; X < Padded.x; ++X)
+        {
+            int SourceX = std::clamp(X - Padding, 0, Item.Size.x - 1);
+            const unsigned char *Source = &Item.Pixels[(static_cast<size_t>(SourceY) * Item.Size.x + SourceX) * 4];
+            std::copy(Source, Source + 4, &Block[(static_cast<size_t>(Y) * Padded.x + X) * 4]);
+        }
+    }
+
+    glm::ivec2 Origin = Item.Position - glm::ivec2(Padding);
+    glBindTexture(GL_TEXTURE_2D, Pages[Item.Page].TextureID);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, Origin.x, Origin.y, Padded.x, Padded.y, GL_RGBA, GL_UNSIGNED_BYTE, Block.data());
+    Pages[Item.Page].Dirty = true;
+}
+
+void Engine::TextureAtlas::Remove(Handle Index)
+{
+    if (!IsValid(Index))
+        return;
+
+    Entry &Item = Entries[Index];
+    if (Item.Page >= 0)
+    {
+        glm::ivec2 Padded = GetPaddedSize(Item.Size);
+        Pages[Item.Page].LiveArea -= static_cast<long long>(Padded.x) * Padded.y;
+    }
+
+    Item = Entry();
+    FreeHandles.push_back(Index);
+}
+
+bool Engine::TextureAtlas::Repack()
+{
+    // Tallest first packs a skyline far tighter than insertion order
+    std::vector<Handle> Order;
+    for (Handle i = 0; i < static_cast<Handle>(Entries.size()); ++i)
+    {
+        if (Entries[i].Alive)
+            Order.push_back(i);
+    }
+    std::sort(Order.begin(), Order.end(), [this](Handle A, Handle B)
+              { return Entries[A].Size.y > Entries[B].Size.y; });
+
+    // The new layout is planned on fresh packers first, so one that does not fit leaves the pages untouched
+    std::vector<SkylinePacker> Packers;
+    std::vector<std::pair<int, glm::ivec2>> Placements(Order.size());
+    for (size_t i = 0; i < Order.size(); ++i)
+    {
+        glm::ivec2 Padded = GetPaddedSize(Entries[Order[i]].Size);
+        int PageIndex = 0;
+        for (; PageIndex <= static_cast<int>(Packers.size()); ++PageIndex)
+        {
+            if (PageIndex == static_cast<int>(Packers.size()))
+            {
+                if (PageIndex >= MaxPages)
+                {
+                    std::cerr << "TextureAtlas: Entry " << Order[i] << " would not fit after repacking, keeping the current layout" << std::endl;
+                    return false;
+                }
+                Packers.emplace_back(PageSize, PageSize);
+            }
+            if (Packers[PageIndex].Pack(Padded.x, Padded.y, Placements[i].second))
+                break;
+        }
+        Placements[i].first = PageIndex;
+    }
+
+    while (Pages.size() < Packers.size())
+        AddPage();
+    for (size_t i = 0; i < Pages.size(); ++i)
+    {
+        Pages[i].Packer = (i < Packers.size()) ? Packers[i] : SkylinePacker(PageSize, PageSize);
+        Pages[i].LiveArea = 0;
+    }
+    for (size_t i = 0; i < Order.size(); ++i)
+    {
+        Entry &Item = Entries[Order[i]];
+        glm::ivec2 Padded = GetPaddedSize(Item.Size);
+        Item.Page = Placements[i].first;
+        Item.Position = Placements[i].second + glm::ivec2(Padding);
+        Pages[Item.Page].LiveArea += static_cast<long long>(Padded.x) * Padded.y;
+        Upload(Item);
+    }
+
+    ++Version;
+    std::cout << "TextureAtlas: Repacked " << Order.size() << " entries into " << Pages.size() << " pages" << std::endl;
+    return true;
+}
+
+void Engine::TextureAtlas::Update()
+{
+    bool Mipmapped = MinFilter == GL_LINEAR_MIPMAP_LINEAR || MinFilter == GL_NEAREST_MIPMAP_NEAREST ||
+                     MinFilter == GL_NEAREST_MIPMAP_LINEAR || MinFilter == GL_LINEAR_MIPMAP_NEAREST;
+
+    for (Page &AtlasPage : Pages)
+    {
+        if (!AtlasPage.Dirty)
+            continue;
+        if (Mipmapped)
+        {
+            glBindTexture(GL_TEXTURE_2D, AtlasPage.TextureID);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        AtlasPage.Dirty = false;
+    }
+}
+
+bool Engine::TextureAtlas::IsValid(Handle Index) const
+{
+    return Index >= 0 && Index < static_cast<Handle>(Entries.size()) && Entries[Index].Alive;
+}
+
+glm::vec4 Engine::TextureAtlas::GetUV(Handle Index) const
+{
+    if (!IsValid(Index) || Entries[Index].Page < 0)
+        return glm::vec4(0.0f);
+
+    // Rows are stored as given, so like a texture loaded with a vertical flip the top edge is the larger V
+    const Entry &Item = Entries[Index];
+    float Scale = 1.0f / PageSize;
+    return glm::vec4(Item.Position.x * Scale, (Item.Position.y + Item.Size.y) * Scale,
+                     (Item.Position.x + Item.Size.x) * Scale, Item.Position.y * Scale);
+}
+
+unsigned int Engine::TextureAtlas::GetTexture(Handle Index) const
+{
+    if (!IsValid(Index) || Entries[Index].Page < 0)
+        return 0;
+    return Pages[Entries[Index].Page].TextureID;
+}
+
+unsigned int Engine::TextureAtlas::GetPageTexture(int PageIndex) const
+{
+    return (PageIndex >= 0 && PageIndex < static_cast<int>(Pages.size())) ? Pages[PageIndex].TextureID : 0;
+}
+
+int Engine::TextureAtlas::GetPageCount() const
+{
+    return static_cast<int>(Pages.size());
+}
+
+float Engine::TextureAtlas::GetOccupancy(int PageIndex) const
+{
+    if (PageIndex < 0 || PageIndex >= static_cast<int>(Pages.size()))
+        return 0.0f;
+    return static_cast<float>(Pages[PageIndex].LiveArea) / (static_cast<float>(PageSize) * PageSize);
+}
+
+unsigned int Engine::TextureAtlas::GetVersion() const
+{
+    return Version;
+}
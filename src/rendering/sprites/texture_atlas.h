@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef texture_atlas_h
+#define texture_atlas_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+#include "../../util/util.h"
+#include "../../util/skyline_packer.h"
+
+namespace Engine
+{
+    // Packs small textures into shared RGBA pages so sprites from different images can batch together.
+    // Each entry is surrounded by extruded border texels and placed on an aligned grid, and the page mip
+    // chain is capped so sampling never bleeds into a neighbour. Entries keep a CPU copy, which allows
+    // removing (evicting) entries and repacking the pages to reclaim the holes they leave.
+    class TextureAtlas
+    {
+    public:
+        using Handle = int;
+
+        TextureAtlas(int PageSize = 2048, int Padding = 4, int MaxPages = 4,
+                     GLint MinFilter = GL_LINEAR_MIPMAP_LINEAR, GLint MagFilter = GL_LINEAR);
+        ~TextureAtlas();
+
+        // Takes the same image data as Util::LoadTextureFromData, returns -1 if it does not fit
+        Handle Insert(const unsigned char *Data, int Width, int Height, int NumChannels);
+        Handle InsertFromFile(const std::string &Path);
+        void Remove(Handle Entry);
+        // Returns false and keeps the current layout when the live entries would not all fit
+        bool Repack();
+
+        // Regenerates mipmaps of pages that changed since the last call, once per frame is enough
+        void Update();
+
+        bool IsValid(Handle Entry) const;
+        // Remapped UVs in the Sprite::SetUV layout (left, top, right, bottom)
+        glm::vec4 GetUV(Handle Entry) const;
+        unsigned int GetTexture(Handle Entry) const;
+        unsigned int GetPageTexture(int Page) const;
+        int GetPageCount() const;
+        float GetOccupancy(int Page) const;
+        // Incremented whenever a repack moves entries, UVs fetched earlier must be refreshed
+        unsigned int GetVersion() const;
+
+    private:
+        struct Entry
+        {
+            bool Alive = false;
+            int Page = -1;
+            glm::ivec2 Position = glm::ivec2(0);
+            glm::ivec2 Size = glm::ivec2(0);
+            TaggedVector<unsigned char, MemoryTracker::Tag::Textures> Pixels; // Tightly packed RGBA
+        };
+
+        struct Page
+        {
+            unsigned int TextureID = 0;
+            SkylinePacker Packer;
+            long long LiveArea = 0;
+            bool Dirty = false;
+
+            Page(int Size) : Packer(Size, Size) {}
+        };
+
+        int PageSize;
+        int Padding;
+        int Alignment;
+        int MaxPages;
+        GLint MinFilter;
+        GLint MagFilter;
+        unsigned int Version = 0;
+
+        std::vector<Page> Pages;
+        std::vector<Entry> Entries;
+        std::vector<Handle> FreeHandles;
+
+        glm::ivec2 GetPaddedSize(const glm::ivec2 &Size) const;
+        bool Place(Handle Entry);
+        void Upload(const Entry &Item);
+        int AddPage();
+    };
+};
+
+#endif
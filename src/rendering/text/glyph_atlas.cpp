@@ -0,0 +1,299 @@
+#include "glyph_atlas.h"
+
+#ifdef ENGINE_FREETYPE
+#include FT_MODULE_H
+#endif
+
+Engine::GlyphAtlas::GlyphAtlas(const std::string &FontPath, unsigned int PixelSize, int AtlasSize, int Spread)
+    : PixelSize(PixelSize), AtlasSize(AtlasSize), Spread(Spread), Packer(AtlasSize, AtlasSize)
+{
+#ifdef ENGINE_FREETYPE
+    std::filesystem::path FullPath = Util::GetAssetPath(FontPath);
+
+    if (FT_Init_FreeType(&Library))
+    {
+        std::cerr << "GlyphAtlas: Failed to initialize FreeType" << std::endl;
+        return;
+    }
+
+    if (FT_New_Face(Library, FullPath.string().c_str(), 0, &Face))
+    {
+        std::cerr << "GlyphAtlas: Failed to load font: " << FullPath << std::endl;
+        return;
+    }
+
+    FT_Set_Pixel_Sizes(Face, 0, PixelSize);
+    FT_Property_Set(Library, "sdf", "spread", &this->Spread);
+    Ascender = Face->size->metrics.ascender / 64.0f;
+    LineHeight = Face->size->metrics.height / 64.0f;
+
+    std::vector<unsigned char> Clear(static_cast<size_t>(AtlasSize) * AtlasSize, 0);
+    glGenTextures(1, &TextureID);
+    glBindTexture(GL_TEXTURE_2D, TextureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, AtlasSize, AtlasSize, 0, GL_RED, GL_UNSIGNED_BYTE, Clear.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, TextureID, MemoryTracker::GpuOwner::Text, MemoryTracker::GetTextureSize(GL_R8, AtlasSize, AtlasSize));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    Loaded = true;
+    Running = true;
+    Worker = std::thread(&GlyphAtlas::WorkerLoop, this);
+    std::cout << "Loaded font: " << FontPath << std::endl;
+#else
+    std::cerr << "GlyphAtlas: Engine was built without FreeType, cannot load " << FontPath << std::endl;
+#endif
+}
+
+Engine::GlyphAtlas::~GlyphAtlas()
+{
+    if (Running)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(QueueMutex);
+            Running = false;
+        }
+        QueueCondition.notify_all();
+        Worker.join();
+    }
+
+#ifdef ENGINE_FREETYPE
+    if (Face)
+        FT_Done_Face(Face);
+    if (Library)
+        FT_Done_FreeType(Library);
+#endif
+
+    if (TextureID)
+        Util::UnloadTexture(TextureID);
+}
+
+bool Engine::GlyphAtlas::IsLoaded() const
+{
+    return Loaded;
+}
+
+const Engine::GlyphAtlas::Glyph *Engine::GlyphAtlas::GetGlyph(uint32_t Codepoint)
+{
+    if (!Loaded || Codepoint > 0x10FFFF)
+        return nullptr;
+
+    int *Entry = nullptr;
+    if (Codepoint < FlatTableSize)
+    {
+        if (Codepoint >= GlyphTable.size())
+            GlyphTable.resize(Codepoint + 1, -1);
+        Entry = &GlyphTable[Codepoint];
+    }
+    else
+        Entry = &HighGlyphs.emplace(Codepoint, -1).first->second;
+
+    int Slot = *Entry;
+    if (Slot < 0)
+    {
+        Slot = static_cast<int>(Glyphs.size());
+        *Entry = Slot;
+        Glyphs.emplace_back();
+        {
+            std::lock_guard<std::mutex> Lock(QueueMutex);
+            Requests.push_back({Slot, Codepoint});
+        }
+        QueueCondition.notify_one();
+        return nullptr;
+    }
+
+    return Glyphs[Slot].Ready ? &Glyphs[Slot] : nullptr;
+}
+
+float Engine::GlyphAtlas::GetKerning([[maybe_unused]] uint32_t Left, [[maybe_unused]] uint32_t Right)
+{
+#ifdef ENGINE_FREETYPE
+    if (!Loaded || !FT_HAS_KERNING(Face))
+        return 0.0f;
+
+    uint64_t Key = (static_cast<uint64_t>(Left) << 32) | Right;
+    auto It = KerningCache.find(Key);
+    if (It != KerningCache.end())
+        return It->second;
+
+    const Glyph *LeftGlyph = GetGlyph(Left);
+    const Glyph *RightGlyph = GetGlyph(Right);
+    if (!LeftGlyph || !RightGlyph)
+        return 0.0f;
+
+    FT_Vector Delta = {0, 0};
+    {
+        std::lock_guard<std::mutex> Lock(FaceMutex);
+        FT_Get_Kerning(Face, LeftGlyph->GlyphIndex, RightGlyph->GlyphIndex, FT_KERNING_UNFITTED, &Delta);
+    }
+
+    float Kerning = Delta.x / 64.0f;
+    KerningCache[Key] = Kerning;
+    return Kerning;
+#else
+    return 0.0f;
+#endif
+}
+
+void Engine::GlyphAtlas::Update()
+{
+    std::vector<Result> Finished;
+    {
+        std::lock_guard<std::mutex> Lock(QueueMutex);
+        if (Results.empty())
+            return;
+        Finished.swap(Results);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, TextureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (Result &Glyph : Finished)
+    {
+        if (!Glyph.Pixels.empty())
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, Glyph.Position.x, Glyph.Position.y, Glyph.BitmapSize.x, Glyph.BitmapSize.y,
+                            GL_RED, GL_UNSIGNED_BYTE, Glyph.Pixels.data());
+        }
+        Glyphs[Glyph.Slot] = Glyph.Metrics;
+        Glyphs[Glyph.Slot].Ready = true;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    ++Version;
+}
+
+void Engine::GlyphAtlas::WorkerLoop()
+{
+    while (true)
+    {
+        Request Job;
+        {
+            std::unique_lock<std::mutex> Lock(QueueMutex);
+            QueueCondition.wait(Lock, [this]
+                                { return !Running || !Requests.empty(); });
+            if (!Running)
+                return;
+            Job = Requests.front();
+            Requests.pop_front();
+        }
+
+        Result Output;
+        Output.Slot = Job.Slot;
+        if (!Rasterize(Job, Output))
+            Output.Pixels.clear();
+
+        std::lock_guard<std::mutex> Lock(QueueMutex);
+        Results.push_back(std::move(Output));
+    }
+}
+
+bool Engine::GlyphAtlas::Rasterize([[maybe_unused]] const Request &Job, [[maybe_unused]] Result &Output)
+{
+#ifdef ENGINE_FREETYPE
+    {
+        std::lock_guard<std::mutex> Lock(FaceMutex);
+
+        FT_UInt Index = FT_Get_Char_Index(Face, Job.Codepoint);
+        if (FT_Load_Glyph(Face, Index, FT_LOAD_DEFAULT))
+        {
+            std::cerr << "GlyphAtlas: Failed to load glyph U+" << std::hex << Job.Codepoint << std::dec << std::endl;
+            return false;
+        }
+
+        FT_GlyphSlot Slot = Face->glyph;
+        Output.Metrics.GlyphIndex = Index;
+        Output.Metrics.Advance = Slot->advance.x / 64.0f;
+
+        // Whitespace has no outline to render, only an advance
+        if (Slot->outline.n_points == 0)
+            return true;
+        if (FT_Render_Glyph(Slot, FT_RENDER_MODE_SDF))
+        {
+            std::cerr << "GlyphAtlas: Failed to render glyph U+" << std::hex << Job.Codepoint << std::dec << std::endl;
+            return false;
+        }
+
+        const FT_Bitmap &Bitmap = Slot->bitmap;
+        Output.BitmapSize = glm::ivec2(Bitmap.width, Bitmap.rows);
+        Output.Metrics.Size = glm::vec2(Output.BitmapSize);
+        Output.Metrics.Bearing = glm::vec2(Slot->bitmap_left, Slot->bitmap_top);
+        Output.Pixels.resize(static_cast<size_t>(Bitmap.width) * Bitmap.rows);
+
+        for (unsigned int Row = 0; Row < Bitmap.rows; ++Row)
+        {
+            const unsigned char *Source = Bitmap.buffer + static_cast<long>(Row) * Bitmap.pitch;
+            std::copy(Source, Source + Bitmap.width, Output.Pixels.begin() + static_cast<size_t>(Row) * Bitmap.width);
+        }
+    }
+
+    if (Output.Pixels.empty())
+        return true;
+
+    // One texel of padding keeps bilinear filtering from bleeding between neighbouring glyphs
+    if (!Packer.Pack(Output.BitmapSize.x + 1, Output.BitmapSize.y + 1, Output.Position))
+    {
+        std::cerr << "GlyphAtlas: Atlas is full, dropping glyph U+" << std::hex << Job.Codepoint << std::dec << std::endl;
+        Output.Metrics.Size = glm::vec2(0.0f);
+        return false;
+    }
+
+    float Scale = 1.0f / AtlasSize;
+    Output.Metrics.UV = glm::vec4(Output.Position.x * Scale, Output.Position.y * Scale,
+                                  (Output.Position.x + Output.BitmapSize.x) * Scale,
+                                  (Output.Position.y + Output.BitmapSize.y) * Scale);
+    return true;
+#else
+    return false;
+#endif
+}
+
+unsigned int Engine::GlyphAtlas::GetTexture() const
+{
+    return TextureID;
+}
+
+unsigned int Engine::GlyphAtlas::GetPixelSize() const
+{
+    return PixelSize;
+}
+
+float Engine::GlyphAtlas::GetAscender() const
+{
+    return Ascender;
+}
+
+float Engine::GlyphAtlas::GetLineHeight() const
+{
+    return LineHeight;
+}
+
+unsigned int Engine::GlyphAtlas::GetVersion() const
+{
+    return Version;
+}
+
+uint32_t Engine::GlyphAtlas::DecodeUTF8(const std::string &Text, size_t &Index)
+{
+    unsigned char Lead = static_cast<unsigned char>(Text[Index++]);
+    // A continuation byte without a lead, or a lead no valid sequence starts with
+    if ((Lead >= 0x80 && Lead < 0xC0) || Lead >= 0xF8)
+        return 0xFFFD;
+
+    int Extra = (Lead >= 0xF0) ? 3 : (Lead >= 0xE0) ? 2 : (Lead >= 0xC0) ? 1 : 0;
+    uint32_t Codepoint = (Extra == 3) ? (Lead & 0x07) : (Extra == 2) ? (Lead & 0x0F) : (Extra == 1) ? (Lead & 0x1F) : Lead;
+
+    for (int i = 0; i < Extra; ++i)
+    {
+        // Truncated by the end of the text
+        if (Index >= Text.size())
+            return 0xFFFD;
+        unsigned char Next = static_cast<unsigned char>(Text[Index]);
+        if ((Next & 0xC0) != 0x80)
+            return 0xFFFD;
+        Codepoint = (Codepoint << 6) | (Next & 0x3F);
+        ++Index;
+    }
+    return Codepoint;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef glyph_atlas_h
+#define glyph_atlas_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <condition_variable>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../../util/util.h"
+#include "../../util/skyline_packer.h"
+
+// Defined by the build scripts when they link FreeType, so the headers and the library always agree
+#ifdef ENGINE_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+namespace Engine
+{
+    // Signed distance field glyph cache. Glyphs are rasterized by FreeType on a worker thread the first
+    // time they are requested, packed into a single-channel atlas and uploaded on the GL thread by Update().
+    // All metrics are in atlas pixels, so one atlas serves every text size.
+    class GlyphAtlas
+    {
+    public:
+        struct Glyph
+        {
+            glm::vec4 UV = glm::vec4(0.0f); // Same layout as Sprite::SetUV (left, top, right, bottom)
+            glm::vec2 Size = glm::vec2(0.0f);
+            glm::vec2 Bearing = glm::vec2(0.0f);
+            float Advance = 0.0f;
+            unsigned int GlyphIndex = 0;
+            bool Ready = false;
+        };
+
+        GlyphAtlas(const std::string &FontPath, unsigned int PixelSize = 48, int AtlasSize = 1024, int Spread = 6);
+        ~GlyphAtlas();
+
+        bool IsLoaded() const;
+
+        // Returns nullptr while the glyph is still being rasterized
+        const Glyph *GetGlyph(uint32_t Codepoint);
+        float GetKerning(uint32_t Left, uint32_t Right);
+        void Update();
+
+        unsigned int GetTexture() const;
+        unsigned int GetPixelSize() const;
+        float GetAscender() const;
+        float GetLineHeight() const;
+        unsigned int GetVersion() const;
+
+        // Malformed sequences decode to U+FFFD
+        static uint32_t DecodeUTF8(const std::string &Text, size_t &Index);
+
+    private:
+        struct Request
+        {
+            int Slot;
+            uint32_t Codepoint;
+        };
+
+        struct Result
+        {
+            int Slot;
+            Glyph Metrics;
+            glm::ivec2 Position;
+            glm::ivec2 BitmapSize;
+            TaggedVector<unsigned char, MemoryTracker::Tag::Text> Pixels;
+        };
+
+        unsigned int PixelSize;
+        int AtlasSize;
+        int Spread;
+        unsigned int TextureID = 0;
+        unsigned int Version = 0;
+        float Ascender = 0.0f;
+        float LineHeight = 0.0f;
+        bool Loaded = false;
+
+        // Codepoints below FlatTableSize index into Glyphs through the flat table, -1 when the codepoint has
+        // never been requested. Rarer ones above it go through the map, so they do not grow the table
+        static constexpr uint32_t FlatTableSize = 0x3000;
+        std::vector<int> GlyphTable;
+        std::unordered_map<uint32_t, int> HighGlyphs;
+        std::vector<Glyph> Glyphs;
+        std::unordered_map<uint64_t, float> KerningCache;
+
+        SkylinePacker Packer;
+
+        std::thread Worker;
+        std::mutex QueueMutex;
+        std::condition_variable QueueCondition;
+        std::deque<Request> Requests;
+        std::vector<Result> Results;
+        std::atomic<bool> Running{false};
+
+#ifdef ENGINE_FREETYPE
+        FT_Library Library = nullptr;
+        FT_Face Face = nullptr;
+        std::mutex FaceMutex;
+#endif
+
+        void WorkerLoop();
+        bool Rasterize(const Request &Job, Result &Output);
+    };
+};
+
+#endif
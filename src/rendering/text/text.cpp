@@ -2,115 +2,81 @@
 
 namespace Engine
 {
+    namespace
+    {
+        constexpr size_t FloatsPerVertex = 11;
+        constexpr size_t FloatsPerGlyph = FloatsPerVertex * 4;
+
+        void SetupGlyphVertexArray(unsigned int VAO, unsigned int VBO, unsigned int EBO)
+        {
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void *)0);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void *)(3 * sizeof(float)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void *)(5 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void *)(8 * sizeof(float)));
+            glEnableVertexAttribArray(3);
+
+            glBindVertexArray(0);
+        }
+
+        // Uploads vertices into VBO, growing its storage (or orphaning it) so the driver never waits on the previous draw
+        void StreamVertices(unsigned int VBO, const Text::VertexBuffer &Vertices, size_t &Capacity)
+        {
+            size_t Size = Vertices.size() * sizeof(float);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            if (Size > Capacity)
+                Capacity = std::max(Size, Capacity * 2);
+            glBufferData(GL_ARRAY_BUFFER, Capacity, nullptr, GL_STREAM_DRAW);
+            MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, VBO, MemoryTracker::GpuOwner::Text, Capacity);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, Size, Vertices.data());
+        }
+    }
+
     Text::Text(Material *material, const glm::vec2 &position, float scale, unsigned int *screenWidth, unsigned int *screenHeight)
         : MaterialInstance(material), Position(position), Scale(scale), ScreenWidth(screenWidth), ScreenHeight(screenHeight)
     {
         SetCharacterMap();
         SetCharacterUVs();
-        SpriteRenderer = new Sprite(MaterialInstance, Position, glm::vec2(Scale, Scale), ScreenWidth, ScreenHeight);
+        MaterialInstance->EnableKeyword("USE_TEXTURE");
+        CreateBuffers();
+    }
+
+    Text::Text(Material *material, GlyphAtlas *atlas, const glm::vec2 &position, float scale, unsigned int *screenWidth, unsigned int *screenHeight)
+        : MaterialInstance(material), Position(position), Scale(scale), ScreenWidth(screenWidth), ScreenHeight(screenHeight), Atlas(atlas)
+    {
+        MaterialInstance->SetTexture(0, Atlas->GetTexture());
+        CreateBuffers();
+    }
+
+    void Text::CreateBuffers()
+    {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        SetupGlyphVertexArray(VAO, VBO, EBO);
     }
 
     Text::~Text()
     {
-        delete SpriteRenderer;
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, VBO);
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, EBO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
     }
+
     void Text::SetCharacterMap()
     {
-        CharacterMap[" "] = 0;
-        CharacterMap["!"] = 1;
-        CharacterMap["\""] = 2;
-        CharacterMap["#"] = 3;
-        CharacterMap["$"] = 4;
-        CharacterMap["%"] = 5;
-        CharacterMap["&"] = 6;
-        CharacterMap["'"] = 7;
-        CharacterMap["("] = 8;
-        CharacterMap[")"] = 9;
-        CharacterMap["*"] = 10;
-        CharacterMap["+"] = 11;
-        CharacterMap[","] = 12;
-        CharacterMap["-"] = 13;
-        CharacterMap["."] = 14;
-        CharacterMap["/"] = 15;
-        CharacterMap["0"] = 16;
-        CharacterMap["1"] = 17;
-        CharacterMap["2"] = 18;
-        CharacterMap["3"] = 19;
-        CharacterMap["4"] = 20;
-        CharacterMap["5"] = 21;
-        CharacterMap["6"] = 22;
-        CharacterMap["7"] = 23;
-        CharacterMap["8"] = 24;
-        CharacterMap["9"] = 25;
-        CharacterMap[":"] = 26;
-        CharacterMap[";"] = 27;
-        CharacterMap["<"] = 28;
-        CharacterMap["="] = 29;
-        CharacterMap[">"] = 30;
-        CharacterMap["?"] = 31;
-        CharacterMap["@"] = 32;
-        CharacterMap["A"] = 33;
-        CharacterMap["B"] = 34;
-        CharacterMap["C"] = 35;
-        CharacterMap["D"] = 36;
-        CharacterMap["E"] = 37;
-        CharacterMap["F"] = 38;
-        CharacterMap["G"] = 39;
-        CharacterMap["H"] = 40;
-        CharacterMap["I"] = 41;
-        CharacterMap["J"] = 42;
-        CharacterMap["K"] = 43;
-        CharacterMap["L"] = 44;
-        CharacterMap["M"] = 45;
-        CharacterMap["N"] = 46;
-        CharacterMap["O"] = 47;
-        CharacterMap["P"] = 48;
-        CharacterMap["Q"] = 49;
-        CharacterMap["R"] = 50;
-        CharacterMap["S"] = 51;
-        CharacterMap["T"] = 52;
-        CharacterMap["U"] = 53;
-        CharacterMap["V"] = 54;
-        CharacterMap["W"] = 55;
-        CharacterMap["X"] = 56;
-        CharacterMap["Y"] = 57;
-        CharacterMap["Z"] = 58;
-        CharacterMap["["] = 59;
-        CharacterMap["\\"] = 60;
-        CharacterMap["]"] = 61;
-        CharacterMap["^"] = 62;
-        CharacterMap["_"] = 63;
-        CharacterMap["`"] = 64;
-        CharacterMap["a"] = 65;
-        CharacterMap["b"] = 66;
-        CharacterMap["c"] = 67;
-        CharacterMap["d"] = 68;
-        CharacterMap["e"] = 69;
-        CharacterMap["f"] = 70;
-        CharacterMap["g"] = 71;
-        CharacterMap["h"] = 72;
-        CharacterMap["i"] = 73;
-        CharacterMap["j"] = 74;
-        CharacterMap["k"] = 75;
-        CharacterMap["l"] = 76;
-        CharacterMap["m"] = 77;
-        CharacterMap["n"] = 78;
-        CharacterMap["o"] = 79;
-        CharacterMap["p"] = 80;
-        CharacterMap["q"] = 81;
-        CharacterMap["r"] = 82;
-        CharacterMap["s"] = 83;
-        CharacterMap["t"] = 84;
-        CharacterMap["u"] = 85;
-        CharacterMap["v"] = 86;
-        CharacterMap["w"] = 87;
-        CharacterMap["x"] = 88;
-        CharacterMap["y"] = 89;
-        CharacterMap["z"] = 90;
-        CharacterMap["{"] = 91;
-        CharacterMap["|"] = 92;
-        CharacterMap["}"] = 93;
-        CharacterMap["~"] = 94;
+        // The grid font holds printable ASCII in order, starting with the space
+        CharacterMap.assign(128, -1);
+        for (int Character = ' '; Character <= '~'; ++Character)
+            CharacterMap[Character] = Character - ' ';
     }
 
     void Text::SetCharacterUVs()
@@ -134,56 +100,193 @@ namespace Engine
         }
     }
 
-    void Text::Render(const std::string &Text, TextAlign Alignment)
+    size_t Text::BuildGeometry(const std::string &Text, TextAlign Alignment, const glm::vec2 &Origin, float TextScale, VertexBuffer &Vertices) const
     {
+        if (Atlas)
+            return BuildAtlasGeometry(Text, Alignment, Origin, TextScale, Vertices);
+
+        size_t GlyphCount = 0;
         float YOffset = 0.0f;
-        std::vector<std::string> Lines;
-        std::stringstream Stream(Text);
-        std::string Line;
-    
-        while (std::getline(Stream, Line, '\n'))
-            Lines.push_back(Line);
-    
-        for (const std::string &Line : Lines)
+        size_t LineStart = 0;
+
+        while (LineStart <= Text.size())
         {
+            size_t LineEnd = Text.find('\n', LineStart);
+            if (LineEnd == std::string::npos)
+                LineEnd = Text.size();
+
             float LineWidth = 0.0f;
-            for (char Character : Line)
+            for (size_t i = LineStart; i < LineEnd; ++i)
             {
-                if (Character == ' ' || CharacterMap.count(std::string(1, Character)))
-                    LineWidth += Spacing * Scale;
+                unsigned char Character = static_cast<unsigned char>(Text[i]);
+                if (Character < CharacterMap.size() && CharacterMap[Character] >= 0)
+                    LineWidth += Spacing * TextScale;
             }
-    
+
             float XOffset = (Alignment == TextAlign::Right) ? -LineWidth :
                             (Alignment == TextAlign::Center) ? -LineWidth / 2 : 0.0f;
-    
-            for (char Character : Line)
+
+            for (size_t i = LineStart; i < LineEnd; ++i)
             {
+                unsigned char Character = static_cast<unsigned char>(Text[i]);
                 if (Character == ' ')
                 {
-                    XOffset += Spacing * Scale;
+                    XOffset += Spacing * TextScale;
                     continue;
                 }
-    
-                auto CharIt = CharacterMap.find(std::string(1, Character));
-                if (CharIt == CharacterMap.end())
+
+                if (Character >= CharacterMap.size() || CharacterMap[Character] < 0)
                 {
-                    std::cout << "Warning: Character '" << Character << "' not found in the CharacterMap!" << std::endl;
+                    std::cout << "Warning: Character '" << Text[i] << "' not found in the CharacterMap!" << std::endl;
                     Character = '?';
                 }
-    
-                glm::vec4 UV = CharUVs[CharacterMap[std::string(1, Character)]];
-                SpriteRenderer->SetSize(glm::vec2(Scale, Scale));
-                SpriteRenderer->SetPosition(Position + glm::vec2(XOffset, YOffset));
-                SpriteRenderer->SetUV(UV);
-                SpriteRenderer->Render();
-    
-                XOffset += Spacing * Scale;
+
+                const glm::vec4 &UV = CharUVs[CharacterMap[Character]];
+                glm::vec2 Min = Origin + glm::vec2(XOffset, YOffset);
+                glm::vec2 Max = Min + glm::vec2(TextScale, TextScale);
+
+                Vertices.insert(Vertices.end(), {
+                    // Position             // UV        // Normal          // Color
+                    Max.x, Min.y, 0.0f,     UV.z, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f, // Top-right
+                    Max.x, Max.y, 0.0f,     UV.z, UV.w,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f, // Bottom-right
+                    Min.x, Max.y, 0.0f,     UV.x, UV.w,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f, // Bottom-left
+                    Min.x, Min.y, 0.0f,     UV.x, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f  // Top-left
+                });
+                ++GlyphCount;
+
+                XOffset += Spacing * TextScale;
+            }
+
+            YOffset += Lineheight * TextScale;
+            LineStart = LineEnd + 1;
+        }
+
+        return GlyphCount;
+    }
+
+    size_t Text::BuildAtlasGeometry(const std::string &Text, TextAlign Alignment, const glm::vec2 &Origin, float TextScale, VertexBuffer &Vertices) const
+    {
+        size_t GlyphCount = 0;
+        float PixelScale = TextScale / Atlas->GetPixelSize();
+        float YOffset = 0.0f;
+        size_t LineStart = 0;
+
+        // Walks one line, calling Emit with the pen position of every ready glyph, returns the line width
+        auto WalkLine = [&](size_t Begin, size_t End, auto &&Emit)
+        {
+            float Pen = 0.0f;
+            uint32_t Previous = 0;
+            size_t Index = Begin;
+            while (Index < End)
+            {
+                uint32_t Codepoint = GlyphAtlas::DecodeUTF8(Text, Index);
+                const GlyphAtlas::Glyph *Glyph = Atlas->GetGlyph(Codepoint);
+                if (!Glyph)
+                    continue;
+
+                if (Previous)
+                    Pen += Atlas->GetKerning(Previous, Codepoint) * PixelScale;
+                Emit(*Glyph, Pen);
+                Pen += Glyph->Advance * PixelScale;
+                Previous = Codepoint;
+            }
+            return Pen;
+        };
+
+        while (LineStart <= Text.size())
+        {
+            size_t LineEnd = Text.find('\n', LineStart);
+            if (LineEnd == std::string::npos)
+                LineEnd = Text.size();
+
+            float LineWidth = WalkLine(LineStart, LineEnd, [](const GlyphAtlas::Glyph &, float) {});
+            float XOffset = (Alignment == TextAlign::Right) ? -LineWidth :
+                            (Alignment == TextAlign::Center) ? -LineWidth / 2 : 0.0f;
+            float Baseline = Origin.y + YOffset + Atlas->GetAscender() * PixelScale;
+
+            WalkLine(LineStart, LineEnd, [&](const GlyphAtlas::Glyph &Glyph, float Pen)
+            {
+                if (Glyph.Size.x <= 0.0f)
+                    return;
+
+                const glm::vec4 &UV = Glyph.UV;
+                glm::vec2 Min = glm::vec2(Origin.x + XOffset + Pen + Glyph.Bearing.x * PixelScale, Baseline - Glyph.Bearing.y * PixelScale);
+                glm::vec2 Max = Min + Glyph.Size * PixelScale;
+
+                Vertices.insert(Vertices.end(), {
+                    Max.x, Min.y, 0.0f,     UV.z, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f,
+                    Max.x, Max.y, 0.0f,     UV.z, UV.w,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f,
+                    Min.x, Max.y, 0.0f,     UV.x, UV.w,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f,
+                    Min.x, Min.y, 0.0f,     UV.x, UV.y,   0.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f
+                });
+                ++GlyphCount;
+            });
+
+            YOffset += Lineheight * Atlas->GetLineHeight() * PixelScale;
+            LineStart = LineEnd + 1;
+        }
+
+        return GlyphCount;
+    }
+
+    unsigned int Text::GetIndexBuffer(size_t GlyphCount)
+    {
+        if (GlyphCount > IndexCapacity)
+        {
+            size_t NewCapacity = std::max<size_t>(GlyphCount, std::max<size_t>(IndexCapacity * 2, 256));
+            std::vector<unsigned int> Indices;
+            Indices.reserve(NewCapacity * 6);
+            for (unsigned int i = 0; i < NewCapacity; ++i)
+            {
+                unsigned int Base = i * 4;
+                Indices.insert(Indices.end(), {Base + 0, Base + 1, Base + 3, Base + 1, Base + 2, Base + 3});
             }
-    
-            YOffset += Lineheight * Scale;
+
+            // Reallocating the same buffer name keeps every VAO that references it valid
+            glBindVertexArray(0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(unsigned int), Indices.data(), GL_STATIC_DRAW);
+            MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Buffer, EBO, MemoryTracker::GpuOwner::Text, Indices.size() * sizeof(unsigned int));
+            IndexCapacity = NewCapacity;
         }
+        return EBO;
+    }
+
+    void Text::Draw(unsigned int GlyphVAO, size_t GlyphCount)
+    {
+        if (GlyphCount == 0 || *ScreenHeight == 0)
+            return;
+
+        glm::mat4 Projection = glm::ortho(
+            0.0f, static_cast<float>(*ScreenWidth),
+            static_cast<float>(*ScreenHeight), 0.0f,
+            -1.0f, 1.0f);
+
+        if (!MaterialInstance->Bind())
+            return;
+        MaterialInstance->SetUniform("Model", glm::mat4(1.0f));
+        MaterialInstance->SetUniform("View", glm::mat4(1.0f));
+        MaterialInstance->SetUniform("Projection", Projection);
+
+        glBindVertexArray(GlyphVAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(GlyphCount * 6), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(0);
+    }
+
+    void Text::Render(const std::string &Text, TextAlign Alignment)
+    {
+        UpdateAtlas();
+        // Every byte yields at most one glyph, so the geometry is built without reallocating
+        Vertices.clear();
+        Vertices.reserve(Text.size() * FloatsPerGlyph);
+        size_t GlyphCount = BuildGeometry(Text, Alignment, Position, Scale, Vertices);
+        if (GlyphCount == 0)
+            return;
+
+        GetIndexBuffer(GlyphCount);
+        StreamVertices(VBO, Vertices, VertexCapacity);
+        Draw(VAO, GlyphCount);
     }
-    
 
     void Text::SetPosition(const glm::vec2 &position) { Position = position; }
     void Text::SetScale(float scale) { Scale = scale; }
@@ -193,4 +296,95 @@ namespace Engine
     float Text::GetScale() const { return Scale; }
     float Text::GetSpacing() const { return Spacing; }
     float Text::GetLineheight() const { return Lineheight; }
+    Material *Text::GetMaterial() const { return MaterialInstance; }
+    GlyphAtlas *Text::GetAtlas() const { return Atlas; }
+
+    unsigned int Text::UpdateAtlas()
+    {
+        if (!Atlas)
+            return 0;
+        Atlas->Update();
+        return Atlas->GetVersion();
+    }
+
+    TextBlock::TextBlock(Text *font, const std::string &text, Text::TextAlign alignment)
+        : Font(font), String(text), Alignment(alignment)
+    {
+        Position = Font->GetPosition();
+        Scale = Font->GetScale();
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        SetupGlyphVertexArray(VAO, VBO, Font->GetIndexBuffer(0));
+    }
+
+    TextBlock::~TextBlock()
+    {
+        MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Buffer, VBO);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+    }
+
+    void TextBlock::Rebuild()
+    {
+        Vertices.clear();
+        Vertices.reserve(String.size() * FloatsPerGlyph);
+        GlyphCount = Font->BuildGeometry(String, Alignment, Position, Scale, Vertices);
+        Font->GetIndexBuffer(GlyphCount);
+        if (GlyphCount > 0)
+            StreamVertices(VBO, Vertices, VertexCapacity);
+        Dirty = false;
+    }
+
+    void TextBlock::Render()
+    {
+        // Glyphs that were still rasterizing during the last rebuild show up as a new atlas version
+        unsigned int Version = Font->UpdateAtlas();
+        if (Dirty || Version != AtlasVersion)
+        {
+            AtlasVersion = Version;
+            Rebuild();
+        }
+        Font->Draw(VAO, GlyphCount);
+    }
+
+    void TextBlock::SetText(std::string_view text)
+    {
+        if (String != text)
+        {
+            String.assign(text.data(), text.size());
+            Dirty = true;
+        }
+    }
+
+    void TextBlock::SetPosition(const glm::vec2 &position)
+    {
+        if (Position != position)
+        {
+            Position = position;
+            Dirty = true;
+        }
+    }
+
+    void TextBlock::SetScale(float scale)
+    {
+        if (Scale != scale)
+        {
+            Scale = scale;
+            Dirty = true;
+        }
+    }
+
+    void TextBlock::SetAlignment(Text::TextAlign alignment)
+    {
+        if (Alignment != alignment)
+        {
+            Alignment = alignment;
+            Dirty = true;
+        }
+    }
+
+    const std::string &TextBlock::GetText() const { return String; }
+    glm::vec2 TextBlock::GetPosition() const { return Position; }
+    float TextBlock::GetScale() const { return Scale; }
 }
@@ -5,12 +5,13 @@
 #define NOMINMAX
 #include <algorithm>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <iostream>
-#include "../sprites/sprite.h"
 #include "../materials/material.h"
-#include <unordered_map>
+#include "glyph_atlas.h"
 
 namespace Engine
 {
@@ -18,10 +19,13 @@ namespace Engine
     {
     public:
         enum class TextAlign { Left, Center, Right };
-        Sprite *SpriteRenderer;
+        using VertexBuffer = TaggedVector<float, MemoryTracker::Tag::Text>;
         Text(Material *material, const glm::vec2 &position, float scale, unsigned int *screenWidth, unsigned int *screenHeight);
+        // Lays text out with the atlas' real metrics and kerning, the material should use an SDF fragment shader
+        Text(Material *material, GlyphAtlas *atlas, const glm::vec2 &position, float scale, unsigned int *screenWidth, unsigned int *screenHeight);
         ~Text();
 
+        // Lays out and draws the whole string with a single draw call through a streamed vertex buffer
         void Render(const std::string &text, TextAlign alignment);
         void SetCharacterMap();
         void SetPosition(const glm::vec2 &position);
@@ -32,6 +36,17 @@ namespace Engine
         float GetScale() const;
         float GetSpacing() const;
         float GetLineheight() const;
+        Material *GetMaterial() const;
+        GlyphAtlas *GetAtlas() const;
+        // Uploads glyphs the atlas finished since the last call, returns the atlas version
+        unsigned int UpdateAtlas();
+
+        // Appends one quad (4 vertices, 11 floats each) per visible glyph, returns the glyph count
+        size_t BuildGeometry(const std::string &text, TextAlign alignment, const glm::vec2 &position, float scale, VertexBuffer &vertices) const;
+        // Binds the material and screen-space matrices, then draws GlyphCount quads from the given VAO
+        void Draw(unsigned int vao, size_t glyphCount);
+        // Shared quad index buffer, grown on demand so every text VAO can reference it
+        unsigned int GetIndexBuffer(size_t glyphCount);
 
     private:
         Material *MaterialInstance;
@@ -42,11 +57,54 @@ namespace Engine
         unsigned int *ScreenWidth;
         unsigned int *ScreenHeight;
 
-        std::unordered_map<std::string, int> CharacterMap;
+        GlyphAtlas *Atlas = nullptr;
+
+        // Flat ASCII table indexing into CharUVs, -1 for characters missing from the grid font
+        std::vector<int> CharacterMap;
         std::vector<glm::vec4> CharUVs;
 
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        size_t VertexCapacity = 0;
+        size_t IndexCapacity = 0;
+        VertexBuffer Vertices;
+
         void SetCharacterUVs();
-        void CreateSprites();
+        void CreateBuffers();
+        size_t BuildAtlasGeometry(const std::string &text, TextAlign alignment, const glm::vec2 &position, float scale, VertexBuffer &vertices) const;
+    };
+
+    // Retained text whose geometry is rebuilt only when its string, position, scale or alignment change
+    class TextBlock
+    {
+    public:
+        TextBlock(Text *font, const std::string &text = "", Text::TextAlign alignment = Text::TextAlign::Left);
+        ~TextBlock();
+
+        void Render();
+
+        void SetText(std::string_view text);
+        void SetPosition(const glm::vec2 &position);
+        void SetScale(float scale);
+        void SetAlignment(Text::TextAlign alignment);
+        const std::string &GetText() const;
+        glm::vec2 GetPosition() const;
+        float GetScale() const;
+
+    private:
+        Text *Font;
+        std::string String;
+        Text::TextAlign Alignment;
+        glm::vec2 Position = glm::vec2(0.0f);
+        float Scale = 32;
+        bool Dirty = true;
+        unsigned int AtlasVersion = 0;
+
+        unsigned int VAO = 0, VBO = 0;
+        size_t VertexCapacity = 0;
+        size_t GlyphCount = 0;
+        Text::VertexBuffer Vertices;
+
+        void Rebuild();
     };
 };
 
@@ -0,0 +1,116 @@
+#include "skyline_packer.h"
+
+Engine::SkylinePacker::SkylinePacker(int Width, int Height)
+    : AtlasWidth(Width), AtlasHeight(Height)
+{
+    Reset();
+}
+
+void Engine::SkylinePacker::Reset()
+{
+    Skyline.clear();
+    Skyline.push_back({0, 0, AtlasWidth});
+    UsedArea = 0;
+}
+
+int Engine::SkylinePacker::Fit(size_t Index, int Width, int Height) const
+{
+    int X = Skyline[Index].X;
+    if (X + Width > AtlasWidth)
+        return -1;
+
+    int Y = Skyline[Index].Y;
+    int Remaining = Width;
+    while (Remaining > 0)
+    {
+        if (Index >= Skyline.size())
+            return -1;
+        Y = std::max(Y, Skyline[Index].Y);
+        if (Y + Height > AtlasHeight)
+            return -1;
+        Remaining -= Skyline[Index].Width;
+        ++Index;
+    }
+    return Y;
+}
+
+void Engine::SkylinePacker::AddLevel(size_t Index, int X, int Y, int Width, int Height)
+{
+    Skyline.insert(Skyline.begin() + Index, {X, Y + Height, Width});
+
+    // Shrink or remove the nodes now covered by the new level
+    for (size_t i = Index + 1; i < Skyline.size(); ++i)
+    {
+        Node &Previous = Skyline[i - 1];
+        Node &Current = Skyline[i];
+        if (Current.X >= Previous.X + Previous.Width)
+            break;
+
+        int Shrink = Previous.X + Previous.Width - Current.X;
+        Current.X += Shrink;
+        Current.Width -= Shrink;
+        if (Current.Width > 0)
+            break;
+
+        Skyline.erase(Skyline.begin() + i);
+        --i;
+    }
+
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < Skyline.size(); ++i)
+    {
+        if (Skyline[i].Y == Skyline[i + 1].Y)
+        {
+            Skyline[i].Width += Skyline[i + 1].Width;
+            Skyline.erase(Skyline.begin() + i + 1);
+            --i;
+        }
+    }
+}
+
+bool Engine::SkylinePacker::Pack(int Width, int Height, glm::ivec2 &OutPosition)
+{
+    if (Width <= 0 || Height <= 0)
+        return false;
+
+    int BestY = AtlasHeight, BestWidth = AtlasWidth + 1;
+    size_t BestIndex = Skyline.size();
+
+    for (size_t i = 0; i < Skyline.size(); ++i)
+    {
+        int Y = Fit(i, Width, Height);
+        if (Y < 0)
+            continue;
+
+        // Prefer the lowest position, then the narrowest segment to limit wasted space
+        if (BestIndex == Skyline.size() || Y < BestY || (Y == BestY && Skyline[i].Width < BestWidth))
+        {
+            BestY = Y;
+            BestWidth = Skyline[i].Width;
+            BestIndex = i;
+        }
+    }
+
+    if (BestIndex == Skyline.size())
+        return false;
+
+    OutPosition = glm::ivec2(Skyline[BestIndex].X, BestY);
+    AddLevel(BestIndex, OutPosition.x, OutPosition.y, Width, Height);
+    UsedArea += static_cast<long long>(Width) * Height;
+    return true;
+}
+
+int Engine::SkylinePacker::GetWidth() const
+{
+    return AtlasWidth;
+}
+
+int Engine::SkylinePacker::GetHeight() const
+{
+    return AtlasHeight;
+}
+
+float Engine::SkylinePacker::GetOccupancy() const
+{
+    return static_cast<float>(UsedArea) / (static_cast<float>(AtlasWidth) * AtlasHeight);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#ifndef skyline_packer_h
+#define skyline_packer_h
+
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+namespace Engine
+{
+    // Bottom-left skyline rectangle packer used by the runtime atlases
+    class SkylinePacker
+    {
+    public:
+        SkylinePacker(int Width, int Height);
+
+        bool Pack(int Width, int Height, glm::ivec2 &OutPosition);
+        void Reset();
+
+        int GetWidth() const;
+        int GetHeight() const;
+        float GetOccupancy() const;
+
+    private:
+        struct Node
+        {
+            int X, Y, Width;
+        };
+
+        int AtlasWidth;
+        int AtlasHeight;
+        long long UsedArea = 0;
+        std::vector<Node> Skyline;
+
+        int Fit(size_t Index, int Width, int Height) const;
+        void AddLevel(size_t Index, int X, int Y, int Width, int Height);
+    };
+};
+
+#endif
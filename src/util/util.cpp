@@ -1,50 +1,60 @@
 #include "util.h"
 
 std::string Engine::Util::GetExecutablePath() {
-    char path[MAX_PATH];
-    GetModuleFileNameA(nullptr, path, MAX_PATH);
-    return std::filesystem::path(path).parent_path().string();
+    return Platform::GetExecutablePath();
 }
 
+std::string Engine::Util::GetAssetPath(const std::string &Path) {
+    return Platform::ResolvePath(std::filesystem::path(GetExecutablePath()) / Path);
+}
 
-unsigned int Engine::Util::LoadTexture(std::string Path, GLint MinFilter, GLint MagFilter) {
-    std::filesystem::path FullPath = std::filesystem::path(Util::GetExecutablePath()) / Path;
-    std::string FullPathStr = FullPath.string();
-    const char* FullPathString = FullPathStr.c_str();
-    stbi_set_flip_vertically_on_load(true);
 
-    unsigned int TextureID;
-    glGenTextures(1, &TextureID);
-    glBindTexture(GL_TEXTURE_2D, TextureID);
+Engine::Util::TextureData Engine::Util::DecodeTexture(const std::string &Path) {
+    std::string FullPathStr = GetAssetPath(Path);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // The per-thread flag keeps concurrent decodes from racing on stb_image's global setting
+    stbi_set_flip_vertically_on_load_thread(true);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilter);
+    TextureData Data;
+    Data.Pixels = stbi_load(FullPathStr.c_str(), &Data.Width, &Data.Height, &Data.NumChannels, 0);
+    if (Data.Pixels)
+        MemoryTracker::TrackAllocation(MemoryTracker::Tag::Textures, static_cast<size_t>(Data.Width) * Data.Height * Data.NumChannels);
+    return Data;
+}
 
-    int Width, Height, NumChannels;
-    unsigned char* Data = stbi_load(FullPathString, &Width, &Height, &NumChannels, 0);
-    if (Data) {
-        GLenum Format = (NumChannels == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, Format, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Data);
+bool Engine::Util::GetTextureInfo(const std::string &Path, int &Width, int &Height, int &NumChannels) {
+    return stbi_info(GetAssetPath(Path).c_str(), &Width, &Height, &NumChannels) != 0;
+}
 
-        if (MinFilter == GL_LINEAR_MIPMAP_LINEAR || MinFilter == GL_NEAREST_MIPMAP_NEAREST ||
-            MinFilter == GL_NEAREST_MIPMAP_LINEAR || MinFilter == GL_LINEAR_MIPMAP_NEAREST) {
-            std::cout << "Generating Mipmipmap: " << Path << std::endl;
-            glGenerateMipmap(GL_TEXTURE_2D);
-        }
+void Engine::Util::FreeTextureData(TextureData &Data) {
+    if (Data.Pixels)
+        MemoryTracker::TrackFree(MemoryTracker::Tag::Textures, static_cast<size_t>(Data.Width) * Data.Height * Data.NumChannels);
+    stbi_image_free(Data.Pixels);
+    Data = TextureData();
+}
 
-        std::cout << "Loaded texture: " << Path << std::endl;
-    } else {
+unsigned int Engine::Util::LoadTexture(std::string Path, GLint MinFilter, GLint MagFilter) {
+    TextureData Data = DecodeTexture(Path);
+    if (!Data.Pixels) {
         std::cout << "Failed to load texture: " << Path << std::endl;
+        return 0;
     }
 
-    stbi_image_free(Data);
+    unsigned int TextureID = LoadTextureFromData(Data.Pixels, Data.Width, Data.Height, Data.NumChannels, MinFilter, MagFilter);
+    if (TextureID)
+        std::cout << "Loaded texture: " << Path << std::endl;
+    else
+        std::cout << "Failed to upload texture: " << Path << " (" << Data.NumChannels << " channels)" << std::endl;
+
+    FreeTextureData(Data);
     return TextureID;
 }
 
 unsigned int Engine::Util::LoadTextureFromData(const unsigned char* Data, int Width, int Height, int NumChannels, GLint MinFilter, GLint MagFilter) {
+    if (NumChannels < 1 || NumChannels > 4 || Width <= 0 || Height <= 0 || Data == nullptr) {
+        return 0;
+    }
+
     unsigned int TextureID;
     glGenTextures(1, &TextureID);
     glBindTexture(GL_TEXTURE_2D, TextureID);
@@ -55,17 +65,29 @@ unsigned int Engine::Util::LoadTextureFromData(const unsigned char* Data, int Wi
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, MinFilter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, MagFilter);
 
-    GLenum Format = (NumChannels == 4) ? GL_RGBA : GL_RGB;
-    if (NumChannels != 3 && NumChannels != 4 || Width <= 0 || Height <= 0 || Data == nullptr) {
-        return 0;
+    // Grayscale images stay one or two channels on the GPU and are swizzled to read like RGB(A), so .r and
+    // .a mean the same for every texture
+    static const GLenum Formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    static const GLenum InternalFormats[] = {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8};
+    GLenum Format = Formats[NumChannels - 1];
+    GLenum InternalFormat = InternalFormats[NumChannels - 1];
+    if (NumChannels <= 2) {
+        GLint Swizzle[] = {GL_RED, GL_RED, GL_RED, (NumChannels == 2) ? GL_GREEN : GL_ONE};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, Swizzle);
     }
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, Format, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Data);
 
-    if (MinFilter == GL_LINEAR_MIPMAP_LINEAR || MinFilter == GL_NEAREST_MIPMAP_NEAREST ||
-        MinFilter == GL_NEAREST_MIPMAP_LINEAR || MinFilter == GL_LINEAR_MIPMAP_NEAREST) {
+    // Rows of tightly packed 1-3 channel images are not 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, (NumChannels == 4) ? 4 : 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, InternalFormat, Width, Height, 0, Format, GL_UNSIGNED_BYTE, Data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    bool Mipmapped = MinFilter == GL_LINEAR_MIPMAP_LINEAR || MinFilter == GL_NEAREST_MIPMAP_NEAREST ||
+                     MinFilter == GL_NEAREST_MIPMAP_LINEAR || MinFilter == GL_LINEAR_MIPMAP_NEAREST;
+    if (Mipmapped) {
         glGenerateMipmap(GL_TEXTURE_2D);
     }
+    MemoryTracker::TrackGpu(MemoryTracker::GpuObject::Texture, TextureID, MemoryTracker::GpuOwner::Textures,
+                            MemoryTracker::GetTextureSize(InternalFormat, Width, Height, Mipmapped));
 
     return TextureID;
 }
@@ -73,6 +95,7 @@ unsigned int Engine::Util::LoadTextureFromData(const unsigned char* Data, int Wi
 
 
 void Engine::Util::UnloadTexture(unsigned int& TextureID) {
+    MemoryTracker::UntrackGpu(MemoryTracker::GpuObject::Texture, TextureID);
     glDeleteTextures(1, &TextureID);
     TextureID = 0;
 }
\ No newline at end of file
@@ -7,11 +7,12 @@
 #include <string>
 #include <filesystem>
 #include <vector>
-#include <windows.h>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <stb_image.h>
+#include "../core/platform/platform.h"
+#include "../core/memory/memory_tracker.h"
 
 namespace Engine
 {
@@ -29,7 +30,20 @@ namespace Engine
             std::vector<MeshData> Meshes;
         };
 
+        struct TextureData
+        {
+            unsigned char *Pixels = nullptr; // Owned, release with FreeTextureData
+            int Width = 0, Height = 0, NumChannels = 0;
+        };
+
         static std::string GetExecutablePath();
+        // Full path of a file under the executable directory, with the asset casing resolved on Linux
+        static std::string GetAssetPath(const std::string &Path);
+        // Decodes an image file without touching GL, safe to call from job threads
+        static TextureData DecodeTexture(const std::string &Path);
+        // Reads only the image header, NumChannels is what DecodeTexture would return
+        static bool GetTextureInfo(const std::string &Path, int &Width, int &Height, int &NumChannels);
+        static void FreeTextureData(TextureData &Data);
         static unsigned int LoadTexture(std::string Path, GLint MinFilter = GL_LINEAR_MIPMAP_LINEAR, GLint MagFilter = GL_LINEAR);
         static unsigned int LoadTextureFromData(const unsigned char* Data, int Width, int Height, int NumChannels, GLint MinFilter = GL_LINEAR_MIPMAP_LINEAR, GLint MagFilter = GL_LINEAR);
         static void UnloadTexture(unsigned int &TextureID);